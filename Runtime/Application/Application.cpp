@@ -1,4 +1,5 @@
 #include "Application.h"
+#include "Foundation/AsyncFileWriter.h"
 #include "Foundation/Logger.h"
 #include "VulkanRenderer/Device.h"
 #include "VulkanRenderer/CommandBufferRing.h"
@@ -7,6 +8,7 @@
 #include "Utils/AssetProjectSetting.h"
 #include "Shader/ShaderManager.h"
 #include "VulkanRenderer/DefineList.h"
+#include <algorithm>
 #include <glm/glm.hpp>
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
@@ -17,6 +19,11 @@
 #include "ImGUI/Libary/imgui.h"
 #include "RenderDoc/RenderDoc.h"
 #include "VulkanRenderer/ExtDebugUtils.h"
+#include "VulkanRenderer/GraphicsPipelineCache.h"
+#include "VulkanRenderer/PipelineCompileService.h"
+#include "VulkanRenderer/PipelineLayoutCache.h"
+#include "VulkanRenderer/ShaderReflection.h"
+#include "Foundation/ThreadPool.h"
 #include "VulkanRenderer/Utils.hpp"
 
 
@@ -33,13 +40,15 @@ void Application::Startup() {
     RenderDoc::Load();
 
     gLogger->StartLogging();
+    gAsyncFileWriter->Initialize();
     gAssetProjectSetting->Initialize();
+    gThreadPool->Initialize();
     vkgfx::gDxcModule->OnCreate();
 
     SetupGlfw();
     SetupVulkan();
 
-    gShaderManager->Initialize();
+    gShaderManager->Initialize(kNumBackBuffer);
 
     constexpr size_t k128MB = 128 * 1024 * 1024;
     _uploadHeap.OnCreate("GlobalUploadHeap", vkgfx::gDevice, k128MB);
@@ -61,11 +70,15 @@ void Application::Cleanup() {
     vkgfx::gDevice->WaitGPUFlush();
     gEditorWindow->OnDestroy();
     gGui->OnDestroy();
+    // the workers may still create pipelines from the shader modules
+    vkgfx::gPipelineCompileService->WaitForCompileJobs();
     gShaderManager->Destroy();
     CleanUpVulkan();
     CleanUpGlfw();
     vkgfx::gDxcModule->OnDestroy();
+    gThreadPool->Destroy();
     gAssetProjectSetting->Destroy();
+    gAsyncFileWriter->Destroy();
     RenderDoc::Free();
     gLogger->Destroy();
 }
@@ -91,9 +104,16 @@ void Application::PollEvents() {
 }
 
 void Application::Update(std::shared_ptr<GameTimer> pGameTimer) {
+    gShaderManager->Update();
     gGui->NewFrame();
     ImGui::DockSpaceOverViewport(ImGui::GetMainViewport());
     gEditorWindow->OnGUI(*pGameTimer);
+
+    // keep the pipeline cache on disk up to date, so a crash does not lose the pipelines compiled so far
+    if (pGameTimer->GetTotalTime() - _lastPipelineCacheSaveTime > kPipelineCacheSaveInterval) {
+        _lastPipelineCacheSaveTime = pGameTimer->GetTotalTime();
+        vkgfx::gDevice->SavePipelineCache();
+    }
 }
 
 void Application::RenderScene(std::shared_ptr<GameTimer> pGameTimer) {
@@ -104,10 +124,14 @@ void Application::RenderScene(std::shared_ptr<GameTimer> pGameTimer) {
 
     _graphicsCmdRing.OnBeginFrame();
     _dynamicBufferRing.OnBeginFrame();
+    _vertexBuffer.OnBeginFrame();
 
     vk::CommandBuffer cmd = _graphicsCmdRing.GetNewCommandBuffer();
     vk::CommandBufferBeginInfo beginInfo;
     cmd.begin(beginInfo);
+    uint64_t uploadWaitValue = _uploadHeap.RecordAcquireBarriers(cmd);
+    // compact the static buffers a bit every frame, the draws below already read the moved ranges
+    _vertexBuffer.Defragment(cmd, _uploadHeap, kDefragmentBytesPerFrame);
 
     vkgfx::gSwapChain->WaitForSwapChain();
 
@@ -122,20 +146,39 @@ void Application::RenderScene(std::shared_ptr<GameTimer> pGameTimer) {
     cmd.beginRenderPass(&renderPassBeginInfo, vk::SubpassContents::eInline);
     if (vkgfx::PrefMarkerGuard profile(cmd, "OpaquePass"); profile.Sample()) {
 
-        cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, _graphicsPipeline);
-        cmd.bindVertexBuffers(0, _triangleBufferInfo.buffer, _triangleBufferInfo.offset);
-        cmd.draw(3, 1, 0, 0);
+        // skip the triangle until its pipeline finished compiling
+        if (vk::Pipeline pipeline = _trianglePipeline.GetPipeline()) {
+            cmd.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+            cmd.bindVertexBuffers(0, _pTriangleBufferInfo->buffer, _pTriangleBufferInfo->offset);
+            cmd.draw(3, 1, 0, 0);
+        }
     }
     gGui->Draw(cmd);
 
     cmd.endRenderPass();
     cmd.end();
 
-    vk::PipelineStageFlags waitDstMask = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    // the upload heap's timeline semaphore is only waited on when this frame acquires uploaded resources
+    std::array<vk::Semaphore, 2> waitSemaphores = {
+        vkgfx::gSwapChain->GetImageAvailableSemaphore(),
+        _uploadHeap.GetTimelineSemaphore(),
+    };
+    std::array<vk::PipelineStageFlags, 2> waitDstMasks = {
+        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+        vk::PipelineStageFlagBits::eAllCommands,
+    };
+    std::array<uint64_t, 2> waitValues = {0, uploadWaitValue};
+    uint32_t waitSemaphoreCount = (uploadWaitValue > 0) ? 2 : 1;
+
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo;
+    timelineSubmitInfo.waitSemaphoreValueCount = waitSemaphoreCount;
+    timelineSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+
     vk::SubmitInfo submitInfo;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &vkgfx::gSwapChain->GetImageAvailableSemaphore();
-    submitInfo.pWaitDstStageMask = &waitDstMask;
+    submitInfo.pNext = &timelineSubmitInfo;
+    submitInfo.waitSemaphoreCount = waitSemaphoreCount;
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitDstMasks.data();
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &cmd;
     submitInfo.signalSemaphoreCount = 1;
@@ -154,87 +197,6 @@ void Application::RenderScene(std::shared_ptr<GameTimer> pGameTimer) {
 void Application::OnResize() {
     _graphicsCmdRing.WaitForRenderFinished(vkgfx::gDevice->GetGraphicsQueue());
     vkgfx::gSwapChain->Resize(_width, _height, false);
-
-    vk::Device device = vkgfx::gDevice->GetVKDevice();
-    if (_graphicsPipeline) {
-        device.destroyPipeline(_graphicsPipeline);
-        _graphicsPipeline = VK_NULL_HANDLE;
-    }
-    if (_pipelineLayout) {
-        device.destroyPipelineLayout(_pipelineLayout);
-        _pipelineLayout = VK_NULL_HANDLE;
-    }
-
-    vk::PipelineShaderStageCreateInfo shaderStages[2];
-    ShaderLoadInfo loadInfo = {"Assets/Shaders/Triangles.hlsl", "VSMain", vkgfx::ShaderType::kVS};
-    gShaderManager->LoadShaderStageCreateInfo(loadInfo, shaderStages[0]);
-
-    loadInfo.entryPoint = "PSMain";
-    loadInfo.shaderType = vkgfx::ShaderType::kPS;
-    gShaderManager->LoadShaderStageCreateInfo(loadInfo, shaderStages[1]);
-
-    vk::VertexInputBindingDescription bindingDescription[1];
-    bindingDescription[0].binding = 0;
-    bindingDescription[0].stride = sizeof(Vertex);
-    bindingDescription[0].inputRate = vk::VertexInputRate::eVertex;
-
-    vk::VertexInputAttributeDescription attributeDescription[2];
-    attributeDescription[0].location = 0;
-    attributeDescription[0].binding = 0;
-    attributeDescription[0].format = vk::Format::eR32G32B32Sfloat;
-    attributeDescription[0].offset = offsetof(Vertex, position);
-
-    attributeDescription[1].location = 1;
-    attributeDescription[1].binding = 0;
-    attributeDescription[1].format = vk::Format::eR32G32B32Sfloat;
-    attributeDescription[1].offset = offsetof(Vertex, color);
-
-    vk::PipelineVertexInputStateCreateInfo vertexInputCreateInfo;
-    vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-    vertexInputCreateInfo.pVertexBindingDescriptions = bindingDescription;
-    vertexInputCreateInfo.vertexAttributeDescriptionCount = 2;
-    vertexInputCreateInfo.pVertexAttributeDescriptions = attributeDescription;
-
-    vk::PipelineRasterizationStateCreateInfo rasterizationStateCreateInfo;
-    rasterizationStateCreateInfo.polygonMode = vk::PolygonMode::eFill;
-    rasterizationStateCreateInfo.cullMode = vk::CullModeFlagBits::eBack;
-    rasterizationStateCreateInfo.frontFace = vk::FrontFace::eClockwise;
-    rasterizationStateCreateInfo.depthClampEnable = VK_FALSE;
-    rasterizationStateCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-    rasterizationStateCreateInfo.depthBiasEnable = VK_FALSE;
-    rasterizationStateCreateInfo.depthBiasConstantFactor = 0;
-    rasterizationStateCreateInfo.depthBiasClamp = 0;
-    rasterizationStateCreateInfo.depthBiasSlopeFactor = 0;
-    rasterizationStateCreateInfo.lineWidth = 1.0;
-
-    vk::PipelineColorBlendStateCreateInfo colorBlendCreateInfo;
-    colorBlendCreateInfo.logicOpEnable = VK_FALSE;
-    colorBlendCreateInfo.attachmentCount = 1;
-    colorBlendCreateInfo.pAttachments = vkgfx::GetColorBlendAttachmentState_Opaque();
-    colorBlendCreateInfo.blendConstants = std::array<float, 4>{0.f};
-
-    vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo;
-    pipelineLayoutCreateInfo.setLayoutCount = 0;
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    _pipelineLayout = device.createPipelineLayout(pipelineLayoutCreateInfo);
-
-    vk::GraphicsPipelineCreateInfo pipelineCreateInfo;
-    pipelineCreateInfo.stageCount = 2;
-    pipelineCreateInfo.pStages = shaderStages;
-    pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
-    pipelineCreateInfo.pInputAssemblyState = vkgfx::GetInputAssemblyState_TriangleList();
-    pipelineCreateInfo.pTessellationState = nullptr;
-    pipelineCreateInfo.pViewportState = vkgfx::GetViewportState<1, 1>();
-    pipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
-    pipelineCreateInfo.pMultisampleState = vkgfx::GetMultiSampleState_Disable();
-    pipelineCreateInfo.pDepthStencilState = vkgfx::GetDepthStencilState_DepthStandard();
-    pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
-    pipelineCreateInfo.pDynamicState = vkgfx::GetDynamicState_ViewportScissor();
-    pipelineCreateInfo.layout = _pipelineLayout;
-    pipelineCreateInfo.renderPass = vkgfx::gSwapChain->GetRenderPass();
-    pipelineCreateInfo.basePipelineHandle = nullptr;
-    pipelineCreateInfo.basePipelineIndex = -1;
-    _graphicsPipeline = device.createGraphicsPipeline(vkgfx::gDevice->GetPipelineCache(), pipelineCreateInfo).value;
 }
 
 Application::~Application() {
@@ -270,23 +232,22 @@ void Application::SetupVulkan() {
     vkgfx::gDevice->OnCreate("VulkanAPP", "Vulkan", true, _pWindow);
     vkgfx::gSwapChain->OnCreate(vkgfx::gDevice, kNumBackBuffer);
     _graphicsCmdRing.OnCreate(vkgfx::gDevice, kNumBackBuffer, kNumCommandBufferPreFrame);
-    vkgfx::gDevice->CreatePipelineCache();
+    vkgfx::gDevice->CreatePipelineCache(gAssetProjectSetting->GetAssetCacheAbsolutePath() / "PipelineCache.bin");
+    vkgfx::gGraphicsPipelineCache->OnCreate(vkgfx::gDevice);
+    vkgfx::gPipelineCompileService->OnCreate(vkgfx::gDevice, vkgfx::gGraphicsPipelineCache);
+    vkgfx::gPipelineLayoutCache->OnCreate(vkgfx::gDevice);
 }
 
 void Application::CleanUpVulkan() {
     vkgfx::gDevice->WaitGPUFlush();
+    vkgfx::gPipelineCompileService->OnDestroy();
+    vkgfx::gGraphicsPipelineCache->OnDestroy();
+    vkgfx::gPipelineLayoutCache->OnDestroy();
+    _trianglePipeline = {};
     vkgfx::gDevice->DestroyPipelineCache();
     _graphicsCmdRing.OnDestroy();
     _vertexBuffer.OnDestroy();
     _uploadHeap.OnDestroy();
-    if (_pipelineLayout) {
-	    vkgfx::gDevice->GetVKDevice().destroyPipelineLayout(_pipelineLayout);
-        _pipelineLayout = VK_NULL_HANDLE;
-    }
-    if (_graphicsPipeline) {
-	    vkgfx::gDevice->GetVKDevice().destroyPipeline(_graphicsPipeline);
-	    _graphicsPipeline = VK_NULL_HANDLE;
-    }
 
     _dynamicBufferRing.OnDestroy();
     vkgfx::gSwapChain->OnDestroy();
@@ -321,9 +282,72 @@ void Application::Loading() {
     // clang-format on
 
     size_t memoryAllocSize = sizeof(Vertex) * vertices.size();
-    _vertexBuffer.OnCreate("TriangleBuffer", vkgfx::gDevice, memoryAllocSize);
-    _triangleBufferInfo = _vertexBuffer.AllocBuffer(vertices).value();
-    _vertexBuffer.UploadData(_uploadHeap);
-    _vertexBuffer.FreeUploadHeap();
-    _uploadHeap.Flush();
+    _vertexBuffer.OnCreate("TriangleBuffer", vkgfx::gDevice, memoryAllocSize, kNumBackBuffer);
+    _pTriangleBufferInfo = _vertexBuffer.AllocBuffer(_uploadHeap, vertices);
+    ExceptionAssert(_pTriangleBufferInfo.HasValue());
+    _uploadHeap.FlushAndFinish();
+
+    // the pipeline only depends on the swap chain render pass, which survives resizing
+    vk::PipelineShaderStageCreateInfo shaderStages[2];
+    stdfs::path shaderPath = "Assets/Shaders/Triangles.hlsl";
+    ShaderLoadInfo loadInfos[] = {
+        {shaderPath, "VSMain", vkgfx::ShaderType::kVS},
+        {shaderPath, "PSMain", vkgfx::ShaderType::kPS},
+    };
+    // compile both stages in parallel, the stage create infos below then hit the module map
+    gShaderManager->LoadShaderModules(loadInfos);
+    for (size_t i = 0; i < std::size(shaderStages); ++i) {
+        gShaderManager->LoadShaderStageCreateInfo(loadInfos[i], shaderStages[i]);
+        _trianglePipelineDesc.SetShaderStage(shaderStages[i]);
+        _triangleShaderModules[i] = shaderStages[i].module;
+    }
+    Exception::CondThrow(UpdateTrianglePipelineLayout(), "The triangle shaders don't fit the triangle pipeline");
+    _trianglePipelineDesc.SetRenderPass(vkgfx::gSwapChain->GetRenderPass());
+    _trianglePipeline = vkgfx::gPipelineCompileService->CompileGraphics(_trianglePipelineDesc);
+
+    // keep drawing with the current pipeline until the one with the reloaded shaders is published
+    gShaderManager->AddReloadCallback([this](std::span<const ShaderModuleReload> reloads) {
+        bool changed = false;
+        for (const ShaderModuleReload &reload : reloads) {
+            changed |= _trianglePipelineDesc.ReplaceShaderModule(reload.oldShaderModule, reload.newShaderModule);
+            std::ranges::replace(_triangleShaderModules, reload.oldShaderModule, reload.newShaderModule);
+        }
+        // a shader that no longer fits keeps the current pipeline, the next edit can fix it
+        if (changed && UpdateTrianglePipelineLayout()) {
+            _trianglePipeline = vkgfx::gPipelineCompileService->CompileGraphics(_trianglePipelineDesc,
+                _trianglePipeline.GetPipeline());
+        }
+    });
+}
+
+bool Application::UpdateTrianglePipelineLayout() {
+    // the layout and the vertex input follow the shaders, so an edit that adds a resource just works.
+    // Nothing is changed unless every stage checks out, this also runs for hot reloaded shaders
+    vkgfx::PipelineLayoutDesc layoutDesc;
+    vk::VertexInputBindingDescription binding;
+    std::vector<vk::VertexInputAttributeDescription> attributes;
+    for (vk::ShaderModule shaderModule : _triangleShaderModules) {
+        const vkgfx::ShaderReflection *pReflection = gShaderManager->GetShaderReflection(shaderModule);
+        if (pReflection == nullptr) {
+            Logger::Warning("The triangle shaders have no reflection");
+            return false;
+        }
+        if (!layoutDesc.AddShaderStage(*pReflection)) {
+            return false;
+        }
+        if (pReflection->GetStage() != vk::ShaderStageFlagBits::eVertex) {
+            continue;
+        }
+
+        binding = pReflection->MakeVertexInput(0, attributes);
+        if (binding.stride != sizeof(Vertex)) {
+            Logger::Warning("The triangle vertex shader expects a {} byte vertex, the buffer holds {}",
+                binding.stride,
+                sizeof(Vertex));
+            return false;
+        }
+    }
+    _trianglePipelineDesc.SetVertexInput(std::span(&binding, 1), attributes);
+    _trianglePipelineDesc.SetPipelineLayout(vkgfx::gPipelineLayoutCache->GetPipelineLayout(layoutDesc));
+    return true;
 }
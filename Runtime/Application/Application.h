@@ -8,6 +8,7 @@
 #include "VulkanRenderer/UploadHeap.h"
 #include "VulkanRenderer/CommandBufferRing.h"
 #include "VulkanRenderer/DynamicBufferRing.h"
+#include "VulkanRenderer/PipelineCompileService.h"
 
 class Application : public IApplication {
 public:
@@ -27,24 +28,29 @@ public:
     void SetupVulkan();
     void CleanUpVulkan();
     void Loading();
+    bool UpdateTrianglePipelineLayout();
     static void GlfwErrorCallback(int error, const char *description);
     static void FrameBufferResizeCallback(GLFWwindow *pWindow, int width, int height);
     static void WindowMinimizeCallback(GLFWwindow *pWindow, int minimized);
 private:
     static constexpr size_t kNumBackBuffer = 2;
+    static constexpr float kPipelineCacheSaveInterval = 60.f;    // seconds
+    static constexpr size_t kDefragmentBytesPerFrame = 1024 * 1024;
 private:
     bool _pause = false;
     bool _needResize = true;
     GLFWwindow *_pWindow = nullptr;
     uint32_t _width = 0;
     uint32_t _height = 0;
+    float _lastPipelineCacheSaveTime = 0.f;
 private:
     vkgfx::CommandBufferRing _graphicsCmdRing;
     vkgfx::DynamicBufferRing _dynamicBufferRing;
     vkgfx::UploadHeap _uploadHeap;
 private:
-    vk::Pipeline _graphicsPipeline;
-    vk::PipelineLayout _pipelineLayout;
+    vkgfx::GraphicsPipelineDesc _trianglePipelineDesc;
+    vkgfx::PipelineHandle _trianglePipeline;
+    std::array<vk::ShaderModule, 2> _triangleShaderModules;
     vkgfx::StaticBufferPool _vertexBuffer;
-    vk::DescriptorBufferInfo _triangleBufferInfo = {};
+    vkgfx::StaticBufferPool::BufferView _pTriangleBufferInfo;
 };
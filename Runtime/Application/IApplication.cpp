@@ -1,6 +1,7 @@
 #include "IApplication.h"
 #include "Foundation/GameTimer.h"
 #include "Foundation/Logger.h"
+#include "Foundation/MainThread.h"
 
 int RunApplication(IApplication &application) {
 	std::shared_ptr<GameTimer> pGameTimer = std::make_shared<GameTimer>();
@@ -19,8 +20,10 @@ int RunApplication(IApplication &application) {
 			}
 
 			pGameTimer->StartNewFrame();
+			MainThread::ExecuteBeginFrameJob();
 			application.Update(pGameTimer);
 			application.RenderScene(pGameTimer);
+			MainThread::ExecuteEndFrameJob();
 		}
 		application.Cleanup();
 	} catch (const std::exception &exception) {
@@ -0,0 +1,267 @@
+#include "AsyncFileWriter.h"
+#include "Exception.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+#if PLATFORM_WIN
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+#if PLATFORM_WIN
+
+using NativeFile = HANDLE;
+const NativeFile kInvalidFile = INVALID_HANDLE_VALUE;
+
+auto CreateNativeFile(const stdfs::path &path) -> NativeFile {
+    return ::CreateFileW(path.c_str(),
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+}
+
+auto WriteNativeFile(NativeFile file, const char *pData, size_t size) -> bool {
+    while (size > 0) {
+        DWORD chunkSize = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+        DWORD written = 0;
+        if (!::WriteFile(file, pData, chunkSize, &written, nullptr) || written == 0) {
+            return false;
+        }
+        pData += written;
+        size -= written;
+    }
+    return true;
+}
+
+auto SyncNativeFile(NativeFile file) -> bool {
+    return ::FlushFileBuffers(file) != FALSE;
+}
+
+void CloseNativeFile(NativeFile file) {
+    ::CloseHandle(file);
+}
+
+// write through, the rename is on disk when the call returns
+auto ReplaceNativeFile(const stdfs::path &from, const stdfs::path &to) -> bool {
+    return ::MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+
+#else
+
+using NativeFile = int;
+const NativeFile kInvalidFile = -1;
+
+auto CreateNativeFile(const stdfs::path &path) -> NativeFile {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+auto WriteNativeFile(NativeFile file, const char *pData, size_t size) -> bool {
+    while (size > 0) {
+        ssize_t written = ::write(file, pData, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        pData += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+auto SyncNativeFile(NativeFile file) -> bool {
+    return ::fsync(file) == 0;
+}
+
+void CloseNativeFile(NativeFile file) {
+    ::close(file);
+}
+
+// the directory entry is synced as well, otherwise the rename itself can be lost
+auto ReplaceNativeFile(const stdfs::path &from, const stdfs::path &to) -> bool {
+    if (::rename(from.c_str(), to.c_str()) != 0) {
+        return false;
+    }
+    stdfs::path directory = to.has_parent_path() ? to.parent_path() : stdfs::path(".");
+    int directoryFile = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (directoryFile >= 0) {
+        ::fsync(directoryFile);
+        ::close(directoryFile);
+    }
+    return true;
+}
+
+#endif
+
+}    // namespace
+
+struct AsyncFileWriter::File::State {
+    stdfs::path path;
+    stdfs::path tempPath;
+    NativeFile file = kInvalidFile;
+    bool failed = false;
+    std::promise<bool> promise;
+
+    void Close() {
+        if (file != kInvalidFile) {
+            CloseNativeFile(file);
+            file = kInvalidFile;
+        }
+    }
+};
+
+auto AsyncFileWriter::File::operator=(File &&other) noexcept -> File & {
+    if (this != &other) {
+        Discard();
+        _pWriter = std::exchange(other._pWriter, nullptr);
+        _pState = std::move(other._pState);
+    }
+    return *this;
+}
+
+AsyncFileWriter::File::~File() {
+    Discard();
+}
+
+void AsyncFileWriter::File::Append(std::string chunk) {
+    ExceptionAssert(IsOpen());
+    if (chunk.empty()) {
+        return;
+    }
+    _pWriter->PushJob([pState = _pState, chunk = std::move(chunk)]() {
+        if (pState->file != kInvalidFile && !pState->failed) {
+            pState->failed = !WriteNativeFile(pState->file, chunk.data(), chunk.size());
+        }
+    });
+}
+
+auto AsyncFileWriter::File::Commit(Callback callback) -> std::shared_future<bool> {
+    if (!IsOpen()) {
+        std::promise<bool> promise;
+        promise.set_value(false);
+        return promise.get_future().share();
+    }
+
+    std::shared_future<bool> future = _pState->promise.get_future().share();
+    _pWriter->PushJob([pState = std::move(_pState), callback = std::move(callback)]() {
+        // the data must reach the disk before the rename, after a power loss the new name could point
+        // at a file whose content was never written
+        bool succeeded = pState->file != kInvalidFile && !pState->failed && SyncNativeFile(pState->file);
+        pState->Close();
+        if (succeeded) {
+            // the rename replaces the target in one step, readers see the old file or the new one
+            succeeded = ReplaceNativeFile(pState->tempPath, pState->path);
+        }
+        if (!succeeded) {
+            Logger::Warning("Can't write the file {}", pState->path.string());
+            std::error_code errorCode;
+            stdfs::remove(pState->tempPath, errorCode);
+        }
+        if (callback != nullptr) {
+            callback(succeeded);
+        }
+        pState->promise.set_value(succeeded);
+    });
+    _pWriter = nullptr;
+    return future;
+}
+
+void AsyncFileWriter::File::Discard() {
+    if (!IsOpen()) {
+        return;
+    }
+    _pWriter->PushJob([pState = std::move(_pState)]() {
+        pState->Close();
+        std::error_code errorCode;
+        stdfs::remove(pState->tempPath, errorCode);
+        pState->promise.set_value(false);
+    });
+    _pWriter = nullptr;
+}
+
+void AsyncFileWriter::Initialize() {
+    ExceptionAssert(!_thread.joinable());
+    {
+        std::lock_guard lock(_mutex);
+        _stop = false;
+        _running = true;
+    }
+    _thread = std::thread(&AsyncFileWriter::WorkerLoop, this);
+}
+
+void AsyncFileWriter::Destroy() {
+    if (!_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+    _thread.join();
+}
+
+auto AsyncFileWriter::Open(const stdfs::path &path) -> File {
+    File file;
+    file._pWriter = this;
+    file._pState = std::make_shared<File::State>();
+    file._pState->path = path;
+    file._pState->tempPath = path;
+    file._pState->tempPath += ".tmp";
+    PushJob([pState = file._pState]() {
+        pState->file = CreateNativeFile(pState->tempPath);
+    });
+    return file;
+}
+
+void AsyncFileWriter::Flush() {
+    std::unique_lock lock(_mutex);
+    _idleCondition.wait(lock, [this]() { return _jobQueue.empty() && !_busy; });
+}
+
+void AsyncFileWriter::PushJob(std::function<void()> job) {
+    {
+        std::lock_guard lock(_mutex);
+        // jobs pushed during Destroy are still queued, the worker drains the queue before it exits and
+        // running them here could overtake the queued ones
+        if (_running) {
+            _jobQueue.push_back(std::move(job));
+            _condition.notify_one();
+            return;
+        }
+    }
+    // no I/O thread, the file is written by the caller
+    job();
+}
+
+void AsyncFileWriter::WorkerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(_mutex);
+            _busy = false;
+            if (_jobQueue.empty()) {
+                _idleCondition.notify_all();
+            }
+            _condition.wait(lock, [this]() { return _stop || !_jobQueue.empty(); });
+            if (_jobQueue.empty()) {
+                // decided under the lock, every job queued so far has been executed
+                _running = false;
+                return;
+            }
+            job = std::move(_jobQueue.front());
+            _jobQueue.pop_front();
+            _busy = true;
+        }
+        job();
+    }
+}
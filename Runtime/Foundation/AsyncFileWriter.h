@@ -0,0 +1,66 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/NonCopyable.h"
+#include "Foundation/RuntimeStatic.h"
+
+// Writes files on a dedicated I/O thread, so a save costs the caller no more than handing over its
+// buffers. A file is written to '<path>.tmp' and renamed over 'path' once it is complete, a crash in
+// the middle of a save leaves the previous file in place instead of a truncated one. The temp file is
+// flushed to disk before the rename, so this holds after a power loss as well.
+// Before Initialize and after Destroy the jobs run on the calling thread.
+class AsyncFileWriter : public NonCopyable {
+public:
+    // called on the I/O thread once the file is renamed into place or has failed
+    using Callback = std::function<void(bool succeeded)>;
+
+    class File {
+    public:
+        File() = default;
+        File(File &&) noexcept = default;
+        File &operator=(File &&other) noexcept;
+        // a file that was never committed is discarded, the target keeps its old content
+        ~File();
+        auto IsOpen() const -> bool {
+            return _pState != nullptr;
+        }
+        // the chunks are written in the order they are appended
+        void Append(std::string chunk);
+        auto Commit(Callback callback = nullptr) -> std::shared_future<bool>;
+    private:
+        friend class AsyncFileWriter;
+        struct State;
+        void Discard();
+    private:
+        AsyncFileWriter *_pWriter = nullptr;
+        std::shared_ptr<State> _pState;
+    };
+public:
+    void Initialize();
+    // the queued files are still written before the thread exits
+    void Destroy();
+    auto Open(const stdfs::path &path) -> File;
+    // blocks until every queued job has been executed
+    void Flush();
+private:
+    void PushJob(std::function<void()> job);
+    void WorkerLoop();
+private:
+    std::thread _thread;
+    std::deque<std::function<void()>> _jobQueue;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::condition_variable _idleCondition;
+    bool _busy = false;
+    bool _stop = false;
+    bool _running = false;
+};
+
+inline RuntimeStatic<AsyncFileWriter> gAsyncFileWriter;
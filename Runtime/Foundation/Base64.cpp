@@ -0,0 +1,92 @@
+#include "Base64.h"
+#include <array>
+#include <cstdint>
+
+namespace nstd {
+
+namespace {
+
+constexpr std::string_view kAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr uint8_t kInvalid = 0xFF;
+
+constexpr auto MakeDecodeTable() -> std::array<uint8_t, 256> {
+    std::array<uint8_t, 256> table = {};
+    table.fill(kInvalid);
+    for (size_t i = 0; i < kAlphabet.size(); ++i) {
+        table[static_cast<uint8_t>(kAlphabet[i])] = static_cast<uint8_t>(i);
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> kDecodeTable = MakeDecodeTable();
+
+}    // namespace
+
+void Base64Encode(std::span<const std::byte> bytes, std::string &output) {
+    size_t offset = output.size();
+    output.resize(offset + (bytes.size() + 2) / 3 * 4);
+    char *pOutput = output.data() + offset;
+
+    size_t i = 0;
+    for (; i + 3 <= bytes.size(); i += 3) {
+        uint32_t triple = (std::to_integer<uint32_t>(bytes[i]) << 16) |
+                          (std::to_integer<uint32_t>(bytes[i + 1]) << 8) | std::to_integer<uint32_t>(bytes[i + 2]);
+        *pOutput++ = kAlphabet[(triple >> 18) & 0x3F];
+        *pOutput++ = kAlphabet[(triple >> 12) & 0x3F];
+        *pOutput++ = kAlphabet[(triple >> 6) & 0x3F];
+        *pOutput++ = kAlphabet[triple & 0x3F];
+    }
+
+    size_t remainder = bytes.size() - i;
+    if (remainder > 0) {
+        uint32_t triple = std::to_integer<uint32_t>(bytes[i]) << 16;
+        if (remainder == 2) {
+            triple |= std::to_integer<uint32_t>(bytes[i + 1]) << 8;
+        }
+        *pOutput++ = kAlphabet[(triple >> 18) & 0x3F];
+        *pOutput++ = kAlphabet[(triple >> 12) & 0x3F];
+        *pOutput++ = (remainder == 2) ? kAlphabet[(triple >> 6) & 0x3F] : '=';
+        *pOutput++ = '=';
+    }
+}
+
+auto Base64DecodedSize(std::string_view text) -> std::optional<size_t> {
+    if (text.size() % 4 != 0) {
+        return std::nullopt;
+    }
+    size_t padding = 0;
+    if (!text.empty() && text.back() == '=') {
+        padding = (text[text.size() - 2] == '=') ? 2 : 1;
+    }
+    return text.size() / 4 * 3 - padding;
+}
+
+bool Base64Decode(std::string_view text, std::span<std::byte> output) {
+    std::optional<size_t> pDecodedSize = Base64DecodedSize(text);
+    if (!pDecodedSize.has_value() || *pDecodedSize != output.size()) {
+        return false;
+    }
+
+    size_t outputIndex = 0;
+    for (size_t i = 0; i < text.size(); i += 4) {
+        uint32_t quad = 0;
+        size_t validCount = 0;
+        for (size_t j = 0; j < 4; ++j) {
+            char c = text[i + j];
+            bool isPadding = (c == '=') && (i + 4 == text.size()) && (j >= 2);
+            uint8_t value = isPadding ? 0 : kDecodeTable[static_cast<uint8_t>(c)];
+            // nothing but padding may follow the padding
+            if (value == kInvalid || (!isPadding && validCount < j)) {
+                return false;
+            }
+            quad = (quad << 6) | value;
+            validCount += isPadding ? 0 : 1;
+        }
+        for (size_t j = 0; j < validCount - 1; ++j) {
+            output[outputIndex++] = static_cast<std::byte>((quad >> (16 - j * 8)) & 0xFF);
+        }
+    }
+    return true;
+}
+
+}    // namespace nstd
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace nstd {
+
+// standard alphabet with '=' padding
+void Base64Encode(std::span<const std::byte> bytes, std::string &output);
+// nullopt when 'text' is not valid base64
+auto Base64DecodedSize(std::string_view text) -> std::optional<size_t>;
+// 'output' must be exactly 'Base64DecodedSize(text)' bytes
+bool Base64Decode(std::string_view text, std::span<std::byte> output);
+
+}    // namespace nstd
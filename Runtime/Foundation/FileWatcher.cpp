@@ -0,0 +1,135 @@
+#include "FileWatcher.h"
+#include "Foundation/Logger.h"
+#if PLATFORM_WIN
+    #include <Windows.h>
+#endif
+
+FileWatcher::~FileWatcher() {
+    Stop();
+}
+
+auto FileWatcher::PollChanges() -> std::vector<stdfs::path> {
+    std::vector<stdfs::path> changes;
+    Clock::time_point now = Clock::now();
+    std::lock_guard lock(_mutex);
+    std::erase_if(_changes, [&](const auto &item) {
+        if (now - item.second < kSettleTime) {
+            return false;
+        }
+        changes.push_back(item.first);
+        return true;
+    });
+    return changes;
+}
+
+void FileWatcher::AddChange(const stdfs::path &path) {
+    std::lock_guard lock(_mutex);
+    _changes[path.lexically_normal()] = Clock::now();
+}
+
+#if PLATFORM_WIN
+
+bool FileWatcher::Start(const stdfs::path &directory) {
+    Stop();
+    _directory = stdfs::absolute(directory);
+    HANDLE hDirectory = ::CreateFileW(_directory.c_str(),
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        nullptr);
+    if (hDirectory == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    _hDirectory = hDirectory;
+    _hStopEvent = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    _thread = std::thread(&FileWatcher::WatchThread, this);
+    return true;
+}
+
+void FileWatcher::Stop() {
+    if (_thread.joinable()) {
+        ::SetEvent(_hStopEvent);
+        _thread.join();
+    }
+    if (_hStopEvent != nullptr) {
+        ::CloseHandle(_hStopEvent);
+        _hStopEvent = nullptr;
+    }
+    if (_hDirectory != nullptr) {
+        ::CloseHandle(_hDirectory);
+        _hDirectory = nullptr;
+    }
+    std::lock_guard lock(_mutex);
+    _changes.clear();
+}
+
+void FileWatcher::WatchThread() {
+    constexpr DWORD kNotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                    FILE_NOTIFY_CHANGE_SIZE;
+    // FILE_NOTIFY_INFORMATION needs DWORD alignment
+    std::vector<DWORD> buffer(16 * 1024);
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    HANDLE handles[] = {overlapped.hEvent, _hStopEvent};
+    while (true) {
+        ::ResetEvent(overlapped.hEvent);
+        BOOL succeeded = ::ReadDirectoryChangesW(_hDirectory,
+            buffer.data(),
+            static_cast<DWORD>(buffer.size() * sizeof(DWORD)),
+            TRUE,
+            kNotifyFilter,
+            nullptr,
+            &overlapped,
+            nullptr);
+        if (!succeeded) {
+            Logger::Warning("Stop watching {}, ReadDirectoryChangesW failed", _directory.string());
+            break;
+        }
+
+        DWORD bytesReturned = 0;
+        if (::WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0) {
+            ::CancelIoEx(_hDirectory, &overlapped);
+            ::GetOverlappedResult(_hDirectory, &overlapped, &bytesReturned, TRUE);
+            break;
+        }
+        if (!::GetOverlappedResult(_hDirectory, &overlapped, &bytesReturned, FALSE)) {
+            break;
+        }
+        if (bytesReturned == 0) {
+            Logger::Warning("Too many changes below {}, some of them are lost", _directory.string());
+            continue;
+        }
+
+        const std::byte *pBuffer = reinterpret_cast<const std::byte *>(buffer.data());
+        while (true) {
+            const FILE_NOTIFY_INFORMATION *pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(pBuffer);
+            // removed and renamed files are reported as well, whoever included them has to know
+            std::wstring_view fileName(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+            AddChange(_directory / fileName);
+            if (pInfo->NextEntryOffset == 0) {
+                break;
+            }
+            pBuffer += pInfo->NextEntryOffset;
+        }
+    }
+    ::CloseHandle(overlapped.hEvent);
+}
+
+#else
+
+bool FileWatcher::Start(const stdfs::path &directory) {
+    _directory = stdfs::absolute(directory);
+    Logger::Warning("Watching {} is not supported on this platform", _directory.string());
+    return false;
+}
+
+void FileWatcher::Stop() {
+}
+
+void FileWatcher::WatchThread() {
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/NonCopyable.h"
+
+// Reports the files that changed below a directory. A background thread collects the notifications
+// and 'PollChanges' hands out the paths that stayed quiet for 'kSettleTime', so a save that touches a
+// file several times is reported once, after the writer is done with it.
+class FileWatcher : public NonCopyable {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+    bool Start(const stdfs::path &directory);
+    void Stop();
+    auto IsWatching() const -> bool {
+        return _thread.joinable();
+    }
+    auto PollChanges() -> std::vector<stdfs::path>;
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr Clock::duration kSettleTime = std::chrono::milliseconds(50);
+    void WatchThread();
+    void AddChange(const stdfs::path &path);
+private:
+    stdfs::path _directory;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::unordered_map<stdfs::path, Clock::time_point> _changes;
+#if PLATFORM_WIN
+    void *_hDirectory = nullptr;
+    void *_hStopEvent = nullptr;
+#endif
+};
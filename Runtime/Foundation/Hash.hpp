@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace nstd {
+
+inline constexpr uint64_t kFNV1a64OffsetBasis = 14695981039346656037ULL;
+inline constexpr uint64_t kFNV1a64Prime = 1099511628211ULL;
+
+// FNV-1a, stable across runs and platforms, so it can be written to disk
+constexpr auto FNV1a64(std::string_view str, uint64_t hash = kFNV1a64OffsetBasis) -> uint64_t {
+    for (char c : str) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= kFNV1a64Prime;
+    }
+    return hash;
+}
+
+inline auto FNV1a64(const void *pData, size_t size, uint64_t hash = kFNV1a64OffsetBasis) -> uint64_t {
+    const uint8_t *pBytes = static_cast<const uint8_t *>(pData);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= pBytes[i];
+        hash *= kFNV1a64Prime;
+    }
+    return hash;
+}
+
+constexpr auto HashCombine(uint64_t seed, uint64_t value) -> uint64_t {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 12) + (seed >> 4));
+}
+
+}    // namespace nstd
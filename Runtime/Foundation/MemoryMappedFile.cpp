@@ -0,0 +1,119 @@
+#include "MemoryMappedFile.h"
+#if PLATFORM_WIN
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+MemoryMappedFile::~MemoryMappedFile() {
+    Close();
+}
+
+#if PLATFORM_WIN
+
+bool MemoryMappedFile::Open(const stdfs::path &path) {
+    Close();
+    // share write and delete as well, the owner appends to the file and replaces it while it is mapped
+    HANDLE hFile = ::CreateFileW(path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS,
+        nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(hFile, &fileSize)) {
+        ::CloseHandle(hFile);
+        return false;
+    }
+
+    _hFile = hFile;
+    _size = static_cast<size_t>(fileSize.QuadPart);
+    _isOpen = true;
+    // CreateFileMapping rejects empty files
+    if (_size == 0) {
+        return true;
+    }
+
+    _hMapping = ::CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_hMapping == nullptr) {
+        Close();
+        return false;
+    }
+    _pData = static_cast<const std::byte *>(::MapViewOfFile(_hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (_pData == nullptr) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MemoryMappedFile::Close() {
+    if (_pData != nullptr) {
+        ::UnmapViewOfFile(_pData);
+        _pData = nullptr;
+    }
+    if (_hMapping != nullptr) {
+        ::CloseHandle(_hMapping);
+        _hMapping = nullptr;
+    }
+    if (_hFile != nullptr) {
+        ::CloseHandle(_hFile);
+        _hFile = nullptr;
+    }
+    _size = 0;
+    _isOpen = false;
+}
+
+#else
+
+bool MemoryMappedFile::Open(const stdfs::path &path) {
+    Close();
+    int fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (::fstat(fileDescriptor, &fileStat) != 0) {
+        ::close(fileDescriptor);
+        return false;
+    }
+
+    _fileDescriptor = fileDescriptor;
+    _size = static_cast<size_t>(fileStat.st_size);
+    _isOpen = true;
+    if (_size == 0) {
+        return true;
+    }
+
+    void *pData = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    if (pData == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    _pData = static_cast<const std::byte *>(pData);
+    return true;
+}
+
+void MemoryMappedFile::Close() {
+    if (_pData != nullptr) {
+        ::munmap(const_cast<std::byte *>(_pData), _size);
+        _pData = nullptr;
+    }
+    if (_fileDescriptor >= 0) {
+        ::close(_fileDescriptor);
+        _fileDescriptor = -1;
+    }
+    _size = 0;
+    _isOpen = false;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/NonCopyable.h"
+
+// Read-only mapping of a whole file. The file may still grow through other handles while it is
+// mapped, the view keeps the size the file had in 'Open'.
+class MemoryMappedFile : public NonCopyable {
+public:
+    MemoryMappedFile() = default;
+    ~MemoryMappedFile();
+    bool Open(const stdfs::path &path);
+    void Close();
+    auto IsOpen() const -> bool {
+        return _isOpen;
+    }
+    auto GetData() const -> const std::byte * {
+        return _pData;
+    }
+    auto GetSize() const -> size_t {
+        return _size;
+    }
+    auto GetBytes() const -> std::span<const std::byte> {
+        return {_pData, _size};
+    }
+private:
+    bool _isOpen = false;
+    const std::byte *_pData = nullptr;
+    size_t _size = 0;
+#if PLATFORM_WIN
+    void *_hFile = nullptr;
+    void *_hMapping = nullptr;
+#else
+    int _fileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace nstd {
+
+// Open addressing with linear probing, for small keys that are looked up far more often than they
+// are inserted. The slots live in one array, so a hit costs a hash, a masked index and usually a
+// single compare. There is no erase, and the elements move when the table grows, so the returned
+// pointers are only valid until the next 'TryEmplace'.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class OpenHashMap {
+public:
+    auto Find(const Key &key) -> Value * {
+        return const_cast<Value *>(std::as_const(*this).Find(key));
+    }
+    auto Find(const Key &key) const -> const Value * {
+        if (_count == 0) {
+            return nullptr;
+        }
+        size_t index = FindSlot(key, MakeTag(key));
+        return (_tags[index] != 0) ? &_slots[index].value : nullptr;
+    }
+    auto TryEmplace(const Key &key) -> std::pair<Value *, bool> {
+        // keep the load factor at or below 1/2, the probe sequences stay short
+        if ((_count + 1) * 2 > _slots.size()) {
+            Grow();
+        }
+        size_t tag = MakeTag(key);
+        size_t index = FindSlot(key, tag);
+        if (_tags[index] != 0) {
+            return std::make_pair(&_slots[index].value, false);
+        }
+        _tags[index] = tag;
+        _slots[index] = Slot{key, Value{}};
+        ++_count;
+        return std::make_pair(&_slots[index].value, true);
+    }
+    auto GetCount() const -> size_t {
+        return _count;
+    }
+    void Clear() {
+        _slots.clear();
+        _tags.clear();
+        _count = 0;
+    }
+    template<typename F>
+    void ForEach(F &&func) const {
+        for (size_t i = 0; i < _slots.size(); ++i) {
+            if (_tags[i] != 0) {
+                func(_slots[i].key, _slots[i].value);
+            }
+        }
+    }
+private:
+    struct Slot {
+        Key key{};
+        Value value{};
+    };
+    // the hash with the lowest bit set, zero marks an empty slot
+    static auto MakeTag(const Key &key) -> size_t {
+        return Hash{}(key) | 1;
+    }
+    auto FindSlot(const Key &key, size_t tag) const -> size_t {
+        size_t mask = _slots.size() - 1;
+        size_t index = (tag >> 1) & mask;
+        while (_tags[index] != 0 && (_tags[index] != tag || !KeyEqual{}(_slots[index].key, key))) {
+            index = (index + 1) & mask;
+        }
+        return index;
+    }
+    void Grow() {
+        std::vector<Slot> slots = std::move(_slots);
+        std::vector<size_t> tags = std::move(_tags);
+        size_t capacity = tags.empty() ? 16 : tags.size() * 2;
+        _slots = std::vector<Slot>(capacity);
+        _tags = std::vector<size_t>(capacity, 0);
+        for (size_t i = 0; i < tags.size(); ++i) {
+            if (tags[i] != 0) {
+                size_t index = FindSlot(slots[i].key, tags[i]);
+                _tags[index] = tags[i];
+                _slots[index] = std::move(slots[i]);
+            }
+        }
+    }
+private:
+    std::vector<Slot> _slots;
+    std::vector<size_t> _tags;
+    size_t _count = 0;
+};
+
+}    // namespace nstd
@@ -0,0 +1,63 @@
+#include "ThreadPool.h"
+#include "Exception.h"
+#include <algorithm>
+
+static thread_local size_t sWorkerIndex = static_cast<size_t>(-1);
+
+void ThreadPool::Initialize(size_t numThreads) {
+    ExceptionAssert(_threads.empty());
+    if (numThreads == 0) {
+        numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1;
+    }
+    _stop = false;
+    for (size_t i = 0; i < numThreads; ++i) {
+        _threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+void ThreadPool::Destroy() {
+    {
+        std::lock_guard lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+    // the queued jobs are still executed, so no future is left without a value
+    for (std::thread &thread : _threads) {
+        thread.join();
+    }
+    _threads.clear();
+}
+
+auto ThreadPool::GetThreadCount() const -> size_t {
+    return _threads.size();
+}
+
+auto ThreadPool::GetWorkerIndex() -> size_t {
+    return sWorkerIndex;
+}
+
+void ThreadPool::PushJob(std::function<void()> job) {
+    {
+        std::lock_guard lock(_mutex);
+        ExceptionAssert(!_stop);
+        _jobQueue.push_back(std::move(job));
+    }
+    _condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop(size_t workerIndex) {
+    sWorkerIndex = workerIndex;
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(_mutex);
+            _condition.wait(lock, [this]() { return _stop || !_jobQueue.empty(); });
+            if (_jobQueue.empty()) {
+                return;
+            }
+            job = std::move(_jobQueue.front());
+            _jobQueue.pop_front();
+        }
+        job();
+    }
+}
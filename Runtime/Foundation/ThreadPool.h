@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "Foundation/NonCopyable.h"
+#include "Foundation/RuntimeStatic.h"
+
+// Fixed set of worker threads shared by the background jobs (shader and pipeline compilation).
+class ThreadPool : public NonCopyable {
+public:
+    // numThreads == 0 uses one thread per core minus the main thread
+    void Initialize(size_t numThreads = 0);
+    void Destroy();
+    auto GetThreadCount() const -> size_t;
+    // the index of the calling worker in [0, GetThreadCount()), -1 outside the pool
+    static auto GetWorkerIndex() -> size_t;
+
+    template<typename F>
+    auto Submit(F &&func) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using ResultType = std::invoke_result_t<std::decay_t<F>>;
+        auto pTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(func));
+        std::future<ResultType> future = pTask->get_future();
+        PushJob([pTask]() { (*pTask)(); });
+        return future;
+    }
+private:
+    void PushJob(std::function<void()> job);
+    void WorkerLoop(size_t workerIndex);
+private:
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _jobQueue;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stop = false;
+};
+
+inline RuntimeStatic<ThreadPool> gThreadPool;
@@ -5,7 +5,7 @@ IMPLEMENT_SERIALIZER(UUID128)
 template<>
 struct TransferHelper<uuids::uuid> {
 	template<TransferContextConcept Transfer>
-    static void Transfer(Transfer &transfer, std::string_view name, uuids::uuid &data) {
+    static void Transfer(Transfer &transfer, TransferName name, uuids::uuid &data) {
 		if constexpr (transfer.IsReading()) {
 			std::string string;
 	        transfer.Transfer(name, string);
@@ -53,6 +53,9 @@ auto UUID128::New(std::wstring_view name) -> UUID128 {
 UUID128::UUID128(const uuids::uuid &id) : uuid(id) {
 }
 
+UUID128::UUID128(std::span<const uint8_t, 16> bytes) : uuid(bytes.begin(), bytes.end()) {
+}
+
 auto UUID128::GetNameGenerator() -> uuids::uuid_name_generator & {
     static uuids::uuid_name_generator generator(from_string(sClassUUID).value());
     return generator;
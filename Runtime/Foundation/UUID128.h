@@ -1,10 +1,13 @@
 #pragma once
+#include <span>
 #include <uuid.h>
 #include "Serialize/Transfer.hpp"
 
 class UUID128 : public uuids::uuid {
     DECLARE_SERIALIZER(UUID128)
 public:
+    UUID128() = default;
+    explicit UUID128(std::span<const uint8_t, 16> bytes);
     auto ToString() const -> std::string;
     bool FromString(std::string_view string);
     static auto New() -> UUID128;
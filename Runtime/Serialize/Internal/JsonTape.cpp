@@ -0,0 +1,271 @@
+#include "JsonTape.h"
+#include "Foundation/Hash.hpp"
+
+namespace {
+
+// deeper documents are rejected instead of running out of stack
+constexpr uint32_t kMaxDepth = 256;
+
+auto ParseHex4(std::string_view text, size_t offset, uint32_t &value) -> bool {
+	if (text.size() - offset < 4) {
+		return false;
+	}
+	value = 0;
+	for (size_t i = offset; i < offset + 4; ++i) {
+		char c = text[i];
+		value <<= 4;
+		if (c >= '0' && c <= '9') {
+			value |= c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			value |= c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			value |= c - 'A' + 10;
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+void AppendUtf8(std::string &output, uint32_t codePoint) {
+	if (codePoint < 0x80) {
+		output += static_cast<char>(codePoint);
+	} else if (codePoint < 0x800) {
+		output += static_cast<char>(0xC0 | (codePoint >> 6));
+		output += static_cast<char>(0x80 | (codePoint & 0x3F));
+	} else if (codePoint < 0x10000) {
+		output += static_cast<char>(0xE0 | (codePoint >> 12));
+		output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		output += static_cast<char>(0x80 | (codePoint & 0x3F));
+	} else {
+		output += static_cast<char>(0xF0 | (codePoint >> 18));
+		output += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+		output += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		output += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+}
+
+}    // namespace
+
+bool JsonTape::Parse(std::string_view text) {
+	Clear();
+	_text = text;
+	_nodes.reserve(text.size() / 16);
+	SkipWhitespace();
+	if (!ParseValue(0)) {
+		return false;
+	}
+	SkipWhitespace();
+	return (_offset == _text.size()) || Fail();
+}
+
+void JsonTape::Clear() {
+	_text = {};
+	_offset = 0;
+	_errorOffset = 0;
+	_nodes.clear();
+	_unescapedKeys.clear();
+}
+
+auto JsonTape::Unescape(std::string_view text) -> std::string {
+	std::string output;
+	output.reserve(text.size());
+	for (size_t i = 0; i < text.size(); ++i) {
+		if (text[i] != '\\' || i + 1 == text.size()) {
+			output += text[i];
+			continue;
+		}
+		char c = text[++i];
+		switch (c) {
+		case 'b':
+			output += '\b';
+			break;
+		case 'f':
+			output += '\f';
+			break;
+		case 'n':
+			output += '\n';
+			break;
+		case 'r':
+			output += '\r';
+			break;
+		case 't':
+			output += '\t';
+			break;
+		case 'u': {
+			uint32_t codePoint = 0;
+			if (!ParseHex4(text, i + 1, codePoint)) {
+				break;
+			}
+			i += 4;
+			// a surrogate pair encodes a code point beyond the BMP
+			uint32_t lowSurrogate = 0;
+			bool isHighSurrogate = codePoint >= 0xD800 && codePoint <= 0xDBFF;
+			if (isHighSurrogate && text.substr(i + 1, 2) == "\\u" && ParseHex4(text, i + 3, lowSurrogate) &&
+				lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF) {
+				codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00);
+				i += 6;
+			}
+			AppendUtf8(output, codePoint);
+			break;
+		}
+		default:
+			// '"', '\\' and '/'
+			output += c;
+			break;
+		}
+	}
+	return output;
+}
+
+bool JsonTape::ParseValue(uint32_t depth) {
+	if (depth > kMaxDepth || _offset == _text.size()) {
+		return Fail();
+	}
+
+	uint32_t nodeIndex = static_cast<uint32_t>(_nodes.size());
+	_nodes.emplace_back();
+	char c = _text[_offset];
+	if (c == '{' || c == '[') {
+		bool isObject = (c == '{');
+		char closeBracket = isObject ? '}' : ']';
+		_nodes[nodeIndex].type = isObject ? JsonType::kObject : JsonType::kArray;
+		++_offset;
+		SkipWhitespace();
+		if (_offset < _text.size() && _text[_offset] == closeBracket) {
+			++_offset;
+			_nodes[nodeIndex].end = static_cast<uint32_t>(_nodes.size());
+			return true;
+		}
+
+		while (true) {
+			std::string_view key;
+			bool keyHasEscape = false;
+			if (isObject) {
+				if (!ParseString(key, keyHasEscape)) {
+					return false;
+				}
+				SkipWhitespace();
+				if (_offset == _text.size() || _text[_offset] != ':') {
+					return Fail();
+				}
+				++_offset;
+				SkipWhitespace();
+				if (keyHasEscape) {
+					key = _unescapedKeys.emplace_back(Unescape(key));
+				}
+			}
+
+			uint32_t childIndex = static_cast<uint32_t>(_nodes.size());
+			if (!ParseValue(depth + 1)) {
+				return false;
+			}
+			if (isObject) {
+				_nodes[childIndex].key = key;
+				_nodes[childIndex].keyHash = nstd::FNV1a64(key);
+			}
+
+			SkipWhitespace();
+			if (_offset == _text.size()) {
+				return Fail();
+			}
+			c = _text[_offset++];
+			if (c == closeBracket) {
+				break;
+			}
+			if (c != ',') {
+				return Fail();
+			}
+			SkipWhitespace();
+		}
+		_nodes[nodeIndex].end = static_cast<uint32_t>(_nodes.size());
+		return true;
+	}
+
+	JsonNode &node = _nodes[nodeIndex];
+	node.end = nodeIndex + 1;
+	if (c == '"') {
+		node.type = JsonType::kString;
+		return ParseString(node.text, node.hasEscape);
+	}
+	if (c == 't' || c == 'f') {
+		node.type = JsonType::kBool;
+		node.text = (c == 't') ? "true" : "false";
+		return ParseLiteral(node.text);
+	}
+	if (c == 'n') {
+		node.type = JsonType::kNull;
+		return ParseLiteral("null");
+	}
+	node.type = JsonType::kNumber;
+	return ParseNumber(node.text);
+}
+
+bool JsonTape::ParseString(std::string_view &text, bool &hasEscape) {
+	if (_offset == _text.size() || _text[_offset] != '"') {
+		return Fail();
+	}
+	size_t begin = ++_offset;
+	hasEscape = false;
+	while (_offset < _text.size()) {
+		char c = _text[_offset];
+		if (c == '"') {
+			text = _text.substr(begin, _offset - begin);
+			++_offset;
+			return true;
+		}
+		if (c == '\\') {
+			hasEscape = true;
+			++_offset;
+		}
+		++_offset;
+	}
+	return Fail();
+}
+
+bool JsonTape::ParseLiteral(std::string_view literal) {
+	if (_text.substr(_offset, literal.size()) != literal) {
+		return Fail();
+	}
+	_offset += literal.size();
+	return true;
+}
+
+bool JsonTape::ParseNumber(std::string_view &text) {
+	size_t begin = _offset;
+	while (_offset < _text.size()) {
+		char c = _text[_offset];
+		bool isNumberChar = (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+		if (!isNumberChar) {
+			break;
+		}
+		++_offset;
+	}
+	if (_offset == begin) {
+		return Fail();
+	}
+	text = _text.substr(begin, _offset - begin);
+	return true;
+}
+
+void JsonTape::SkipWhitespace() {
+	while (_offset < _text.size()) {
+		char c = _text[_offset];
+		if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+			++_offset;
+		} else if (c == '/' && _text.substr(_offset, 2) == "//") {
+			size_t lineEnd = _text.find('\n', _offset);
+			_offset = (lineEnd != std::string_view::npos) ? lineEnd + 1 : _text.size();
+		} else if (c == '/' && _text.substr(_offset, 2) == "/*") {
+			size_t commentEnd = _text.find("*/", _offset + 2);
+			_offset = (commentEnd != std::string_view::npos) ? commentEnd + 2 : _text.size();
+		} else {
+			break;
+		}
+	}
+}
+
+bool JsonTape::Fail() {
+	_errorOffset = _offset;
+	return false;
+}
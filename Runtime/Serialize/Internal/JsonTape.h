@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class JsonType : uint8_t {
+    kNull,
+    kBool,
+    kNumber,
+    kString,
+    kArray,
+    kObject,
+};
+
+// One value of the document. The nodes are stored in document order, the children of an array or
+// an object follow it and 'end' is the index after its last descendant, so the next sibling of a
+// node is 'end'. The views point into the parsed text, nothing is copied.
+struct JsonNode {
+    JsonType type = JsonType::kNull;
+    bool hasEscape = false;    // 'text' is a string still to be unescaped
+    uint32_t end = 0;
+    uint64_t keyHash = 0;      // FNV-1a of the unescaped key, for the members of an object
+    std::string_view key;
+    std::string_view text;     // the number, the 'true' / 'false' or the string without its quotes
+};
+
+// A single pass parser that turns a JSON text into a flat array of nodes. It accepts what the
+// transfer writers emit plus the comments jsoncpp allowed in hand edited files.
+class JsonTape {
+public:
+    // 'text' has to outlive the tape
+    bool Parse(std::string_view text);
+    void Clear();
+    auto GetNode(uint32_t index) const -> const JsonNode & {
+        return _nodes[index];
+    }
+    auto GetNodeCount() const -> uint32_t {
+        return static_cast<uint32_t>(_nodes.size());
+    }
+    auto GetErrorOffset() const -> size_t {
+        return _errorOffset;
+    }
+    static auto Unescape(std::string_view text) -> std::string;
+private:
+    bool ParseValue(uint32_t depth);
+    bool ParseString(std::string_view &text, bool &hasEscape);
+    bool ParseLiteral(std::string_view literal);
+    bool ParseNumber(std::string_view &text);
+    void SkipWhitespace();
+    bool Fail();
+private:
+    std::string_view _text;
+    size_t _offset = 0;
+    size_t _errorOffset = 0;
+    std::vector<JsonNode> _nodes;
+    std::deque<std::string> _unescapedKeys;
+};
@@ -1,6 +1,9 @@
 #pragma once
+#include <cstddef>
+#include <span>
 #include <string_view>
 #include <unordered_map>
+#include "Foundation/Hash.hpp"
 #include "Foundation/NonCopyable.h"
 #include "Foundation/TypeAlias.h"
 #include "Foundation/NamespeceAlias.h"
@@ -8,6 +11,19 @@
 template<typename T>
 struct TransferHelper;
 
+// A field name and its FNV-1a hash. Names spelled as literals, which is what TRANSFER passes, are
+// hashed at compile time, so the JSON reader finds a field by comparing hashes only.
+struct TransferName {
+    std::string_view string;
+    uint64_t hash = 0;
+public:
+    template<size_t N>
+    consteval TransferName(const char (&name)[N]) : string(name, N - 1), hash(nstd::FNV1a64(string)) {
+    }
+    constexpr TransferName(std::string_view name) : string(name), hash(nstd::FNV1a64(name)) {
+    }
+};
+
 struct ITransferWriter {
     consteval static bool IsReading() {
         return false;
@@ -20,6 +36,14 @@ struct ITransferReader {
     }
 };
 
+// The storage behind a 'TransferBytes' call. Writers only read 'GetBytes'; readers call 'Resize' with
+// the stored size first, a storage that can't take that size returns false and keeps its content.
+class ITransferBytes {
+public:
+    virtual auto GetBytes() -> std::span<std::byte> = 0;
+    virtual bool Resize(size_t size) = 0;
+};
+
 class TransferBase : public NonCopyable {
 public:
     TransferBase(const stdfs::path &path) : _sourceFilePath(path) {
@@ -31,22 +55,27 @@ public:
         _currentVersion = version;
     }
 
-    virtual void Transfer(std::string_view name, bool &data) = 0;
+    virtual void Transfer(TransferName name, bool &data) = 0;
+
+    virtual void Transfer(TransferName name, uint8 &data) = 0;
+    virtual void Transfer(TransferName name, uint16 &data) = 0;
+    virtual void Transfer(TransferName name, uint32 &data) = 0;
+    virtual void Transfer(TransferName name, uint64 &data) = 0;
 
-    virtual void Transfer(std::string_view name, uint8 &data) = 0;
-    virtual void Transfer(std::string_view name, uint16 &data) = 0;
-    virtual void Transfer(std::string_view name, uint32 &data) = 0;
-    virtual void Transfer(std::string_view name, uint64 &data) = 0;
+    virtual void Transfer(TransferName name, int8 &data) = 0;
+    virtual void Transfer(TransferName name, int16 &data) = 0;
+    virtual void Transfer(TransferName name, int32 &data) = 0;
+    virtual void Transfer(TransferName name, int64 &data) = 0;
 
-    virtual void Transfer(std::string_view name, int8 &data) = 0;
-    virtual void Transfer(std::string_view name, int16 &data) = 0;
-    virtual void Transfer(std::string_view name, int32 &data) = 0;
-    virtual void Transfer(std::string_view name, int64 &data) = 0;
+    virtual void Transfer(TransferName name, float &data) = 0;
+    virtual void Transfer(TransferName name, double &data) = 0;
 
-    virtual void Transfer(std::string_view name, float &data) = 0;
-    virtual void Transfer(std::string_view name, double &data) = 0;
+    virtual void Transfer(TransferName name, std::string &data) = 0;
 
-    virtual void Transfer(std::string_view name, std::string &data) = 0;
+    // trivially copyable data in one piece: raw in the binary backend and base64 in the JSON one
+    virtual void TransferBytes(TransferName name, ITransferBytes &bytes) = 0;
+    // whether an optional field follows: writers get 'hasValue' back, readers what was stored
+    virtual bool TransferOptional(TransferName name, bool hasValue) = 0;
 
     virtual bool BeginTransfer() = 0;
     virtual bool EndTransfer() {
@@ -76,6 +105,8 @@ concept TransferContextConcept = std::is_base_of_v<TransferBase, T>;
 
 class TransferJsonReader;
 class TransferJsonWriter;
+class TransferBinaryReader;
+class TransferBinaryWriter;
 
 #define DECLARE_SERIALIZER(Type)                                                                                       \
 private:                                                                                                               \
@@ -89,14 +120,18 @@ public:
 
 #define IMPLEMENT_SERIALIZER(Type)                                                                                     \
     template void Type::TransferImpl<TransferJsonWriter>(TransferJsonWriter & transfer);                               \
-    template void Type::TransferImpl<TransferJsonReader>(TransferJsonReader & transfer);
+    template void Type::TransferImpl<TransferJsonReader>(TransferJsonReader & transfer);                               \
+    template void Type::TransferImpl<TransferBinaryWriter>(TransferBinaryWriter & transfer);                           \
+    template void Type::TransferImpl<TransferBinaryReader>(TransferBinaryReader & transfer);
 
 #define DECLARE_VIRTUAL_SERIALIZER(Type)                                                                               \
 public:                                                                                                                \
     template<TransferContextConcept T>                                                                                 \
     void TransferImpl(T &transfer);                                                                                    \
     virtual void Transfer(TransferJsonWriter &transfer);                                                               \
-    virtual void Transfer(TransferJsonReader &transfer);
+    virtual void Transfer(TransferJsonReader &transfer);                                                               \
+    virtual void Transfer(TransferBinaryWriter &transfer);                                                             \
+    virtual void Transfer(TransferBinaryReader &transfer);
 
 #define IMPLEMENT_VIRTUAL_SERIALIZER(Type)                                                                             \
     void Type::Transfer(TransferJsonWriter &transfer) {                                                                \
@@ -104,6 +139,12 @@ public:
     }                                                                                                                  \
     void Type::Transfer(TransferJsonReader &transfer) {                                                                \
         Type::TransferImpl(transfer);                                                                                  \
+    }                                                                                                                  \
+    void Type::Transfer(TransferBinaryWriter &transfer) {                                                              \
+        Type::TransferImpl(transfer);                                                                                  \
+    }                                                                                                                  \
+    void Type::Transfer(TransferBinaryReader &transfer) {                                                              \
+        Type::TransferImpl(transfer);                                                                                  \
     }
 
 #define TRANSFER(field) TransferHelper<decltype(this->field)>::Transfer(transfer, #field, this->field)
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include "Foundation/TypeTraits.hpp"
+
+// The binary layout is positional: the fields follow each other in the order 'TransferImpl' visits
+// them, without names or type tags, so only the code that wrote a file can read it back. Versions
+// are stored inline where 'TransferVersion' is called. Scalars are stored as their native little
+// endian bytes, strings and containers are prefixed with a uint32 element count.
+namespace BinaryTransferDetail {
+
+constexpr uint32_t kFileMagic = 0x42525456;    // "VTRB"
+constexpr uint32_t kFormatVersion = 1;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint64_t payloadSize;
+};
+
+template<typename T>
+concept IsScalar = std::is_arithmetic_v<T>;
+
+// elements whose bytes are the whole value, a vector of them is written with a single copy
+template<typename T>
+concept IsBulkElement = IsScalar<T> && !std::is_same_v<T, bool>;
+
+template<typename T>
+concept IsBulkVector = IsStdVector<T>::value && IsBulkElement<typename T::value_type>;
+
+template<typename T>
+concept IsStdVectorOrList = IsStdVector<T>::value || IsStdList<T>::value;
+
+template<typename T>
+concept IsSetContainer = IsStdSet<T>::value || IsStdMultiSet<T>::value || IsStdUnorderedSet<T>::value ||
+                         IsStdUnorderedMultiSet<T>::value;
+
+template<typename T>
+concept IsMapContainer = IsStdMap<T>::value || IsStdMultiMap<T>::value || IsStdUnorderedMap<T>::value ||
+                         IsStdUnorderedMultiMap<T>::value;
+
+template<typename T>
+concept IsContainer = IsStdVectorOrList<T> || IsSetContainer<T> || IsMapContainer<T>;
+
+}    // namespace BinaryTransferDetail
@@ -0,0 +1,71 @@
+#include "Serialize/Transfer.hpp"
+#include "Foundation/Exception.h"
+#include <fstream>
+
+void TransferBinaryReader::TransferVersion(std::string_view name, int version) {
+	int32 storedVersion = 0;
+	TransferValue(storedVersion);
+	SetVersion(name, storedVersion);
+	_currentVersion = storedVersion;
+}
+
+bool TransferBinaryReader::BeginTransfer() {
+	std::ifstream input(_sourceFilePath, std::ios::binary | std::ios::ate);
+	if (!input.is_open()) {
+		return false;
+	}
+
+	auto fileSize = static_cast<size_t>(input.tellg());
+	BinaryTransferDetail::FileHeader header = {};
+	if (fileSize < sizeof(header)) {
+		return false;
+	}
+	input.seekg(0);
+	input.read(reinterpret_cast<char *>(&header), sizeof(header));
+	if (header.magic != BinaryTransferDetail::kFileMagic ||
+		header.formatVersion != BinaryTransferDetail::kFormatVersion ||
+		header.payloadSize != fileSize - sizeof(header)) {
+		return false;
+	}
+
+	_buffer.resize(header.payloadSize);
+	input.read(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+	_offset = 0;
+	_failed = !input.good();
+	return !_failed;
+}
+
+bool TransferBinaryReader::EndTransfer() {
+	bool succeeded = !_failed && _offset == _buffer.size();
+	_buffer.clear();
+	_offset = 0;
+	_failed = false;
+	TransferBase::EndTransfer();
+	return succeeded;
+}
+
+void TransferBinaryReader::TransferBytes(TransferName name, ITransferBytes &bytes) {
+	size_t size = 0;
+	if (!ReadCount(size, 1)) {
+		return;
+	}
+	if (!bytes.Resize(size)) {
+		// the size is known, so only this field is lost and the rest still lines up
+		_offset += size;
+		return;
+	}
+	ReadBytes(bytes.GetBytes().data(), size);
+}
+
+bool TransferBinaryReader::ReadCount(size_t &count, size_t minElementSize) {
+	uint32 storedCount = 0;
+	if (!TransferValue(storedCount)) {
+		return false;
+	}
+	if (storedCount > (_buffer.size() - _offset) / minElementSize) {
+		_failed = true;
+		return false;
+	}
+	count = storedCount;
+	return true;
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <cstring>
+#include <vector>
+#include "TransferBinaryFormat.hpp"
+
+class TransferBinaryReader;
+
+namespace BinaryReadDetail {
+
+template<typename T>
+concept InvokeObjectTransfer = requires(T a) { a.Transfer(std::declval<TransferBinaryReader &>()); };
+
+}    // namespace BinaryReadDetail
+
+// Reads what TransferBinaryWriter wrote with the same 'TransferImpl'. Running past the end of the
+// payload, or stopping short of it, means the layout changed and 'EndTransfer' fails.
+class TransferBinaryReader : public TransferBase, public ITransferReader {
+public:
+    using TransferBase::TransferBase;
+    void TransferVersion(std::string_view name, int version) final;
+    void Transfer(TransferName name, bool &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, uint8 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, uint16 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, uint32 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, uint64 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, int8 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, int16 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, int32 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, int64 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, float &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, double &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, std::string &data) final {
+        TransferValue(data);
+    }
+    void TransferBytes(TransferName name, ITransferBytes &bytes) final;
+    bool TransferOptional(TransferName name, bool hasValue) final {
+        bool storedHasValue = false;
+        TransferValue(storedHasValue);
+        return storedHasValue;
+    }
+    template<BinaryTransferDetail::IsContainer T>
+    void Transfer(TransferName name, T &data) {
+        data.clear();
+        TransferValue(data);
+    }
+
+    template<BinaryReadDetail::InvokeObjectTransfer T>
+    void Transfer(TransferName name, T &data) {
+        TransferValue(data);
+    }
+
+    bool BeginTransfer() final;
+    bool EndTransfer() final;
+private:
+    // a failed read leaves 'pData' untouched and every later read fails too
+    bool ReadBytes(void *pData, size_t size) {
+        if (_failed || size > _buffer.size() - _offset) {
+            _failed = true;
+            return false;
+        }
+        std::memcpy(pData, _buffer.data() + _offset, size);
+        _offset += size;
+        return true;
+    }
+
+    // the count is checked against the remaining bytes, a damaged count can't allocate gigabytes
+    bool ReadCount(size_t &count, size_t minElementSize);
+
+    template<BinaryTransferDetail::IsScalar T>
+    bool TransferValue(T &data) {
+        return ReadBytes(&data, sizeof(T));
+    }
+
+    bool TransferValue(std::string &data) {
+        size_t count = 0;
+        if (!ReadCount(count, sizeof(char))) {
+            return false;
+        }
+        data.resize(count);
+        return ReadBytes(data.data(), count);
+    }
+
+    template<BinaryReadDetail::InvokeObjectTransfer T>
+    bool TransferValue(T &data) {
+        data.Transfer(*this);
+        return !_failed;
+    }
+
+    template<BinaryTransferDetail::IsBulkVector T>
+    bool TransferValue(T &data) {
+        using ElementType = typename T::value_type;
+        size_t count = 0;
+        if (!ReadCount(count, sizeof(ElementType))) {
+            return false;
+        }
+        data.resize(count);
+        return ReadBytes(data.data(), count * sizeof(ElementType));
+    }
+
+    template<BinaryTransferDetail::IsStdVectorOrList T>
+        requires(!BinaryTransferDetail::IsBulkVector<T>)
+    bool TransferValue(T &data) {
+        size_t count = 0;
+        if (!ReadCount(count, 1)) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (!TransferValue(data.emplace_back())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<BinaryTransferDetail::IsSetContainer T>
+    bool TransferValue(T &data) {
+        size_t count = 0;
+        if (!ReadCount(count, 1)) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            typename T::key_type key{};
+            if (!TransferValue(key)) {
+                return false;
+            }
+            data.insert(std::move(key));
+        }
+        return true;
+    }
+
+    template<BinaryTransferDetail::IsMapContainer T>
+    bool TransferValue(T &data) {
+        size_t count = 0;
+        if (!ReadCount(count, 1)) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            using KeyType = typename GetStdMapPair<T>::KeyType;
+            using ValueType = typename GetStdMapPair<T>::ValueType;
+            using PairType = typename GetStdMapPair<T>::PairType;
+            std::pair<KeyType, ValueType> pair;
+            if (!TransferValue(pair)) {
+                return false;
+            }
+            data.insert(PairType(std::move(pair.first), std::move(pair.second)));
+        }
+        return true;
+    }
+
+    template<typename Key, typename Value>
+    bool TransferValue(std::pair<Key, Value> &data) {
+        return TransferValue(data.first) && TransferValue(data.second);
+    }
+private:
+    std::vector<char> _buffer;
+    size_t _offset = 0;
+    bool _failed = false;
+};
+
+static_assert(TransferContextConcept<TransferBinaryReader>);
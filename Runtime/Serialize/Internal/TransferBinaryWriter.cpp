@@ -0,0 +1,36 @@
+#include "Serialize/Transfer.hpp"
+#include "Foundation/Exception.h"
+#include <limits>
+
+void TransferBinaryWriter::TransferVersion(std::string_view name, int version) {
+	TransferBase::TransferVersion(name, version);
+	SetVersion(name, version);
+	TransferValue(static_cast<int32>(version));
+}
+
+bool TransferBinaryWriter::BeginTransfer() {
+	_buffer.clear();
+	BinaryTransferDetail::FileHeader header = {};
+	WriteBytes(&header, sizeof(header));
+	return true;
+}
+
+bool TransferBinaryWriter::EndTransfer() {
+	BinaryTransferDetail::FileHeader header = {};
+	header.magic = BinaryTransferDetail::kFileMagic;
+	header.formatVersion = BinaryTransferDetail::kFormatVersion;
+	header.payloadSize = _buffer.size() - sizeof(header);
+	std::memcpy(_buffer.data(), &header, sizeof(header));
+
+	AsyncFileWriter::File file = gAsyncFileWriter->Open(_sourceFilePath);
+	file.Append(std::move(_buffer));
+	_buffer = std::string();
+	_future = file.Commit(std::move(_callback));
+	TransferBase::EndTransfer();
+	return _async || _future.get();
+}
+
+void TransferBinaryWriter::WriteCount(size_t count) {
+	Exception::CondThrow(count <= std::numeric_limits<uint32>::max(), "too many elements to transfer!");
+	TransferValue(static_cast<uint32>(count));
+}
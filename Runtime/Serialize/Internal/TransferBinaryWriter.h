@@ -0,0 +1,139 @@
+#pragma once
+#include <cstring>
+#include <string>
+#include "TransferBinaryFormat.hpp"
+#include "Foundation/AsyncFileWriter.h"
+
+class TransferBinaryWriter;
+
+namespace BinaryWriteDetail {
+
+template<typename T>
+concept InvokeObjectTransfer = requires(T a) { a.Transfer(std::declval<TransferBinaryWriter &>()); };
+
+}    // namespace BinaryWriteDetail
+
+class TransferBinaryWriter : public TransferBase, public ITransferWriter {
+public:
+    using TransferBase::TransferBase;
+    void TransferVersion(std::string_view name, int version) final;
+    void Transfer(TransferName name, bool &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, uint8 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, uint16 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, uint32 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, uint64 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, int8 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, int16 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, int32 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, int64 &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, float &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, double &data) final {
+        TransferValue(data);
+    }
+    void Transfer(TransferName name, std::string &data) final {
+        TransferValue(data);
+    }
+    void TransferBytes(TransferName name, ITransferBytes &bytes) final {
+        std::span<std::byte> data = bytes.GetBytes();
+        WriteCount(data.size());
+        WriteBytes(data.data(), data.size());
+    }
+    bool TransferOptional(TransferName name, bool hasValue) final {
+        TransferValue(hasValue);
+        return hasValue;
+    }
+    template<BinaryTransferDetail::IsContainer T>
+    void Transfer(TransferName name, T &data) {
+        TransferValue(data);
+    }
+
+    template<BinaryWriteDetail::InvokeObjectTransfer T>
+    void Transfer(TransferName name, T &data) {
+        TransferValue(data);
+    }
+
+    bool BeginTransfer() final;
+    bool EndTransfer() final;
+
+    // EndTransfer returns once the file is queued instead of waiting for it to be written,
+    // the result goes to 'callback' on the I/O thread and to GetFuture
+    void SetAsync(AsyncFileWriter::Callback callback = nullptr) {
+        _async = true;
+        _callback = std::move(callback);
+    }
+    auto GetFuture() const -> const std::shared_future<bool> & {
+        return _future;
+    }
+private:
+    void WriteBytes(const void *pData, size_t size) {
+        size_t offset = _buffer.size();
+        _buffer.resize(offset + size);
+        std::memcpy(_buffer.data() + offset, pData, size);
+    }
+
+    void WriteCount(size_t count);
+
+    template<BinaryTransferDetail::IsScalar T>
+    void TransferValue(const T &data) {
+        WriteBytes(&data, sizeof(T));
+    }
+
+    void TransferValue(const std::string &data) {
+        WriteCount(data.size());
+        WriteBytes(data.data(), data.size());
+    }
+
+    template<BinaryWriteDetail::InvokeObjectTransfer T>
+    void TransferValue(T &data) {
+        data.Transfer(*this);
+    }
+
+    template<BinaryTransferDetail::IsBulkVector T>
+    void TransferValue(T &data) {
+        WriteCount(data.size());
+        WriteBytes(data.data(), data.size() * sizeof(typename T::value_type));
+    }
+
+    template<BinaryTransferDetail::IsContainer T>
+        requires(!BinaryTransferDetail::IsBulkVector<T>)
+    void TransferValue(T &data) {
+        WriteCount(data.size());
+        for (auto &item : data) {
+            TransferValue(item);
+        }
+    }
+
+    template<typename Key, typename Value>
+    void TransferValue(std::pair<Key, Value> &pair) {
+        // the key of a map element is const, the writer never modifies it
+        TransferValue(const_cast<std::remove_const_t<Key> &>(pair.first));
+        TransferValue(pair.second);
+    }
+private:
+    bool _async = false;
+    AsyncFileWriter::Callback _callback;
+    std::shared_future<bool> _future;
+    std::string _buffer;    // a string, so it moves to the I/O thread as a single chunk
+};
+
+static_assert(TransferContextConcept<TransferBinaryWriter>);
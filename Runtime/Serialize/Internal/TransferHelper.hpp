@@ -1,13 +1,78 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include "TransferBase.hpp"
 #include "Foundation/NamespeceAlias.h"
 #include "Foundation/TypeTraits.hpp"
 
+namespace TransferHelperDetail {
+
+template<typename T>
+concept HasTransferFunc = requires(T a) { a.Transfer(std::declval<TransferJsonWriter &>()); };
+
+// plain data the backends have no field by field form for, moved as raw bytes
+template<typename T>
+concept IsBulkElement = std::is_trivially_copyable_v<T> && !std::is_arithmetic_v<T> && !std::is_enum_v<T> &&
+                        !std::is_pointer_v<T> && !HasTransferFunc<T>;
+
+template<typename T, typename Alloc>
+class VectorBytes : public ITransferBytes {
+public:
+    explicit VectorBytes(std::vector<T, Alloc> &data) : _data(data) {
+    }
+    auto GetBytes() -> std::span<std::byte> override {
+        return std::as_writable_bytes(std::span(_data));
+    }
+    bool Resize(size_t size) override {
+        if (size % sizeof(T) != 0) {
+            return false;
+        }
+        _data.resize(size / sizeof(T));
+        return true;
+    }
+private:
+    std::vector<T, Alloc> &_data;
+};
+
+class FixedBytes : public ITransferBytes {
+public:
+    explicit FixedBytes(std::span<std::byte> bytes) : _bytes(bytes) {
+    }
+    auto GetBytes() -> std::span<std::byte> override {
+        return _bytes;
+    }
+    bool Resize(size_t size) override {
+        return size == _bytes.size();
+    }
+private:
+    std::span<std::byte> _bytes;
+};
+
+// a fixed number of elements goes through a std::vector, which JSON keeps as a readable array
+template<TransferContextConcept Transfer, typename T>
+void TransferElements(Transfer &transfer, TransferName name, std::span<T> data) {
+    std::vector<T> elements(data.begin(), data.end());
+    transfer.Transfer(name, elements);
+    if constexpr (transfer.IsReading()) {
+        if (elements.size() == data.size()) {
+            std::ranges::move(elements, data.begin());
+        }
+    }
+}
+
+}    // namespace TransferHelperDetail
+
 template<typename T>
 struct TransferHelper {
     template<TransferContextConcept Transfer>
-        requires requires { std::declval<Transfer &>().Transfer(std::string_view{}, std::declval<T &>()); }
-    static void Transfer(Transfer &transfer, std::string_view name, T &data) {
+        requires requires { std::declval<Transfer &>().Transfer(std::declval<TransferName>(), std::declval<T &>()); }
+    static void Transfer(Transfer &transfer, TransferName name, T &data) {
         transfer.Transfer(name, data);
     }
 };
@@ -16,7 +81,7 @@ template<>
 struct TransferHelper<stdfs::path> {
 public:
     template<TransferContextConcept T>
-    static void Transfer(T &transfer, std::string_view name, stdfs::path &data) {
+    static void Transfer(T &transfer, TransferName name, stdfs::path &data) {
         if constexpr (transfer.IsReading()) {
             std::string string;
             transfer.Transfer(name, string);
@@ -31,8 +96,84 @@ public:
 template<Enumerable T>
 struct TransferHelper<T> {
     template<TransferContextConcept Transfer>
-    static void Transfer(Transfer &transfer, std::string_view name, T &data) {
+    static void Transfer(Transfer &transfer, TransferName name, T &data) {
         using NativeType = std::underlying_type_t<T>;
-        transfer.transfer(name, static_cast<NativeType &>(data));
+        NativeType value = static_cast<NativeType>(data);
+        transfer.Transfer(name, value);
+        data = static_cast<T>(value);
+    }
+};
+
+template<typename T, typename Alloc>
+    requires TransferHelperDetail::IsBulkElement<T>
+struct TransferHelper<std::vector<T, Alloc>> {
+    template<TransferContextConcept Transfer>
+    static void Transfer(Transfer &transfer, TransferName name, std::vector<T, Alloc> &data) {
+        TransferHelperDetail::VectorBytes<T, Alloc> bytes(data);
+        transfer.TransferBytes(name, bytes);
+    }
+};
+
+template<typename T, size_t N>
+struct TransferHelper<std::array<T, N>> {
+    template<TransferContextConcept Transfer>
+    static void Transfer(Transfer &transfer, TransferName name, std::array<T, N> &data) {
+        if constexpr (TransferHelperDetail::IsBulkElement<T>) {
+            TransferHelperDetail::FixedBytes bytes(std::as_writable_bytes(std::span(data)));
+            transfer.TransferBytes(name, bytes);
+        } else {
+            TransferHelperDetail::TransferElements(transfer, name, std::span<T>(data));
+        }
+    }
+};
+
+// the span keeps its size, a reader only fills it when the stored data has exactly that size
+template<typename T, size_t Extent>
+    requires(TransferHelperDetail::IsBulkElement<T> || std::is_arithmetic_v<T>)
+struct TransferHelper<std::span<T, Extent>> {
+    template<TransferContextConcept Transfer>
+    static void Transfer(Transfer &transfer, TransferName name, std::span<T, Extent> &data) {
+        TransferHelperDetail::FixedBytes bytes(std::as_writable_bytes(data));
+        transfer.TransferBytes(name, bytes);
+    }
+};
+
+template<typename T>
+struct TransferHelper<std::optional<T>> {
+    template<TransferContextConcept Transfer>
+    static void Transfer(Transfer &transfer, TransferName name, std::optional<T> &data) {
+        if (!transfer.TransferOptional(name, data.has_value())) {
+            data.reset();
+            return;
+        }
+        if (!data.has_value()) {
+            data.emplace();
+        }
+        TransferHelper<T>::Transfer(transfer, name, *data);
+    }
+};
+
+// a single glm value is an array of its components, std::vector<glm::vec3> and the like are bulk data
+template<glm::length_t L, typename T, glm::qualifier Q>
+struct TransferHelper<glm::vec<L, T, Q>> {
+    template<TransferContextConcept Transfer>
+    static void Transfer(Transfer &transfer, TransferName name, glm::vec<L, T, Q> &data) {
+        TransferHelperDetail::TransferElements(transfer, name, std::span<T>(glm::value_ptr(data), L));
+    }
+};
+
+template<glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+struct TransferHelper<glm::mat<C, R, T, Q>> {
+    template<TransferContextConcept Transfer>
+    static void Transfer(Transfer &transfer, TransferName name, glm::mat<C, R, T, Q> &data) {
+        TransferHelperDetail::TransferElements(transfer, name, std::span<T>(glm::value_ptr(data), C * R));
     }
-};
\ No newline at end of file
+};
+
+template<typename T, glm::qualifier Q>
+struct TransferHelper<glm::qua<T, Q>> {
+    template<TransferContextConcept Transfer>
+    static void Transfer(Transfer &transfer, TransferName name, glm::qua<T, Q> &data) {
+        TransferHelperDetail::TransferElements(transfer, name, std::span<T>(glm::value_ptr(data), 4));
+    }
+};
@@ -1,5 +1,8 @@
 #include "Serialize/Transfer.hpp"
+#include "Foundation/Base64.h"
 #include "Foundation/Exception.h"
+#include "Foundation/Logger.h"
+#include <cstring>
 #include <fstream>
 
 void TransferJsonReader::TransferVersion(std::string_view name, int version) {
@@ -7,47 +10,107 @@ void TransferJsonReader::TransferVersion(std::string_view name, int version) {
 }
 
 bool TransferJsonReader::BeginTransfer() {
-    std::ifstream input(_sourceFilePath);
+    std::ifstream input(_sourceFilePath, std::ios::binary | std::ios::ate);
     if (!input.is_open()) {
 	    return false;
     }
 
-    JSONCPP_STRING errs;
-    Json::CharReaderBuilder builder;
-    if (!parseFromStream(builder, input, &_root, &errs)) {
+    _text.resize(static_cast<size_t>(input.tellg()));
+    input.seekg(0);
+    input.read(_text.data(), static_cast<std::streamsize>(_text.size()));
+    if (!input.good()) {
+        return false;
+    }
+    if (!_tape.Parse(_text)) {
+        Logger::Warning("Can't parse the json file {} at offset {}", _sourceFilePath.string(), _tape.GetErrorOffset());
+        return false;
+    }
+    PushJsonValue(0);
+    if (GetCurrentJsonValue().type != JsonType::kObject) {
         return false;
     }
-    _stack.push_back(&_root);
 
     if (PushJsonValue("__VersionMap")) {
-	    Json::Value &versionObject = GetCurrentJsonValue();
-	    for (Json::Value &element : versionObject) {
-	        std::string key = element["Name"].asCString();
-	        int version = element["Version"].asInt();
-	        _versionMap[key] = version;
-	    }
-	    PopJsonValue();
+        const JsonNode &versionArray = GetCurrentJsonValue();
+        uint32_t element = _stack.back().index + 1;
+        for (; versionArray.type == JsonType::kArray && element < versionArray.end; element = GetNextSibling(element)) {
+            PushJsonValue(element);
+            std::string key;
+            int version = 0;
+            TransferValueWithName("Name", key);
+            TransferValueWithName("Version", version);
+            _versionMap[key] = version;
+            PopJsonValue();
+        }
+        PopJsonValue();
     }
     return true;
 }
 
 bool TransferJsonReader::EndTransfer() {
     _stack.clear();
-    _root = Json::ValueType::nullValue;
+    _tape.Clear();
+    _text.clear();
 	TransferBase::EndTransfer();
     return true;
 }
 
-void TransferJsonReader::PushJsonValue(Json::Value &value) {
-    _stack.push_back(&value);
+void TransferJsonReader::TransferBytes(TransferName name, ITransferBytes &bytes) {
+    if (!PushJsonValue(name)) {
+        return;
+    }
+    const JsonNode &node = GetCurrentJsonValue();
+    std::optional<size_t> pSize;
+    if (node.type == JsonType::kString && !node.hasEscape) {
+        pSize = nstd::Base64DecodedSize(node.text);
+    }
+    // decoded aside first, so bad text leaves the destination untouched
+    std::vector<std::byte> decoded(pSize.value_or(0));
+    if (pSize.has_value() && !nstd::Base64Decode(node.text, decoded)) {
+        Logger::Warning("The field {} of {} is not valid base64", name.string, _sourceFilePath.string());
+    } else if (pSize.has_value() && bytes.Resize(*pSize) && !decoded.empty()) {
+        std::memcpy(bytes.GetBytes().data(), decoded.data(), decoded.size());
+    }
+    PopJsonValue();
 }
 
-bool TransferJsonReader::PushJsonValue(std::string_view name) {
-    Json::Value &value = GetCurrentJsonValue();
-    if (value.isMember(name.data())) {
-        _stack.push_back(&value[name.data()]);
-        return true;
+bool TransferJsonReader::TransferOptional(TransferName name, bool hasValue) {
+    // the value is read right after, from the same place
+    uint32_t cursor = _stack.back().cursor;
+    if (!PushJsonValue(name)) {
+        return false;
     }
+    bool isNull = (GetCurrentJsonValue().type == JsonType::kNull);
+    PopJsonValue();
+    _stack.back().cursor = cursor;
+    return !isNull;
+}
+
+void TransferJsonReader::PushJsonValue(uint32_t index) {
+    _stack.push_back({index, index + 1});
+}
+
+bool TransferJsonReader::PushJsonValue(TransferName name) {
+    StackItem &item = _stack.back();
+    const JsonNode &object = _tape.GetNode(item.index);
+    if (object.type != JsonType::kObject || object.end == item.index + 1) {
+        return false;
+    }
+
+    // start after the member found last and wrap around once
+    uint32_t firstMember = item.index + 1;
+    uint32_t startMember = (item.cursor < object.end) ? item.cursor : firstMember;
+    uint32_t member = startMember;
+    do {
+        const JsonNode &node = _tape.GetNode(member);
+        uint32_t next = GetNextSibling(member);
+        if (node.keyHash == name.hash && node.key == name.string) {
+            item.cursor = next;
+            _stack.push_back({member, member + 1});
+            return true;
+        }
+        member = (next < object.end) ? next : firstMember;
+    } while (member != startMember);
     return false;
 }
 
@@ -56,6 +119,10 @@ void TransferJsonReader::PopJsonValue() {
     _stack.pop_back();
 }
 
-auto TransferJsonReader::GetCurrentJsonValue() const -> Json::Value & {
-    return *_stack.back();
+auto TransferJsonReader::GetCurrentJsonValue() const -> const JsonNode & {
+    return _tape.GetNode(_stack.back().index);
+}
+
+auto TransferJsonReader::GetNextSibling(uint32_t index) const -> uint32_t {
+    return _tape.GetNode(index).end;
 }
@@ -1,5 +1,11 @@
 #pragma once
-#include <json/json.h>
+#include <charconv>
+#include <limits>
+#include <string>
+#include <vector>
+#include "JsonTape.h"
+
+class TransferJsonReader;
 
 namespace JsonReaderDetail {
 
@@ -27,57 +33,64 @@ concept InvokeObjectTransfer = requires(T a) {
 
 }    // namespace JsonReaderDetail
 
+// Parses the whole file into a JsonTape once, then walks it: a field is found by comparing the
+// compile time hash of its TransferName with the key hashes of the current object. Objects are
+// searched from the member after the last one found, so fields read in the order they were written
+// cost one comparison each. Missing fields and values of the wrong type leave the data untouched.
 class TransferJsonReader : public TransferBase, public ITransferReader {
 public:
     using TransferBase::TransferBase;
     void TransferVersion(std::string_view name, int version) final;
-    void Transfer(std::string_view name, bool &data) final {
+    void Transfer(TransferName name, bool &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, uint8 &data) final {
+    void Transfer(TransferName name, uint8 &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, uint16 &data) final {
+    void Transfer(TransferName name, uint16 &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, uint32 &data) final {
+    void Transfer(TransferName name, uint32 &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, uint64 &data) final {
+    void Transfer(TransferName name, uint64 &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, int8 &data) final {
+    void Transfer(TransferName name, int8 &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, int16 &data) final {
+    void Transfer(TransferName name, int16 &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, int32 &data) final {
+    void Transfer(TransferName name, int32 &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, int64 &data) final {
+    void Transfer(TransferName name, int64 &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, float &data) final {
+    void Transfer(TransferName name, float &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, double &data) final {
+    void Transfer(TransferName name, double &data) final {
         TransferValueWithName(name, data);
     }
-    void Transfer(std::string_view name, std::string &data) final {
+    void Transfer(TransferName name, std::string &data) final {
         TransferValueWithName(name, data);
     }
 
     template<JsonReaderDetail::InvokeObjectTransfer T>
-    void Transfer(std::string_view name, T &data) {
+    void Transfer(TransferName name, T &data) {
         TransferValueWithName(name, data);
     }
 
+    void TransferBytes(TransferName name, ITransferBytes &bytes) final;
+    bool TransferOptional(TransferName name, bool hasValue) final;
+
     bool BeginTransfer() final;
     bool EndTransfer() final;
 
     template<JsonReaderDetail::IsContainer T>
-    void Transfer(std::string_view name, T &data) {
+    void Transfer(TransferName name, T &data) {
         data.clear();
         if (!PushJsonValue(name)) {
             return;
@@ -85,14 +98,9 @@ public:
         TransferValue(data);
         PopJsonValue();
     }
-
-    void PushJsonValue(Json::Value &value);
-    bool PushJsonValue(std::string_view name);
-    void PopJsonValue();
-    auto GetCurrentJsonValue() const -> Json::Value &;
 private:
     template<typename T>
-    void TransferValueWithName(std::string_view name, T &data) {
+    void TransferValueWithName(TransferName name, T &data) {
         if (!PushJsonValue(name)) {
             return;
         }
@@ -101,18 +109,18 @@ private:
     }
 
     bool TransferValue(bool &data) {
-        Json::Value &value = GetCurrentJsonValue();
-        if (value.isBool()) {
-            data = value.asBool();
+        const JsonNode &node = GetCurrentJsonValue();
+        if (node.type == JsonType::kBool) {
+            data = (node.text == "true");
             return true;
         }
         return false;
     }
 
     bool TransferValue(std::string &data) {
-        Json::Value &value = GetCurrentJsonValue();
-        if (value.isString()) {
-            data = value.asCString();
+        const JsonNode &node = GetCurrentJsonValue();
+        if (node.type == JsonType::kString) {
+            data = node.hasEscape ? JsonTape::Unescape(node.text) : std::string(node.text);
             return true;
         }
         return false;
@@ -120,21 +128,47 @@ private:
 
     template<JsonReaderDetail::IsJsonNumber T>
     bool TransferValue(T &data) {
-        Json::Value &value = GetCurrentJsonValue();
-        if (value.isNumeric()) {
-            data = static_cast<T>(value.asDouble());
-            return true;
+        const JsonNode &node = GetCurrentJsonValue();
+        if (node.type != JsonType::kNumber) {
+            return false;
         }
-        return false;
+        const char *pEnd = node.text.data() + node.text.size();
+        if constexpr (std::is_integral_v<T>) {
+            // integers are read exactly, only a value like '1e3' or '2.0' goes through double
+            if (node.text.find_first_of(".eE") == std::string_view::npos) {
+                T value = 0;
+                std::from_chars_result result = std::from_chars(node.text.data(), pEnd, value);
+                if (result.ec != std::errc() || result.ptr != pEnd) {
+                    return false;
+                }
+                data = value;
+                return true;
+            }
+        }
+        double value = 0.0;
+        std::from_chars_result result = std::from_chars(node.text.data(), pEnd, value);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        if constexpr (std::is_integral_v<T>) {
+            // max + 1 is a power of two and exact as double, the cast is only defined inside the range
+            constexpr double kMin = static_cast<double>(std::numeric_limits<T>::min());
+            constexpr double kMaxExclusive = static_cast<double>(std::numeric_limits<T>::max() / 2 + 1) * 2.0;
+            if (!(value >= kMin && value < kMaxExclusive)) {
+                return false;
+            }
+        }
+        data = static_cast<T>(value);
+        return true;
     }
 
     template<JsonReaderDetail::IsStdVectorOrList T>
     bool TransferValue(T &data) {
-        Json::Value &value = GetCurrentJsonValue();
-        if (!value.isArray()) {
+        const JsonNode &node = GetCurrentJsonValue();
+        if (node.type != JsonType::kArray) {
             return false;
         }
-        for (Json::Value &element : value) {
+        for (uint32_t element = _stack.back().index + 1; element < node.end; element = GetNextSibling(element)) {
             PushJsonValue(element);
             TransferValue(data.emplace_back());
             PopJsonValue();
@@ -144,12 +178,11 @@ private:
 
     template<JsonReaderDetail::IsSetContainer T>
     bool TransferValue(T &data) {
-        Json::Value &value = GetCurrentJsonValue();
-        if (!value.isArray()) {
+        const JsonNode &node = GetCurrentJsonValue();
+        if (node.type != JsonType::kArray) {
             return false;
         }
-
-        for (auto &element : value) {
+        for (uint32_t element = _stack.back().index + 1; element < node.end; element = GetNextSibling(element)) {
             PushJsonValue(element);
             typename T::key_type key{};
             if (TransferValue(key)) {
@@ -162,12 +195,11 @@ private:
 
     template<JsonReaderDetail::IsMapContainer T>
     bool TransferValue(T &data) {
-        Json::Value &value = GetCurrentJsonValue();
-	    if (!value.isArray()) {
+        const JsonNode &node = GetCurrentJsonValue();
+        if (node.type != JsonType::kArray) {
             return false;
         }
-
-        for (auto &element : value) {
+        for (uint32_t element = _stack.back().index + 1; element < node.end; element = GetNextSibling(element)) {
             PushJsonValue(element);
             using KeyType = typename GetStdMapPair<T>::KeyType;
             using ValueType = typename GetStdMapPair<T>::ValueType;
@@ -183,19 +215,19 @@ private:
 
     template<typename Key, typename Value>
     bool TransferValue(std::pair<Key, Value> &data) {
-        Json::Value &value = GetCurrentJsonValue();
-	    if (!value.isObject()) {
-		    return false;
-	    }
+        const JsonNode &node = GetCurrentJsonValue();
+        if (node.type != JsonType::kObject) {
+            return false;
+        }
 
         if (!PushJsonValue("Key")) {
-	        return false;
+            return false;
         }
         bool ret = TransferValue(data.first);
         PopJsonValue();
 
-        if (ret && !PushJsonValue("Value")) {
-	        return false;
+        if (!ret || !PushJsonValue("Value")) {
+            return false;
         }
         ret = TransferValue(data.second);
         PopJsonValue();
@@ -204,10 +236,26 @@ private:
 
     template<JsonReaderDetail::InvokeObjectTransfer T>
     bool TransferValue(T &data) {
-		data.Transfer(*this);
+        if (GetCurrentJsonValue().type != JsonType::kObject) {
+            return false;
+        }
+        data.Transfer(*this);
         return true;
     }
+
+    void PushJsonValue(uint32_t index);
+    bool PushJsonValue(TransferName name);
+    void PopJsonValue();
+    auto GetCurrentJsonValue() const -> const JsonNode &;
+    auto GetNextSibling(uint32_t index) const -> uint32_t;
 private:
-    Json::Value _root;
-    std::vector<Json::Value *> _stack;
+    struct StackItem {
+        uint32_t index;
+        uint32_t cursor;    // the member the next search of this object starts at
+    };
+    std::string _text;
+    JsonTape _tape;
+    std::vector<StackItem> _stack;
 };
+
+static_assert(TransferContextConcept<TransferJsonReader>);
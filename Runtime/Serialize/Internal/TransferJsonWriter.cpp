@@ -1,6 +1,14 @@
 #include "Serialize/Transfer.hpp"
+#include "Foundation/Base64.h"
 #include "Foundation/Exception.h"
-#include <fstream>
+#include <algorithm>
+
+namespace {
+
+// the buffer is handed to the I/O thread once it is this large, so a save costs a handful of jobs
+constexpr size_t kFlushSize = 64 * 1024;
+
+}    // namespace
 
 void TransferJsonWriter::TransferVersion(std::string_view name, int version) {
 	TransferBase::TransferVersion(name, version);
@@ -8,43 +16,147 @@ void TransferJsonWriter::TransferVersion(std::string_view name, int version) {
 }
 
 bool TransferJsonWriter::BeginTransfer() {
-	_stack.emplace_back();
+	// a file that can't be opened shows up as a failed commit
+	_file = gAsyncFileWriter->Open(_sourceFilePath);
+	_buffer.reserve(kFlushSize);
+	BeginScope('{');
 	return true;
 }
 
 bool TransferJsonWriter::EndTransfer() {
-	std::ofstream output(_sourceFilePath);
-	Exception::CondThrow(output.is_open(), "can't open the file!");
-	Exception::CondThrow(_stack.size() == 1, "invalid stack state");
+	Exception::CondThrow(_scopes.size() == 1, "invalid stack state");
 
-	Json::Value versionObject = Json::ValueType::objectValue;
+	WriteKey("__VersionMap");
+	BeginScope('[');
 	for (auto &&[key, version] : _versionMap) {
-		Json::Value object;
-		object["Name"] = key;
-		object["Version"] = version;
-		versionObject.append(object);
+		BeginScope('{');
+		WriteKey("Name");
+		TransferValue(key);
+		WriteKey("Version");
+		TransferValue(version);
+		EndScope('}');
 	}
-	_stack.front()["__VersionMap"] = versionObject;
-
-	Json::StreamWriterBuilder builder;
-	std::unique_ptr<Json::StreamWriter> pWriter(builder.newStreamWriter());
-	pWriter->write(_stack.front(), &output);
+	EndScope(']');
+	EndScope('}');
+	_buffer += '\n';
+	FlushBuffer(true);
 
+	_future = _file.Commit(std::move(_callback));
+	_scopes.clear();
 	TransferBase::EndTransfer();
-	return true;
+	return _async || _future.get();
+}
+
+void TransferJsonWriter::TransferBytes(TransferName name, ITransferBytes &bytes) {
+	WriteKey(name.string);
+	BeginValue();
+	_buffer += '"';
+	// encoded a chunk at a time, a mesh sized payload does not grow the buffer to its own size
+	constexpr size_t kChunkSize = kFlushSize / 4 * 3;
+	std::span<std::byte> data = bytes.GetBytes();
+	for (size_t offset = 0; offset < data.size(); offset += kChunkSize) {
+		nstd::Base64Encode(data.subspan(offset, std::min(kChunkSize, data.size() - offset)), _buffer);
+		FlushBuffer(false);
+	}
+	_buffer += '"';
 }
 
-void TransferJsonWriter::PushJsonValue(Json::ValueType type) {
-	_stack.emplace_back(type);
+void TransferJsonWriter::WriteKey(std::string_view name) {
+	Scope &scope = _scopes.back();
+	if (!scope.isEmpty) {
+		_buffer += ',';
+	}
+	_buffer += '\n';
+	WriteIndent();
+	WriteString(name);
+	_buffer += " : ";
+	scope.isEmpty = false;
+	scope.afterKey = true;
 }
 
-auto TransferJsonWriter::PopJsonValue() -> Json::Value {
-	ExceptionAssert(_stack.size() >= 2);
-	auto obj = std::move(_stack.back());
-	_stack.pop_back();
-	return obj;
+void TransferJsonWriter::WriteString(std::string_view string) {
+	constexpr char kHexDigits[] = "0123456789abcdef";
+	_buffer += '"';
+	for (char c : string) {
+		switch (c) {
+		case '"':
+			_buffer += "\\\"";
+			break;
+		case '\\':
+			_buffer += "\\\\";
+			break;
+		case '\b':
+			_buffer += "\\b";
+			break;
+		case '\f':
+			_buffer += "\\f";
+			break;
+		case '\n':
+			_buffer += "\\n";
+			break;
+		case '\r':
+			_buffer += "\\r";
+			break;
+		case '\t':
+			_buffer += "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20) {
+				_buffer += "\\u00";
+				_buffer += kHexDigits[c >> 4];
+				_buffer += kHexDigits[c & 0xF];
+			} else {
+				_buffer += c;
+			}
+			break;
+		}
+	}
+	_buffer += '"';
 }
 
-auto TransferJsonWriter::GetCurrentJsonValue() -> Json::Value & {
-	return _stack.back();
+void TransferJsonWriter::BeginValue() {
+	if (_scopes.empty()) {
+		return;
+	}
+	Scope &scope = _scopes.back();
+	if (scope.afterKey) {
+		scope.afterKey = false;
+		return;
+	}
+	if (!scope.isEmpty) {
+		_buffer += ',';
+	}
+	_buffer += '\n';
+	WriteIndent();
+	scope.isEmpty = false;
+}
+
+void TransferJsonWriter::BeginScope(char bracket) {
+	BeginValue();
+	_buffer += bracket;
+	_scopes.emplace_back();
+}
+
+void TransferJsonWriter::EndScope(char bracket) {
+	ExceptionAssert(!_scopes.empty());
+	bool isEmpty = _scopes.back().isEmpty;
+	_scopes.pop_back();
+	if (!isEmpty) {
+		_buffer += '\n';
+		WriteIndent();
+	}
+	_buffer += bracket;
+	FlushBuffer(false);
+}
+
+void TransferJsonWriter::WriteIndent() {
+	_buffer.append(_scopes.size(), '\t');
+}
+
+void TransferJsonWriter::FlushBuffer(bool force) {
+	if (force || _buffer.size() >= kFlushSize) {
+		_file.Append(std::move(_buffer));
+		_buffer = std::string();
+		_buffer.reserve(kFlushSize);
+	}
 }
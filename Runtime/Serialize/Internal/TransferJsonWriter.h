@@ -1,6 +1,9 @@
 #pragma once
-#include <stack>
-#include <json/value.h>
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "Foundation/AsyncFileWriter.h"
 
 class TransferJsonWriter;
 
@@ -17,95 +20,163 @@ concept IsSTLContainer = IsStdVector<T>::value || IsStdList<T>::value || IsStdSe
 
 }    // namespace JsonWriteDetail
 
+// Emits the JSON text as the fields arrive, there is no document tree: memory stays at the size of
+// the output buffer and the nesting depth, whatever the size of the file. Fields are written in the
+// order they are transferred, and the '__VersionMap' goes last since it is only complete by then.
+// The full buffers go to gAsyncFileWriter, the file only replaces the old one once it is complete.
 class TransferJsonWriter : public TransferBase, public ITransferWriter {
 public:
     using TransferBase::TransferBase;
     void TransferVersion(std::string_view name, int version) final;
-    void Transfer(std::string_view name, bool &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, bool &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, uint8 &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, uint8 &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, uint16 &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, uint16 &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, uint32 &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, uint32 &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, uint64 &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, uint64 &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, int8 &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, int8 &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, int16 &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, int16 &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, int32 &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, int32 &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, int64 &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, int64 &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, float &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, float &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, double &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, double &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
     }
-    void Transfer(std::string_view name, std::string &data) final {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, std::string &data) final {
+        WriteKey(name.string);
+        TransferValue(data);
+    }
+    void TransferBytes(TransferName name, ITransferBytes &bytes) final;
+    bool TransferOptional(TransferName name, bool hasValue) final {
+        // an empty optional is simply left out
+        return hasValue;
     }
     template<JsonWriteDetail::IsSTLContainer T>
-    void Transfer(std::string_view name, T &data) {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, T &data) {
+        WriteKey(name.string);
+        TransferValue(data);
     }
 
     template<JsonWriteDetail::InvokeObjectTransfer T>
-    void Transfer(std::string_view name, T &data) {
-        GetCurrentJsonValue()[name.data()] = TransferValue(data);
+    void Transfer(TransferName name, T &data) {
+        WriteKey(name.string);
+        TransferValue(data);
     }
 
     bool BeginTransfer() final;
     bool EndTransfer() final;
+
+    // EndTransfer returns once the file is queued instead of waiting for it to be written,
+    // the result goes to 'callback' on the I/O thread and to GetFuture
+    void SetAsync(AsyncFileWriter::Callback callback = nullptr) {
+        _async = true;
+        _callback = std::move(callback);
+    }
+    auto GetFuture() const -> const std::shared_future<bool> & {
+        return _future;
+    }
 private:
+    void TransferValue(bool data) {
+        BeginValue();
+        _buffer += data ? "true" : "false";
+    }
+
     template<typename T>
-        requires(std::is_integral_v<T> || std::is_same_v<T, bool> || std::is_floating_point_v<T> ||
-                 std::is_same_v<T, std::string>)
-    static Json::Value TransferValue(const T &data) {
-        return data;
+        requires(std::is_integral_v<T> || std::is_floating_point_v<T>)
+    void TransferValue(T data) {
+        BeginValue();
+        if constexpr (std::is_floating_point_v<T>) {
+            if (!std::isfinite(data)) {
+                _buffer += "null";
+                return;
+            }
+        }
+        // the shortest text that reads back to the same value
+        char text[32];
+        std::to_chars_result result = std::to_chars(std::begin(text), std::end(text), data);
+        _buffer.append(text, result.ptr);
+    }
+
+    void TransferValue(const std::string &data) {
+        BeginValue();
+        WriteString(data);
     }
 
     template<JsonWriteDetail::InvokeObjectTransfer T>
-    Json::Value TransferValue(T &data) {
-        PushJsonValue(Json::ValueType::objectValue);
+    void TransferValue(T &data) {
+        BeginScope('{');
         data.Transfer(*this);
-        return PopJsonValue();
+        EndScope('}');
     }
 
     template<JsonWriteDetail::IsSTLContainer T>
-    Json::Value TransferValue(T &data) {
-        Json::Value value = Json::ValueType::arrayValue;
+    void TransferValue(T &data) {
+        BeginScope('[');
         for (auto &item : data) {
-            value.append(TransferValue(item));
+            TransferValue(item);
         }
-        return value;
+        EndScope(']');
     }
 
     template<typename Key, typename Value>
-    Json::Value TransferValue(const std::pair<Key, Value> &pair) {
-        PushJsonValue(Json::ValueType::objectValue);
-        GetCurrentJsonValue()["Key"] = TransferValue(pair.first);
-        GetCurrentJsonValue()["Value"] = TransferValue(pair.second);
-        return PopJsonValue();
+    void TransferValue(std::pair<Key, Value> &pair) {
+        BeginScope('{');
+        WriteKey("Key");
+        TransferValue(pair.first);
+        WriteKey("Value");
+        TransferValue(pair.second);
+        EndScope('}');
     }
 
-    void PushJsonValue(Json::ValueType type = Json::ValueType::nullValue);
-    auto PopJsonValue() -> Json::Value;
-    auto GetCurrentJsonValue() -> Json::Value &;
+    void WriteKey(std::string_view name);
+    void WriteString(std::string_view string);
+    // the separator and the indent before a value; after a key the value follows on the same line
+    void BeginValue();
+    void BeginScope(char bracket);
+    void EndScope(char bracket);
+    void WriteIndent();
+    void FlushBuffer(bool force);
 private:
-    std::vector<Json::Value> _stack;
+    struct Scope {
+        bool isEmpty = true;
+        bool afterKey = false;
+    };
+    bool _async = false;
+    AsyncFileWriter::Callback _callback;
+    AsyncFileWriter::File _file;
+    std::shared_future<bool> _future;
+    std::string _buffer;
+    std::vector<Scope> _scopes;
 };
 
-static_assert(TransferContextConcept<TransferJsonWriter>);
\ No newline at end of file
+static_assert(TransferContextConcept<TransferJsonWriter>);
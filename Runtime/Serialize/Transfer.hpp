@@ -2,4 +2,6 @@
 #include "Internal/TransferBase.hpp"
 #include "Internal/TransferHelper.hpp"
 #include "Internal/TransferJsonReader.h"
-#include "Internal/TransferJsonWriter.h"
\ No newline at end of file
+#include "Internal/TransferJsonWriter.h"
+#include "Internal/TransferBinaryReader.h"
+#include "Internal/TransferBinaryWriter.h"
\ No newline at end of file
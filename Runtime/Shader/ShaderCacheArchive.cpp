@@ -0,0 +1,241 @@
+#include "ShaderCacheArchive.h"
+#include "Foundation/Exception.h"
+#include "Foundation/Hash.hpp"
+#include "Foundation/Logger.h"
+#include "VulkanRenderer/Misc.h"
+#include <algorithm>
+#include <cstring>
+#include <lz4.h>
+
+namespace {
+
+constexpr uint32_t kArchiveMagic = 0x41435356;    // "VSCA"
+constexpr uint32_t kArchiveVersion = 3;
+constexpr uint32_t kRecordMagic = 0x52435356;     // "VSCR"
+// keeps every bytecode 8 byte aligned, vk::ShaderModuleCreateInfo::pCode needs 4
+constexpr size_t kRecordAlignment = 8;
+// below this the dead records are not worth rewriting the archive for
+constexpr size_t kMinCompactSize = 1024 * 1024;
+
+struct ArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+// the stored bytes follow the header, 'storedSize' of them, compressed or not
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t compression;
+    uint32_t byteCodeSize;
+    uint32_t storedSize;
+    uint64_t storedHash;
+    uint8_t uuid[16];
+};
+
+static_assert(sizeof(ArchiveHeader) % kRecordAlignment == 0);
+static_assert(sizeof(RecordHeader) % kRecordAlignment == 0);
+
+auto GetRecordSize(uint32_t storedSize) -> size_t {
+    return sizeof(RecordHeader) + vkgfx::AlignUp<size_t>(storedSize, kRecordAlignment);
+}
+
+// 'header' carries everything but the magic, the key and the stored size
+void WriteRecord(std::ofstream &output, RecordHeader header, const UUID128 &uuid, std::span<const char> storedBytes) {
+    header.magic = kRecordMagic;
+    header.storedSize = static_cast<uint32_t>(storedBytes.size());
+    std::ranges::transform(uuid.as_bytes(), header.uuid, [](std::byte b) { return static_cast<uint8_t>(b); });
+
+    constexpr char kPadding[kRecordAlignment] = {};
+    size_t paddingSize = GetRecordSize(header.storedSize) - sizeof(RecordHeader) - storedBytes.size();
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.write(storedBytes.data(), storedBytes.size());
+    output.write(kPadding, paddingSize);
+}
+
+}    // namespace
+
+ShaderCacheArchive::~ShaderCacheArchive() {
+    Close();
+}
+
+void ShaderCacheArchive::Open(const stdfs::path &path) {
+    Close();
+    _path = path;
+    if (!stdfs::exists(_path)) {
+        std::ofstream output(_path, std::ios::binary);
+        ArchiveHeader header = {kArchiveMagic, kArchiveVersion};
+        output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+    size_t validSize = MapAndIndex();
+    if (validSize != _mappedFile.GetSize()) {
+        Logger::Warning("The shader cache archive {} is damaged or outdated, {} records are kept",
+            _path.string(),
+            _index.size());
+        Compact();
+    } else if (_deadSize > kMinCompactSize && _deadSize > validSize / 2) {
+        Compact();
+    }
+}
+
+void ShaderCacheArchive::Close() {
+    _output.close();
+    _index.clear();
+    _mappedFile.Close();
+    _deadSize = 0;
+}
+
+void ShaderCacheArchive::SetCompression(Compression compression) {
+    _compression = compression;
+}
+
+auto ShaderCacheArchive::Find(const UUID128 &uuid) const -> std::optional<Entry> {
+    auto iter = _index.find(uuid);
+    if (iter == _index.end()) {
+        return std::nullopt;
+    }
+
+    const IndexItem &item = iter->second;
+    const char *pStoredBytes = reinterpret_cast<const char *>(_mappedFile.GetData() + item.offset);
+    if (nstd::FNV1a64(pStoredBytes, item.storedSize) != item.storedHash) {
+        Logger::Warning("The shader cache record {} is corrupted", uuid.ToString());
+        return std::nullopt;
+    }
+
+    Entry entry;
+    if (item.compression == Compression::kNone) {
+        entry.byteCode = std::span<const char>(pStoredBytes, item.byteCodeSize);
+        return entry;
+    }
+
+    entry.buffer.resize(item.byteCodeSize);
+    int size = LZ4_decompress_safe(pStoredBytes,
+        entry.buffer.data(),
+        static_cast<int>(item.storedSize),
+        static_cast<int>(item.byteCodeSize));
+    if (size != static_cast<int>(item.byteCodeSize)) {
+        Logger::Warning("The shader cache record {} can't be decompressed", uuid.ToString());
+        return std::nullopt;
+    }
+    entry.byteCode = entry.buffer;
+    return entry;
+}
+
+void ShaderCacheArchive::Append(const UUID128 &uuid, std::span<const char> byteCode) {
+    if (!_output.is_open()) {
+        _output.open(_path, std::ios::binary | std::ios::app);
+        Exception::CondThrow(_output.is_open(), "Can't open the shader cache archive {}", _path.string());
+    }
+
+    RecordHeader header = {};
+    header.compression = static_cast<uint32_t>(Compression::kNone);
+    header.byteCodeSize = static_cast<uint32_t>(byteCode.size());
+    std::span<const char> storedBytes = byteCode;
+
+    std::vector<char> compressed;
+    if (_compression == Compression::kLZ4) {
+        compressed.resize(LZ4_compressBound(static_cast<int>(byteCode.size())));
+        int compressedSize = LZ4_compress_default(byteCode.data(),
+            compressed.data(),
+            static_cast<int>(byteCode.size()),
+            static_cast<int>(compressed.size()));
+        if (compressedSize > 0 && static_cast<size_t>(compressedSize) < byteCode.size()) {
+            header.compression = static_cast<uint32_t>(Compression::kLZ4);
+            storedBytes = std::span<const char>(compressed.data(), compressedSize);
+        }
+    }
+
+    header.storedHash = nstd::FNV1a64(storedBytes.data(), storedBytes.size());
+    WriteRecord(_output, header, uuid, storedBytes);
+    _output.flush();
+    // the mapped record of this key, if any, is stale from now on
+    _index.erase(uuid);
+}
+
+auto ShaderCacheArchive::GetEntryCount() const -> size_t {
+    return _index.size();
+}
+
+auto ShaderCacheArchive::MapAndIndex() -> size_t {
+    _index.clear();
+    _deadSize = 0;
+    Exception::CondThrow(_mappedFile.Open(_path), "Can't map the shader cache archive {}", _path.string());
+
+    std::span<const std::byte> bytes = _mappedFile.GetBytes();
+    ArchiveHeader archiveHeader;
+    if (bytes.size() < sizeof(archiveHeader)) {
+        return 0;
+    }
+    std::memcpy(&archiveHeader, bytes.data(), sizeof(archiveHeader));
+    if (archiveHeader.magic != kArchiveMagic || archiveHeader.version != kArchiveVersion) {
+        return 0;
+    }
+
+    size_t offset = sizeof(ArchiveHeader);
+    while (bytes.size() - offset >= sizeof(RecordHeader)) {
+        RecordHeader header;
+        std::memcpy(&header, bytes.data() + offset, sizeof(header));
+        size_t recordSize = GetRecordSize(header.storedSize);
+        bool knownCompression = header.compression <= static_cast<uint32_t>(Compression::kLZ4);
+        if (header.magic != kRecordMagic || !knownCompression || recordSize > bytes.size() - offset) {
+            break;
+        }
+
+        IndexItem item;
+        item.offset = offset + sizeof(RecordHeader);
+        item.compression = static_cast<Compression>(header.compression);
+        item.byteCodeSize = header.byteCodeSize;
+        item.storedSize = header.storedSize;
+        item.storedHash = header.storedHash;
+        auto [iter, inserted] = _index.try_emplace(UUID128(header.uuid), item);
+        if (!inserted) {
+            _deadSize += GetRecordSize(iter->second.storedSize);
+            iter->second = item;
+        }
+        offset += recordSize;
+    }
+    return offset;
+}
+
+void ShaderCacheArchive::Compact() {
+    stdfs::path tempPath = _path;
+    tempPath += ".tmp";
+    std::ofstream output(tempPath, std::ios::binary | std::ios::trunc);
+    if (!output.is_open()) {
+        Logger::Warning("Can't compact the shader cache archive {}, can't create {}",
+            _path.string(),
+            tempPath.string());
+        return;
+    }
+
+    ArchiveHeader archiveHeader = {kArchiveMagic, kArchiveVersion};
+    output.write(reinterpret_cast<const char *>(&archiveHeader), sizeof(archiveHeader));
+    for (auto &&[uuid, item] : _index) {
+        // the records are copied as stored, compressed or not
+        RecordHeader header = {};
+        header.compression = static_cast<uint32_t>(item.compression);
+        header.byteCodeSize = item.byteCodeSize;
+        header.storedHash = item.storedHash;
+        const char *pStoredBytes = reinterpret_cast<const char *>(_mappedFile.GetData() + item.offset);
+        WriteRecord(output, header, uuid, std::span<const char>(pStoredBytes, item.storedSize));
+    }
+    output.close();
+    std::error_code errorCode;
+    if (output.fail()) {
+        Logger::Warning("Can't compact the shader cache archive {}, writing {} failed",
+            _path.string(),
+            tempPath.string());
+        stdfs::remove(tempPath, errorCode);
+        return;
+    }
+
+    // a mapped file can't be replaced; another process may hold the archive, e.g. the precompiler, then the
+    // old archive is mapped again and compacted on a later start
+    _mappedFile.Close();
+    stdfs::rename(tempPath, _path, errorCode);
+    if (errorCode) {
+        Logger::Warning("Can't replace the shader cache archive {}: {}", _path.string(), errorCode.message());
+        stdfs::remove(tempPath, errorCode);
+    }
+    MapAndIndex();
+}
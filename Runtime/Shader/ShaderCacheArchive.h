@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "Foundation/MemoryMappedFile.h"
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/NonCopyable.h"
+#include "Foundation/UUID128.h"
+
+// Every cached shader variant of one build mode, packed into a single append-only file. The file is
+// mapped once in 'Open' and indexed by key, so a lookup is a hash map probe and the bytecode is read
+// straight from the mapping, or decompressed once for an LZ4 record. A newer record supersedes an
+// older one with the same key; the dead records are dropped when the archive is compacted on the
+// next 'Open'. The keys are content hashes (see MakeShaderCacheKey), so an entry never goes stale,
+// it only stops being looked up.
+class ShaderCacheArchive : public NonCopyable {
+public:
+    enum class Compression : uint32_t {
+        kNone = 0,
+        kLZ4 = 1,
+    };
+    // move only, 'byteCode' may point into 'buffer'
+    struct Entry {
+        std::span<const char> byteCode;    // into the mapping, valid until 'Close', or into 'buffer'
+        std::vector<char> buffer;
+    public:
+        Entry() = default;
+        Entry(Entry &&) noexcept = default;
+        Entry &operator=(Entry &&) noexcept = default;
+    };
+public:
+    ShaderCacheArchive() = default;
+    ~ShaderCacheArchive();
+    void Open(const stdfs::path &path);
+    void Close();
+    // for the records appended from now on, a record that does not shrink is stored as is
+    void SetCompression(Compression compression);
+    auto Find(const UUID128 &uuid) const -> std::optional<Entry>;
+    // the record goes to the end of the file, 'Find' only sees it after the next 'Open'
+    void Append(const UUID128 &uuid, std::span<const char> byteCode);
+    auto GetEntryCount() const -> size_t;
+private:
+    struct IndexItem {
+        size_t offset;
+        Compression compression;
+        uint32_t byteCodeSize;
+        uint32_t storedSize;
+        uint64_t storedHash;
+    };
+    // returns the size of the readable prefix, a torn record or a foreign header ends it
+    auto MapAndIndex() -> size_t;
+    void Compact();
+private:
+    stdfs::path _path;
+    MemoryMappedFile _mappedFile;
+    std::unordered_map<UUID128, IndexItem> _index;
+    size_t _deadSize = 0;
+    std::ofstream _output;
+    Compression _compression = Compression::kNone;
+};
@@ -0,0 +1,44 @@
+#include "ShaderCacheKey.h"
+#include <cstring>
+#include "Foundation/Hash.hpp"
+#include "Foundation/PathUtils.h"
+#include "Utils/AssetProjectSetting.h"
+#include "VulkanRenderer/DxcModule.h"
+#include "VulkanRenderer/ShaderCompiler.h"
+
+auto GetShaderCacheDirectory() -> std::string_view {
+#if defined(MODE_DEBUG)
+    return "Shader/Debug";
+#elif defined(MODE_RELEASE)
+    return "Shader/Release";
+#elif defined(MODE_RELWITHDEBINFO)
+    return "Shader/RelWithDebInfo";
+#endif
+}
+
+auto MakeShaderVariantHash(std::string_view entryPoint,
+    vkgfx::ShaderType shaderType,
+    ObjectView<const vkgfx::DefineList> pDefineList) -> uint64_t {
+    return vkgfx::ShaderCompiler::GetArgumentsHash(entryPoint, shaderType, pDefineList);
+}
+
+auto MakeShaderCacheKey(const stdfs::path &sourcePath,
+    uint64_t closureHash,
+    std::string_view entryPoint,
+    vkgfx::ShaderType shaderType,
+    ObjectView<const vkgfx::DefineList> pDefineList) -> UUID128 {
+
+    std::optional<stdfs::path> pRelativePath = nstd::ToRelativePath(gAssetProjectSetting->GetAssetAbsolutePath(),
+        sourcePath);
+    ExceptionAssert(pRelativePath.has_value());
+    uint64_t sourceHash = nstd::FNV1a64(pRelativePath->generic_string());
+    sourceHash = nstd::HashCombine(sourceHash, closureHash);
+
+    uint64_t compileHash = vkgfx::ShaderCompiler::GetArgumentsHash(entryPoint, shaderType, pDefineList);
+    compileHash = nstd::HashCombine(compileHash, vkgfx::gDxcModule->GetVersionHash());
+
+    uint8_t bytes[16];
+    std::memcpy(bytes, &sourceHash, sizeof(sourceHash));
+    std::memcpy(bytes + sizeof(sourceHash), &compileHash, sizeof(compileHash));
+    return UUID128(bytes);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/ObjectView.hpp"
+#include "Foundation/UUID128.h"
+#include "VulkanRenderer/EnumDefinition.h"
+
+namespace vkgfx {
+class DefineList;
+}
+
+// Shared by ShaderManager and the offline ShaderPrecompiler, so both read and write the same entries.
+
+// the cache files of the current build mode, relative to the asset cache directory
+auto GetShaderCacheDirectory() -> std::string_view;
+
+// tells the variants of one source apart in ShaderDependencyDatabase, their includes can depend on the defines
+auto MakeShaderVariantHash(std::string_view entryPoint,
+    vkgfx::ShaderType shaderType,
+    ObjectView<const vkgfx::DefineList> pDefineList) -> uint64_t;
+
+// Only the asset relative path and content hashes, so the key survives checkouts and moving the
+// project to another machine, while any change to the inputs gives a new key. 'closureHash' comes
+// from ShaderDependencyDatabase::GetClosureHash of the same variant.
+auto MakeShaderCacheKey(const stdfs::path &sourcePath,
+    uint64_t closureHash,
+    std::string_view entryPoint,
+    vkgfx::ShaderType shaderType,
+    ObjectView<const vkgfx::DefineList> pDefineList) -> UUID128;
@@ -0,0 +1,342 @@
+#include "ShaderDependencyDatabase.h"
+#include "Foundation/AsyncFileWriter.h"
+#include "Foundation/Exception.h"
+#include "Foundation/Hash.hpp"
+#include "Foundation/Logger.h"
+#include "Utils/AssetProjectSetting.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+constexpr uint32_t kDatabaseMagic = 0x44445356;    // "VSDD"
+constexpr uint32_t kDatabaseVersion = 2;
+
+struct DatabaseHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t fileCount;
+    uint32_t variantCount;
+};
+
+struct FileHeader {
+    uint64_t contentHash;
+    uint64_t fileSize;
+    int64_t writeTime;
+    uint32_t pathLength;
+    uint32_t reserved;
+};
+
+struct VariantHeader {
+    uint64_t variantHash;
+    uint32_t sourceIndex;
+    uint32_t includeCount;
+};
+
+template<typename T>
+bool ReadValue(std::istream &input, T &value) {
+    input.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return input.good();
+}
+
+template<typename T>
+void WriteValue(std::ostream &output, const T &value) {
+    output.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+}    // namespace
+
+void ShaderDependencyDatabase::Load(const stdfs::path &path) {
+    _path = path;
+    _assetAbsolutePath = gAssetProjectSetting->GetAssetAbsolutePath();
+    _files.clear();
+    _fileIndexMap.clear();
+    _variants.clear();
+    _variantIndexMap.clear();
+    _dirty = false;
+    if (stdfs::exists(_path)) {
+        LoadFromFile();
+    }
+}
+
+auto ShaderDependencyDatabase::Save() -> std::shared_future<bool> {
+    if (_saveFuture.valid() && _saveFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        // the last write failed, the file on disk is older than the records
+        if (!_saveFuture.get()) {
+            _dirty = true;
+        }
+        _saveFuture = {};
+    }
+    if (!_dirty) {
+        if (_saveFuture.valid()) {
+            return _saveFuture;
+        }
+        std::promise<bool> promise;
+        promise.set_value(true);
+        return promise.get_future().share();
+    }
+
+    std::ostringstream output(std::ios::binary);
+    DatabaseHeader header = {kDatabaseMagic,
+        kDatabaseVersion,
+        static_cast<uint32_t>(_files.size()),
+        static_cast<uint32_t>(_variants.size())};
+    WriteValue(output, header);
+    for (const FileRecord &record : _files) {
+        std::string relativePath = record.path.lexically_relative(_assetAbsolutePath).generic_string();
+        FileHeader fileHeader;
+        fileHeader.contentHash = record.contentHash;
+        fileHeader.fileSize = record.fileSize;
+        fileHeader.writeTime = record.writeTime;
+        fileHeader.pathLength = static_cast<uint32_t>(relativePath.size());
+        fileHeader.reserved = 0;
+        WriteValue(output, fileHeader);
+        output.write(relativePath.data(), relativePath.size());
+    }
+    for (const VariantRecord &variant : _variants) {
+        VariantHeader variantHeader;
+        variantHeader.variantHash = variant.variantHash;
+        variantHeader.sourceIndex = variant.sourceIndex;
+        variantHeader.includeCount = static_cast<uint32_t>(variant.includes.size());
+        WriteValue(output, variantHeader);
+        output.write(reinterpret_cast<const char *>(variant.includes.data()),
+            variant.includes.size() * sizeof(uint32_t));
+    }
+
+    // the file is replaced on the I/O thread, a failed write is reported there and the old database stays
+    AsyncFileWriter::File file = gAsyncFileWriter->Open(_path);
+    file.Append(std::move(output).str());
+    _saveFuture = file.Commit();
+    _dirty = false;
+    return _saveFuture;
+}
+
+auto ShaderDependencyDatabase::GetClosureHash(const stdfs::path &sourcePath, uint64_t variantHash)
+    -> std::optional<uint64_t> {
+
+    std::optional<uint32_t> pIndex = FindFileIndex(sourcePath);
+    if (!pIndex.has_value()) {
+        return std::nullopt;
+    }
+    auto iter = _variantIndexMap.find({*pIndex, variantHash});
+    if (iter == _variantIndexMap.end()) {
+        return std::nullopt;
+    }
+
+    // the compiler reports the includes in a fixed order, so the hash is stable
+    uint64_t hash = GetFileHash(*pIndex);
+    for (uint32_t includeIndex : _variants[iter->second].includes) {
+        hash = nstd::HashCombine(hash, GetFileHash(includeIndex));
+    }
+    return hash;
+}
+
+void ShaderDependencyDatabase::SetIncludeFiles(const stdfs::path &sourcePath,
+    uint64_t variantHash,
+    std::span<const stdfs::path> includeFiles) {
+
+    uint32_t sourceIndex = GetFileIndex(sourcePath);
+    auto [iter, inserted] = _variantIndexMap.try_emplace({sourceIndex, variantHash},
+        static_cast<uint32_t>(_variants.size()));
+    if (inserted) {
+        VariantRecord &variant = _variants.emplace_back();
+        variant.sourceIndex = sourceIndex;
+        variant.variantHash = variantHash;
+    }
+
+    // one dependent entry per variant, the other variants of the source keep theirs
+    for (uint32_t includeIndex : _variants[iter->second].includes) {
+        std::vector<uint32_t> &dependents = _files[includeIndex].dependents;
+        if (auto dependentIter = std::ranges::find(dependents, sourceIndex); dependentIter != dependents.end()) {
+            dependents.erase(dependentIter);
+        }
+    }
+
+    std::vector<uint32_t> includes;
+    for (const stdfs::path &includeFile : includeFiles) {
+        uint32_t includeIndex = GetFileIndex(includeFile);
+        if (includeIndex == sourceIndex || std::ranges::find(includes, includeIndex) != includes.end()) {
+            continue;
+        }
+        includes.push_back(includeIndex);
+        _files[includeIndex].dependents.push_back(sourceIndex);
+    }
+
+    _files[sourceIndex].isSource = true;
+    _variants[iter->second].includes = std::move(includes);
+    _dirty = true;
+}
+
+auto ShaderDependencyDatabase::GetDependentSources(const stdfs::path &path) const -> std::vector<stdfs::path> {
+    std::vector<stdfs::path> sources;
+    std::optional<uint32_t> pIndex = FindFileIndex(path);
+    if (!pIndex.has_value()) {
+        return sources;
+    }
+
+    const FileRecord &record = _files[*pIndex];
+    if (record.isSource) {
+        sources.push_back(record.path);
+    }
+    for (uint32_t dependentIndex : record.dependents) {
+        const stdfs::path &sourcePath = _files[dependentIndex].path;
+        if (std::ranges::find(sources, sourcePath) == sources.end()) {
+            sources.push_back(sourcePath);
+        }
+    }
+    return sources;
+}
+
+void ShaderDependencyDatabase::InvalidateFile(const stdfs::path &path) {
+    if (std::optional<uint32_t> pIndex = FindFileIndex(path)) {
+        _files[*pIndex].verified = false;
+    }
+}
+
+auto ShaderDependencyDatabase::GetFileIndex(const stdfs::path &path) -> uint32_t {
+    stdfs::path normalPath = stdfs::absolute(path).lexically_normal();
+    auto [iter, inserted] = _fileIndexMap.try_emplace(normalPath, static_cast<uint32_t>(_files.size()));
+    if (inserted) {
+        FileRecord &record = _files.emplace_back();
+        record.path = std::move(normalPath);
+        _dirty = true;
+    }
+    return iter->second;
+}
+
+auto ShaderDependencyDatabase::FindFileIndex(const stdfs::path &path) const -> std::optional<uint32_t> {
+    auto iter = _fileIndexMap.find(stdfs::absolute(path).lexically_normal());
+    if (iter == _fileIndexMap.end()) {
+        return std::nullopt;
+    }
+    return iter->second;
+}
+
+auto ShaderDependencyDatabase::GetFileHash(uint32_t index) -> uint64_t {
+    FileRecord &record = _files[index];
+    if (record.verified) {
+        return record.contentHash;
+    }
+
+    record.verified = true;
+    std::error_code errorCode;
+    uint64_t fileSize = stdfs::file_size(record.path, errorCode);
+    if (errorCode) {
+        // a deleted include must not match anything that was compiled while it existed
+        record.contentHash = 0;
+        record.fileSize = 0;
+        record.writeTime = 0;
+        _dirty = true;
+        return record.contentHash;
+    }
+
+    int64_t writeTime = stdfs::last_write_time(record.path, errorCode).time_since_epoch().count();
+    if (fileSize == record.fileSize && writeTime == record.writeTime && record.contentHash != 0) {
+        return record.contentHash;
+    }
+
+    // the stat changed, which says nothing about the contents yet
+    std::ifstream input(record.path, std::ios::binary);
+    std::stringstream sbuf;
+    sbuf << input.rdbuf();
+    record.contentHash = nstd::FNV1a64(sbuf.str());
+    record.fileSize = fileSize;
+    record.writeTime = writeTime;
+    _dirty = true;
+    return record.contentHash;
+}
+
+void ShaderDependencyDatabase::LoadFromFile() {
+    std::error_code errorCode;
+    uint64_t remainingSize = stdfs::file_size(_path, errorCode);
+    std::ifstream input(_path, std::ios::binary);
+    DatabaseHeader header;
+    if (errorCode || !ReadValue(input, header) || header.magic != kDatabaseMagic ||
+        header.version != kDatabaseVersion) {
+        Logger::Warning("The shader dependency database {} is outdated and will be rebuilt", _path.string());
+        return;
+    }
+
+    // the counts come from the file, each one is checked against the bytes left before it is allocated
+    auto consume = [&](uint64_t size) {
+        if (size > remainingSize) {
+            return false;
+        }
+        remainingSize -= size;
+        return true;
+    };
+    consume(sizeof(header));
+    if (header.fileCount > remainingSize / sizeof(FileHeader)) {
+        Logger::Warning("The shader dependency database {} is truncated and will be rebuilt", _path.string());
+        return;
+    }
+
+    auto truncated = [&]() {
+        Logger::Warning("The shader dependency database {} is truncated and will be rebuilt", _path.string());
+        _files.clear();
+        _fileIndexMap.clear();
+        _variants.clear();
+        _variantIndexMap.clear();
+    };
+
+    _files.resize(header.fileCount);
+    for (uint32_t index = 0; index < header.fileCount; ++index) {
+        FileHeader fileHeader;
+        std::string relativePath;
+        bool succeeded = consume(sizeof(FileHeader)) && ReadValue(input, fileHeader) &&
+                         consume(fileHeader.pathLength);
+        if (succeeded) {
+            relativePath.resize(fileHeader.pathLength);
+            input.read(relativePath.data(), fileHeader.pathLength);
+            succeeded = input.good();
+        }
+        if (!succeeded) {
+            truncated();
+            return;
+        }
+
+        FileRecord &record = _files[index];
+        record.path = (_assetAbsolutePath / relativePath).lexically_normal();
+        record.contentHash = fileHeader.contentHash;
+        record.fileSize = fileHeader.fileSize;
+        record.writeTime = fileHeader.writeTime;
+        _fileIndexMap.emplace(record.path, index);
+    }
+
+    if (header.variantCount > remainingSize / sizeof(VariantHeader)) {
+        truncated();
+        return;
+    }
+    _variants.resize(header.variantCount);
+    for (uint32_t index = 0; index < header.variantCount; ++index) {
+        VariantHeader variantHeader;
+        bool succeeded = consume(sizeof(VariantHeader)) && ReadValue(input, variantHeader) &&
+                         consume(static_cast<uint64_t>(variantHeader.includeCount) * sizeof(uint32_t));
+        VariantRecord &variant = _variants[index];
+        if (succeeded) {
+            variant.includes.resize(variantHeader.includeCount);
+            input.read(reinterpret_cast<char *>(variant.includes.data()),
+                variantHeader.includeCount * sizeof(uint32_t));
+            succeeded = input.good() && variantHeader.sourceIndex < _files.size();
+        }
+        if (!succeeded) {
+            truncated();
+            return;
+        }
+
+        variant.sourceIndex = variantHeader.sourceIndex;
+        variant.variantHash = variantHeader.variantHash;
+        _variantIndexMap.emplace(std::make_pair(variant.sourceIndex, variant.variantHash), index);
+    }
+
+    // the reverse edges are derived, so they are rebuilt rather than trusted from disk
+    for (VariantRecord &variant : _variants) {
+        std::erase_if(variant.includes, [&](uint32_t includeIndex) { return includeIndex >= _files.size(); });
+        _files[variant.sourceIndex].isSource = true;
+        for (uint32_t includeIndex : variant.includes) {
+            _files[includeIndex].dependents.push_back(variant.sourceIndex);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <future>
+#include <map>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/NonCopyable.h"
+
+// The include graph as recorded by the compiler, plus a content hash per file. It is saved next to
+// the shader cache archive, so validating the cached variants at startup is one table read and a
+// stat per file; a file is only read and hashed again when its size or mtime changed. Paths are
+// absolute in memory and relative to the asset directory on disk. The includes are recorded per
+// variant, an '#include' inside an '#if' makes the closure depend on the defines.
+class ShaderDependencyDatabase : public NonCopyable {
+public:
+    void Load(const stdfs::path &path);
+    // Only writes when something changed since the last save that reached the disk. The result is
+    // false when the write failed, the database is written again by the next 'Save' then.
+    auto Save() -> std::shared_future<bool>;
+    // Hash of the source and every file the last compile of the variant included, nullopt when the
+    // variant never compiled. 'variantHash' comes from MakeShaderVariantHash.
+    auto GetClosureHash(const stdfs::path &sourcePath, uint64_t variantHash) -> std::optional<uint64_t>;
+    // 'includeFiles' is the flat include closure reported by the compiler
+    void SetIncludeFiles(const stdfs::path &sourcePath,
+        uint64_t variantHash,
+        std::span<const stdfs::path> includeFiles);
+    // the sources that have a variant including 'path', including 'path' itself when it is a source
+    auto GetDependentSources(const stdfs::path &path) const -> std::vector<stdfs::path>;
+    // forget the verified hash of 'path', the next query reads the file again
+    void InvalidateFile(const stdfs::path &path);
+private:
+    struct FileRecord {
+        stdfs::path path;
+        uint64_t contentHash = 0;
+        uint64_t fileSize = 0;
+        int64_t writeTime = 0;
+        bool verified = false;
+        bool isSource = false;
+        std::vector<uint32_t> dependents;    // the source of each variant including this file
+    };
+    struct VariantRecord {
+        uint32_t sourceIndex = 0;
+        uint64_t variantHash = 0;
+        std::vector<uint32_t> includes;
+    };
+    using VariantIndexMap = std::map<std::pair<uint32_t, uint64_t>, uint32_t>;
+    auto GetFileIndex(const stdfs::path &path) -> uint32_t;
+    auto FindFileIndex(const stdfs::path &path) const -> std::optional<uint32_t>;
+    auto GetFileHash(uint32_t index) -> uint64_t;
+    void LoadFromFile();
+private:
+    stdfs::path _path;
+    stdfs::path _assetAbsolutePath;
+    std::vector<FileRecord> _files;
+    std::unordered_map<stdfs::path, uint32_t> _fileIndexMap;
+    std::vector<VariantRecord> _variants;
+    VariantIndexMap _variantIndexMap;
+    bool _dirty = false;
+    std::shared_future<bool> _saveFuture;
+};
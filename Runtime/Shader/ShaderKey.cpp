@@ -0,0 +1,58 @@
+#include "ShaderKey.h"
+#include "Foundation/Exception.h"
+#include "Foundation/PathUtils.h"
+#include "Utils/AssetProjectSetting.h"
+
+auto ShaderKeyTable::InternSourcePath(const stdfs::path &path) -> uint32_t {
+    if (const uint32_t *pID = _pathSpellingMap.Find(path.native())) {
+        return *pID;
+    }
+
+    // a new spelling, e.g. relative or with "..", may still name a known source
+    stdfs::path sourcePath = path.is_absolute() ? path : stdfs::absolute(path);
+    sourcePath = sourcePath.lexically_normal();
+    Exception::CondThrow(nstd::IsSubPath(gAssetProjectSetting->GetAssetAbsolutePath(), sourcePath),
+        "Only shaders under the Asset path can be loaded");
+
+    uint32_t sourcePathID = 0;
+    if (const uint32_t *pID = _sourcePathIDMap.Find(sourcePath.native())) {
+        sourcePathID = *pID;
+    } else {
+        sourcePathID = static_cast<uint32_t>(_sourcePaths.size());
+        const stdfs::path &storedPath = _sourcePaths.emplace_back(std::move(sourcePath));
+        *_sourcePathIDMap.TryEmplace(storedPath.native()).first = sourcePathID;
+    }
+
+    const PathString &spelling = _pathSpellings.emplace_back(path.native());
+    *_pathSpellingMap.TryEmplace(spelling).first = sourcePathID;
+    return sourcePathID;
+}
+
+auto ShaderKeyTable::InternEntryPoint(std::string_view entryPoint) -> uint32_t {
+    if (const uint32_t *pID = _entryPointIDMap.Find(entryPoint)) {
+        return *pID;
+    }
+    uint32_t entryPointID = static_cast<uint32_t>(_entryPoints.size());
+    const std::string &storedEntryPoint = _entryPoints.emplace_back(entryPoint);
+    *_entryPointIDMap.TryEmplace(storedEntryPoint).first = entryPointID;
+    return entryPointID;
+}
+
+auto ShaderKeyTable::GetSourcePath(uint32_t sourcePathID) const -> const stdfs::path & {
+    ExceptionAssert(sourcePathID < _sourcePaths.size());
+    return _sourcePaths[sourcePathID];
+}
+
+auto ShaderKeyTable::GetEntryPoint(uint32_t entryPointID) const -> std::string_view {
+    ExceptionAssert(entryPointID < _entryPoints.size());
+    return _entryPoints[entryPointID];
+}
+
+void ShaderKeyTable::Clear() {
+    _sourcePathIDMap.Clear();
+    _pathSpellingMap.Clear();
+    _entryPointIDMap.Clear();
+    _sourcePaths.clear();
+    _pathSpellings.clear();
+    _entryPoints.clear();
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include "Foundation/Hash.hpp"
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/NonCopyable.h"
+#include "Foundation/OpenHashMap.hpp"
+#include "VulkanRenderer/EnumDefinition.h"
+
+// Identifies a loaded shader variant in memory. The IDs come from a ShaderKeyTable and mean nothing
+// outside of it, the on-disk cache uses ShaderManager::MakeCacheKey instead. The hash is computed
+// once in 'Make', so a map probe never looks at a string.
+struct ShaderKey {
+    uint32_t sourcePathID = 0;
+    uint32_t entryPointID = 0;
+    vkgfx::ShaderType shaderType = {};
+    uint64_t defineHash = 0;    // DefineList::GetHash, zero without defines
+    uint64_t hash = 0;
+public:
+    static auto Make(uint32_t sourcePathID, uint32_t entryPointID, vkgfx::ShaderType shaderType, uint64_t defineHash)
+        -> ShaderKey {
+        uint64_t hash = nstd::HashCombine(defineHash, (uint64_t(sourcePathID) << 32) | entryPointID);
+        hash = nstd::HashCombine(hash, static_cast<uint64_t>(shaderType));
+        return ShaderKey{sourcePathID, entryPointID, shaderType, defineHash, hash};
+    }
+    friend bool operator==(const ShaderKey &lhs, const ShaderKey &rhs) = default;
+};
+
+struct ShaderKeyHash {
+    auto operator()(const ShaderKey &key) const -> size_t {
+        return static_cast<size_t>(key.hash);
+    }
+};
+
+// Interns the source paths and entry points of the shader keys. A path is resolved against the
+// Asset directory the first time it is seen in a given spelling; after that the spelling alone maps
+// to the ID, so a lookup neither allocates nor touches the file system. Main thread only.
+class ShaderKeyTable : public NonCopyable {
+public:
+    auto InternSourcePath(const stdfs::path &path) -> uint32_t;
+    auto InternEntryPoint(std::string_view entryPoint) -> uint32_t;
+    // absolute and lexically normal
+    auto GetSourcePath(uint32_t sourcePathID) const -> const stdfs::path &;
+    auto GetEntryPoint(uint32_t entryPointID) const -> std::string_view;
+    void Clear();
+private:
+    using PathString = stdfs::path::string_type;
+    using PathStringView = std::basic_string_view<stdfs::path::value_type>;
+private:
+    // the maps view the strings stored in the deques, which never move their elements
+    std::deque<stdfs::path> _sourcePaths;
+    nstd::OpenHashMap<PathStringView, uint32_t> _sourcePathIDMap;
+    std::deque<PathString> _pathSpellings;
+    nstd::OpenHashMap<PathStringView, uint32_t> _pathSpellingMap;
+    std::deque<std::string> _entryPoints;
+    nstd::OpenHashMap<std::string_view, uint32_t> _entryPointIDMap;
+};
@@ -1,118 +1,186 @@
 #include "ShaderManager.h"
 #include "VulkanRenderer/DefineList.h"
-#include "Shader/ShaderDependency.h"
 #include "Foundation/UUID128.h"
+#include "Shader/ShaderCacheKey.h"
+#include "Foundation/CompileEnvInfo.hpp"
 #include "Foundation/DebugBreak.h"
 #include "Foundation/Logger.h"
+#include "Foundation/MainThread.h"
+#include "Foundation/ThreadPool.h"
+#include "RenderDoc/RenderDoc.h"
 #include "Utils/AssetProjectSetting.h"
 #include "VulkanRenderer/ShaderCompiler.h"
+#include "VulkanRenderer/ShaderIncludeCache.h"
+#include "VulkanRenderer/ShaderReflection.h"
 #include "VulkanRenderer/Device.h"
+#include "VulkanRenderer/PipelineCompileService.h"
 
-#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <unordered_set>
 #include <fmt/format.h>
 #include <magic_enum.hpp>
 
-#include "Foundation/PathUtils.h"
 #include "VulkanRenderer/ExtDebugUtils.h"
 
-#if defined(MODE_DEBUG)
-static std::string_view sShaderCacheDirectory = "Shader/Debug";
-#elif defined(MODE_RELEASE)
-static std::string_view sShaderCacheDirectory = "Shader/Release";
-#elif defined(MODE_RELWITHDEBINFO)
-static std::string_view sShaderCacheDirectory = "Shader/RelWithDebInfo";
-#endif
-
 ShaderManager::ShaderManager() {
 }
 
 ShaderManager::~ShaderManager() {
 }
 
-void ShaderManager::Initialize() {
-    stdfs::path shaderCacheDir = gAssetProjectSetting->GetAssetCacheAbsolutePath() / sShaderCacheDirectory;
+void ShaderManager::Initialize(size_t numBackBuffers) {
+    _numBackBuffers = numBackBuffers;
+    stdfs::path shaderCacheDir = gAssetProjectSetting->GetAssetCacheAbsolutePath() / GetShaderCacheDirectory();
     if (!stdfs::exists(shaderCacheDir)) {
         stdfs::create_directories(shaderCacheDir);
     }
     Exception::CondThrow(stdfs::is_directory(shaderCacheDir),
         "The cache path {} is occupied. Procedure",
         shaderCacheDir.string());
+    _cacheArchive.SetCompression(ShaderCacheArchive::Compression::kLZ4);
+    _cacheArchive.Open(shaderCacheDir / "ShaderCache.bin");
+    _dependencyDatabase.Load(shaderCacheDir / "ShaderDependency.bin");
+    Logger::Info("Shader cache archive: {} entries", _cacheArchive.GetEntryCount());
+
+    // the main archive only keeps stripped bytecode, the debug info is worth its size under a capture tool
+    _useDebugInfo = !CompileEnvInfo::IsModeRelease() && RenderDoc::IsLoaded();
+    if (_useDebugInfo) {
+        _debugCacheArchive.SetCompression(ShaderCacheArchive::Compression::kLZ4);
+        _debugCacheArchive.Open(shaderCacheDir / "ShaderCacheDebug.bin");
+        Logger::Info("Shader debug cache archive: {} entries", _debugCacheArchive.GetEntryCount());
+    }
+
+    if constexpr (!CompileEnvInfo::IsModeRelease()) {
+        stdfs::path assetPath = gAssetProjectSetting->GetAssetAbsolutePath();
+        if (!_fileWatcher.Start(assetPath)) {
+            Logger::Warning("Shader hot reload is disabled, can't watch {}", assetPath.string());
+        }
+    }
 }
 
 void ShaderManager::Destroy() {
+    _fileWatcher.Stop();
+    _reloadCallbacks.clear();
+    for (ReloadTask &task : _reloadTasks) {
+        task.future.wait();
+    }
+    _reloadTasks.clear();
+
     vk::Device device = vkgfx::gDevice->GetVKDevice();
-    for (auto &&[_, shaderModule] : _shaderModuleMap) {
-        device.destroyShaderModule(shaderModule);
+    for (const ShaderVariant &variant : _variants) {
+        if (variant.shaderModule) {
+            device.destroyShaderModule(variant.shaderModule);
+        }
+    }
+    for (const RetiredShaderModule &retired : _retiredShaderModules) {
+        device.destroyShaderModule(retired.shaderModule);
     }
-    _shaderModuleMap.clear();
+    _retiredShaderModules.clear();
+    _variants.clear();
+    _variantIndexMap.Clear();
+    _keyTable.Clear();
+    _shaderReflectionMap.clear();
+    _sourceVariantMap.clear();
+    vkgfx::gShaderIncludeCache->Clear();
+    _cacheArchive.Close();
+    _debugCacheArchive.Close();
+    _dependencyDatabase.Save();
 }
 
 auto ShaderManager::LoadShaderModule(const ShaderLoadInfo &loadInfo) -> vk::ShaderModule {
-    stdfs::path sourcePath = loadInfo.sourcePath;
-    if (!sourcePath.is_absolute()) {
-        sourcePath = stdfs::absolute(sourcePath);
-    }
-
-    Exception::CondThrow(nstd::IsSubPath(gAssetProjectSetting->GetAssetAbsolutePath(), sourcePath),
-        "Only shaders under the Asset path can be loaded");
-
-    std::string keyString = fmt::format("{}_{}_{}_{}",
-        sourcePath.string(),
-        loadInfo.entryPoint.data(),
-        magic_enum::enum_name(loadInfo.shaderType).data(),
-        loadInfo.pDefineList.HasValue() ? loadInfo.pDefineList->ToString() : "");
-
-    UUID128 uuid = UUID128::New(keyString);
-    if (auto iter = _shaderModuleMap.find(uuid); iter != _shaderModuleMap.end()) {
-        return iter->second;
+    ShaderKey key = MakeShaderKey(loadInfo);
+    if (const uint32_t *pVariantIndex = _variantIndexMap.Find(key)) {
+        if (vk::ShaderModule shaderModule = _variants[*pVariantIndex].shaderModule) {
+            return shaderModule;
+        }
     }
 
-    std::string cacheFileName = fmt::format("{}.spr", uuid.ToString());
-    stdfs::path shaderCachePath = gAssetProjectSetting->GetAssetCacheAbsolutePath() / sShaderCacheDirectory /
-                                  cacheFileName;
-    if (vk::ShaderModule shaderModule = LoadFromCache(uuid, sourcePath, shaderCachePath)) {
-        return shaderModule;
+    uint32_t variantIndex = RegisterVariant(key, loadInfo);
+    const ShaderVariant &variant = _variants[variantIndex];
+    if (std::optional<UUID128> pCacheKey = MakeCacheKey(variant)) {
+        if (vk::ShaderModule shaderModule = LoadFromCache(variantIndex, *pCacheKey)) {
+            return shaderModule;
+        }
     }
 
-    vkgfx::ShaderCompiler shaderCompiler;
-    if (!shaderCompiler.Compile(sourcePath, loadInfo.entryPoint, loadInfo.shaderType, loadInfo.pDefineList)) {
-        Logger::Warning("Compile shader {} error: the error message: {}",
-            sourcePath.string(),
-            shaderCompiler.GetErrorMessage());
+    vk::ShaderModule shaderModule = FinishCompile(variantIndex, CompileShader(variant));
+    if (!shaderModule) {
         DEBUG_BREAK;
-        return nullptr;
     }
+    return shaderModule;
+}
 
-    std::ofstream fileOutput(shaderCachePath, std::ios::binary);
-    fileOutput.write(static_cast<const char *>(shaderCompiler.GetByteCodePtr()), shaderCompiler.GetByteCodeSize());
-    fileOutput.close();
+auto ShaderManager::LoadShaderModules(std::span<const ShaderLoadInfo> loadInfos) -> std::vector<vk::ShaderModule> {
+    MainThread::EnsureMainThread();
+    struct CompileTask {
+        uint32_t variantIndex;
+        std::future<CompileResult> future;
+    };
 
-    std::vector<char> byteCode;
-    byteCode.resize(shaderCompiler.GetByteCodeSize(), 0);
-    std::memcpy(byteCode.data(), shaderCompiler.GetByteCodePtr(), shaderCompiler.GetByteCodeSize());
+    std::vector<uint32_t> variantIndices;
+    std::vector<CompileTask> compileTasks;
+    std::unordered_set<uint32_t> scheduled;
+    variantIndices.reserve(loadInfos.size());
+    for (const ShaderLoadInfo &loadInfo : loadInfos) {
+        uint32_t variantIndex = RegisterVariant(MakeShaderKey(loadInfo), loadInfo);
+        variantIndices.push_back(variantIndex);
+        const ShaderVariant &variant = _variants[variantIndex];
+        if (variant.shaderModule || scheduled.contains(variantIndex)) {
+            continue;
+        }
 
-    vk::ShaderModule shaderModule = LoadFromByteCode(uuid, byteCode);
-    if (shaderModule) {
-        vkgfx::SetResourceName(vkgfx::gDevice->GetVKDevice(), shaderModule, keyString);
+        std::optional<UUID128> pCacheKey = MakeCacheKey(variant);
+        if (pCacheKey.has_value() && LoadFromCache(variantIndex, *pCacheKey)) {
+            continue;
+        }
+
+        scheduled.insert(variantIndex);
+        compileTasks.push_back(CompileTask{variantIndex, SubmitCompile(variant)});
     }
 
-    _shaderByteCodeMap[uuid] = std::move(byteCode);
-    return shaderModule;
+    // vk::ShaderModule creation and the variants stay on the main thread
+    for (CompileTask &task : compileTasks) {
+        FinishCompile(task.variantIndex, task.future.get());
+    }
+
+    std::vector<vk::ShaderModule> shaderModules;
+    shaderModules.reserve(variantIndices.size());
+    for (uint32_t variantIndex : variantIndices) {
+        shaderModules.push_back(_variants[variantIndex].shaderModule);
+    }
+    return shaderModules;
 }
 
-auto ShaderManager::GetShaderDependency(stdfs::path path) -> ShaderDependency & {
-    if (!path.is_absolute()) {
-        path = stdfs::absolute(path);
+void ShaderManager::Update() {
+    MainThread::EnsureMainThread();
+    std::unordered_set<uint32_t> reloadSet;
+    for (const stdfs::path &path : _fileWatcher.PollChanges()) {
+        _dependencyDatabase.InvalidateFile(path);
+        vkgfx::gShaderIncludeCache->Invalidate(path);
+        for (const stdfs::path &sourcePath : _dependencyDatabase.GetDependentSources(path)) {
+            auto iter = _sourceVariantMap.find(sourcePath);
+            if (iter != _sourceVariantMap.end()) {
+                reloadSet.insert(iter->second.begin(), iter->second.end());
+            }
+        }
     }
 
-    auto iter = _shaderDependencyMap.find(path);
-    if (iter != _shaderDependencyMap.end()) {
-        return *iter->second;
+    for (uint32_t variantIndex : reloadSet) {
+        ScheduleReload(variantIndex);
     }
+    PublishReloads();
+    ReleaseRetiredShaderModules();
+    ++_frameCount;
+}
+
+void ShaderManager::AddReloadCallback(ShaderReloadCallback callback) {
+    _reloadCallbacks.push_back(std::move(callback));
+}
 
-    auto item = std::make_pair(path, std::make_unique<ShaderDependency>(path));
-    iter = _shaderDependencyMap.emplace_hint(iter, std::move(item));
-    return *iter->second;
+auto ShaderManager::GetDependentSources(const stdfs::path &path) const -> std::vector<stdfs::path> {
+    return _dependencyDatabase.GetDependentSources(path);
 }
 
 bool ShaderManager::LoadShaderStageCreateInfo(const ShaderLoadInfo &loadInfo,
@@ -150,37 +218,248 @@ bool ShaderManager::LoadShaderStageCreateInfo(const ShaderLoadInfo &loadInfo,
     return false;
 }
 
-auto ShaderManager::LoadFromCache(UUID128 uuid, const stdfs::path &sourcePath, const stdfs::path &cachePath)
-    -> vk::ShaderModule {
+auto ShaderManager::GetShaderReflection(vk::ShaderModule shaderModule) const -> const vkgfx::ShaderReflection * {
+    auto iter = _shaderReflectionMap.find(shaderModule);
+    return (iter != _shaderReflectionMap.end()) ? iter->second.get() : nullptr;
+}
 
-    if (!stdfs::exists(cachePath)) {
+auto ShaderManager::LoadFromCache(uint32_t variantIndex, UUID128 cacheKey) -> vk::ShaderModule {
+    // a miss in the debug archive compiles again, the stripped bytecode would be useless to the debugger
+    ShaderCacheArchive &cacheArchive = _useDebugInfo ? _debugCacheArchive : _cacheArchive;
+    std::optional<ShaderCacheArchive::Entry> pEntry = cacheArchive.Find(cacheKey);
+    if (!pEntry.has_value()) {
         return nullptr;
     }
+    // uncompressed records point into the mapped archive, the others into the entry's own buffer
+    _variants[variantIndex].cacheKey = cacheKey;
+    return LoadFromByteCode(variantIndex, pEntry->byteCode);
+}
 
-    vk::ShaderModule shaderModule = nullptr;
-    stdfs::file_time_type cacheLastWriteTime = stdfs::last_write_time(cachePath);
-    ShaderDependency &dependency = GetShaderDependency(sourcePath);
-    if (dependency.GetLastWriteTime() <= cacheLastWriteTime) {
-        std::ifstream fin(cachePath, std::ios::binary);
-        fin.seekg(0, SEEK_END);
-        uint32_t fileSize = fin.tellg();
-        fin.seekg(0, SEEK_SET);
-        std::vector<char> byteCode;
-        byteCode.resize(fileSize, 0);
-        fin.read(byteCode.data(), fileSize);
-        shaderModule = LoadFromByteCode(uuid, byteCode);
-        _shaderByteCodeMap[uuid] = std::move(byteCode);
+auto ShaderManager::ShaderVariant::GetLoadInfo() const -> ShaderLoadInfo {
+    ObjectView<const vkgfx::DefineList> pDefines = nullptr;
+    if (pDefineList != nullptr) {
+        pDefines = *pDefineList;
     }
+    return ShaderLoadInfo{sourcePath, entryPoint, shaderType, pDefines};
+}
+
+auto ShaderManager::RegisterVariant(const ShaderKey &key, const ShaderLoadInfo &loadInfo) -> uint32_t {
+    auto [pVariantIndex, inserted] = _variantIndexMap.TryEmplace(key);
+    if (!inserted) {
+        return *pVariantIndex;
+    }
+
+    uint32_t variantIndex = static_cast<uint32_t>(_variants.size());
+    *pVariantIndex = variantIndex;
+
+    // the load info only references the caller's data, the variant keeps its own copy
+    ShaderVariant &variant = _variants.emplace_back();
+    variant.key = key;
+    variant.sourcePath = _keyTable.GetSourcePath(key.sourcePathID);
+    variant.entryPoint = loadInfo.entryPoint;
+    variant.shaderType = loadInfo.shaderType;
+    if (loadInfo.pDefineList.HasValue()) {
+        variant.pDefineList = std::make_shared<vkgfx::DefineList>(*loadInfo.pDefineList);
+    }
+    // only for the log and the debug names, so it is built once per variant
+    variant.keyString = fmt::format("{}_{}_{}_{}",
+        variant.sourcePath.string(),
+        variant.entryPoint,
+        magic_enum::enum_name(variant.shaderType).data(),
+        (variant.pDefineList != nullptr) ? variant.pDefineList->ToString() : "");
+    _sourceVariantMap[variant.sourcePath].push_back(variantIndex);
+    return variantIndex;
+}
+
+auto ShaderManager::CompileShader(const ShaderVariant &variant) -> CompileResult {
+    CompileResult result;
+    vkgfx::ShaderCompiler shaderCompiler;
+    ShaderLoadInfo loadInfo = variant.GetLoadInfo();
+    bool succeeded = shaderCompiler.Compile(loadInfo.sourcePath,
+        loadInfo.entryPoint,
+        loadInfo.shaderType,
+        loadInfo.pDefineList);
+    result.includeFiles = shaderCompiler.GetIncludeFiles();
+    if (!succeeded) {
+        result.errorMessage = shaderCompiler.GetErrorMessage();
+        return result;
+    }
+
+    result.byteCode.resize(shaderCompiler.GetByteCodeSize(), 0);
+    std::memcpy(result.byteCode.data(), shaderCompiler.GetByteCodePtr(), shaderCompiler.GetByteCodeSize());
+    result.succeeded = true;
+    return result;
+}
+
+auto ShaderManager::SubmitCompile(const ShaderVariant &variant) -> std::future<CompileResult> {
+    // the job owns a copy, the variant map is only touched by the main thread
+    return gThreadPool->Submit([variant]() { return CompileShader(variant); });
+}
+
+auto ShaderManager::FinishCompile(uint32_t variantIndex, CompileResult result) -> vk::ShaderModule {
+    const ShaderVariant &variant = _variants[variantIndex];
+    ShaderLoadInfo loadInfo = variant.GetLoadInfo();
+    uint64_t variantHash = MakeShaderVariantHash(loadInfo.entryPoint, loadInfo.shaderType, loadInfo.pDefineList);
+    // a source that could not be opened reports no includes, the recorded ones still describe the old module
+    if (result.succeeded || !result.includeFiles.empty()) {
+        _dependencyDatabase.SetIncludeFiles(variant.sourcePath, variantHash, result.includeFiles);
+    }
+    if (!result.succeeded) {
+        Logger::Warning("Compile shader {} error: the error message: {}",
+            variant.sourcePath.string(),
+            result.errorMessage);
+        return nullptr;
+    }
+    // the include closure is known now, even if this variant never compiled before
+    UUID128 cacheKey = MakeCacheKey(variant).value();
+    return CreateShaderModule(variantIndex, cacheKey, std::move(result.byteCode));
+}
+
+void ShaderManager::ScheduleReload(uint32_t variantIndex) {
+    // a pending compile of an older revision is dropped when it finishes
+    ShaderVariant &variant = _variants[variantIndex];
+    ++variant.reloadGeneration;
+
+    // saved without a change that reaches the compiler, e.g. a touch or an edit that was undone
+    std::optional<UUID128> pCacheKey = MakeCacheKey(variant);
+    if (pCacheKey.has_value() && pCacheKey == variant.cacheKey) {
+        return;
+    }
+
+    vk::ShaderModule oldShaderModule = variant.shaderModule;
+    if (pCacheKey.has_value()) {
+        if (vk::ShaderModule shaderModule = LoadFromCache(variantIndex, *pCacheKey)) {
+            RetireShaderModule(oldShaderModule, shaderModule);
+            return;
+        }
+    }
+
+    Logger::Info("Recompile shader {}", variant.keyString);
+    _reloadTasks.push_back(ReloadTask{variantIndex, variant.reloadGeneration, SubmitCompile(variant)});
+}
+
+void ShaderManager::PublishReloads() {
+    std::erase_if(_reloadTasks, [this](ReloadTask &task) {
+        if (task.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        CompileResult result = task.future.get();
+        const ShaderVariant &variant = _variants[task.variantIndex];
+        if (variant.reloadGeneration != task.generation) {
+            return true;
+        }
+        // a failed compile keeps the old module, the error is in the log
+        vk::ShaderModule oldShaderModule = variant.shaderModule;
+        if (vk::ShaderModule shaderModule = FinishCompile(task.variantIndex, std::move(result))) {
+            RetireShaderModule(oldShaderModule, shaderModule);
+        }
+        return true;
+    });
+
+    if (_moduleReloads.empty()) {
+        return;
+    }
+    for (const ShaderReloadCallback &callback : _reloadCallbacks) {
+        callback(_moduleReloads);
+    }
+    _moduleReloads.clear();
+
+    // the callbacks have queued the pipelines that replace the ones built from the retired modules
+    for (RetiredShaderModule &retired : _retiredShaderModules) {
+        if (!retired.compileSerial.has_value()) {
+            retired.compileSerial = vkgfx::gPipelineCompileService->GetSubmittedSerial();
+        }
+    }
+}
+
+void ShaderManager::ReleaseRetiredShaderModules() {
+    vk::Device device = vkgfx::gDevice->GetVKDevice();
+    std::erase_if(_retiredShaderModules, [&](RetiredShaderModule &retired) {
+        if (!retired.compileSerial.has_value()) {
+            return false;
+        }
+        // until the replacements are published, the old pipelines are still the fallbacks drawn with
+        if (!retired.releaseFrame.has_value()) {
+            if (!vkgfx::gPipelineCompileService->IsPublished(*retired.compileSerial)) {
+                return false;
+            }
+            retired.releaseFrame = _frameCount;
+        }
+        if (*retired.releaseFrame + _numBackBuffers > _frameCount) {
+            return false;
+        }
+        vkgfx::gPipelineCompileService->EvictShaderModule(retired.shaderModule);
+        device.destroyShaderModule(retired.shaderModule);
+        _shaderReflectionMap.erase(retired.shaderModule);
+        return true;
+    });
+}
+
+void ShaderManager::RetireShaderModule(vk::ShaderModule oldShaderModule, vk::ShaderModule newShaderModule) {
+    // pipelines built from the old module may still be in flight, and its handle is part of their
+    // cache keys, so it lives until 'ReleaseRetiredShaderModules' has evicted those pipelines
+    if (oldShaderModule) {
+        _retiredShaderModules.push_back(RetiredShaderModule{oldShaderModule});
+    }
+    _moduleReloads.push_back(ShaderModuleReload{oldShaderModule, newShaderModule});
+}
+
+auto ShaderManager::MakeShaderKey(const ShaderLoadInfo &loadInfo) -> ShaderKey {
+    // two probes of the key table and the precomputed define hash, nothing is formatted or allocated
+    // once the path spelling and the entry point have been seen
+    return ShaderKey::Make(_keyTable.InternSourcePath(loadInfo.sourcePath),
+        _keyTable.InternEntryPoint(loadInfo.entryPoint),
+        loadInfo.shaderType,
+        loadInfo.pDefineList.HasValue() ? loadInfo.pDefineList->GetHash() : 0);
+}
+
+auto ShaderManager::MakeCacheKey(const ShaderVariant &variant) -> std::optional<UUID128> {
+    ShaderLoadInfo loadInfo = variant.GetLoadInfo();
+    uint64_t variantHash = MakeShaderVariantHash(loadInfo.entryPoint, loadInfo.shaderType, loadInfo.pDefineList);
+    std::optional<uint64_t> pClosureHash = _dependencyDatabase.GetClosureHash(variant.sourcePath, variantHash);
+    if (!pClosureHash.has_value()) {
+        return std::nullopt;
+    }
+    return MakeShaderCacheKey(variant.sourcePath,
+        *pClosureHash,
+        loadInfo.entryPoint,
+        loadInfo.shaderType,
+        loadInfo.pDefineList);
+}
+
+auto ShaderManager::CreateShaderModule(uint32_t variantIndex, UUID128 cacheKey, std::vector<char> byteCode)
+    -> vk::ShaderModule {
+
+    std::vector<char> strippedByteCode = vkgfx::ShaderCompiler::StripDebugInfo(byteCode);
+    _cacheArchive.Append(cacheKey, strippedByteCode);
+    if (_useDebugInfo) {
+        _debugCacheArchive.Append(cacheKey, byteCode);
+    }
+
+    ShaderVariant &variant = _variants[variantIndex];
+    std::span<const char> moduleByteCode = _useDebugInfo ? byteCode : strippedByteCode;
+    vk::ShaderModule shaderModule = LoadFromByteCode(variantIndex, moduleByteCode);
+    if (shaderModule) {
+        vkgfx::SetResourceName(vkgfx::gDevice->GetVKDevice(), shaderModule, variant.keyString);
+    }
+    variant.cacheKey = cacheKey;
     return shaderModule;
 }
 
-auto ShaderManager::LoadFromByteCode(UUID128 uuid, std::span<const char> byteCode) -> vk::ShaderModule {
+auto ShaderManager::LoadFromByteCode(uint32_t variantIndex, std::span<const char> byteCode) -> vk::ShaderModule {
     vk::ShaderModule shaderModule = nullptr;
     vk::Device device = vkgfx::gDevice->GetVKDevice();
     vk::ShaderModuleCreateInfo shaderModuleCreateInfo;
     shaderModuleCreateInfo.codeSize = byteCode.size();
     shaderModuleCreateInfo.pCode = reinterpret_cast<const uint32_t *>(byteCode.data());
     shaderModule = device.createShaderModule(shaderModuleCreateInfo);
-    _shaderModuleMap[uuid] = shaderModule;
+    _variants[variantIndex].shaderModule = shaderModule;
+
+    // reflect while the byte code is at hand, it is not kept once the module exists
+    auto pReflection = std::make_unique<vkgfx::ShaderReflection>();
+    if (!pReflection->Reflect(byteCode)) {
+        pReflection = nullptr;
+    }
+    _shaderReflectionMap[shaderModule] = std::move(pReflection);
     return shaderModule;
 }
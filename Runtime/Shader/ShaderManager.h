@@ -1,15 +1,27 @@
 #pragma once
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
 #include <unordered_map>
+#include <vector>
 #include <vulkan/vulkan.hpp>
+#include "Foundation/FileWatcher.h"
 #include "Foundation/RuntimeStatic.h"
 #include "Foundation/NonCopyable.h"
 #include "Foundation/NamespeceAlias.h"
 #include "Foundation/ObjectView.hpp"
+#include "Foundation/OpenHashMap.hpp"
 #include "Foundation/UUID128.h"
+#include "Shader/ShaderCacheArchive.h"
+#include "Shader/ShaderDependencyDatabase.h"
+#include "Shader/ShaderKey.h"
 #include "VulkanRenderer/EnumDefinition.h"
 
 namespace vkgfx {
 class DefineList;
+class ShaderReflection;
 }
 
 struct ShaderLoadInfo {
@@ -19,26 +31,101 @@ struct ShaderLoadInfo {
     ObjectView<const vkgfx::DefineList> pDefineList;
 };
 
-class ShaderDependency;
+// Handed to the reload callbacks once per frame. 'oldShaderModule' is null when the variant failed to
+// compile before. It is destroyed, with the cached pipelines built from it, once the pipeline compiles
+// submitted by the callbacks are published and the frames that drew with the old pipelines retired.
+struct ShaderModuleReload {
+    vk::ShaderModule oldShaderModule;
+    vk::ShaderModule newShaderModule;
+};
+
+using ShaderReloadCallback = std::function<void(std::span<const ShaderModuleReload>)>;
+
 class ShaderManager : public NonCopyable {
 public:
     ShaderManager();
     ~ShaderManager();
-    void Initialize();
+    void Initialize(size_t numBackBuffers);
     void Destroy();
     auto LoadShaderModule(const ShaderLoadInfo &loadInfo) -> vk::ShaderModule;
-    auto GetShaderDependency(stdfs::path path) -> ShaderDependency &;
+    // Loads many variants at once: duplicates are merged by key and the cache misses are compiled in
+    // parallel on gThreadPool. The result has one module per load info, null when compiling failed.
+    auto LoadShaderModules(std::span<const ShaderLoadInfo> loadInfos) -> std::vector<vk::ShaderModule>;
+    // Hot reload, called once per frame: recompiles the loaded variants that depend on the changed
+    // files on gThreadPool and swaps the finished modules in, then tells the reload callbacks.
+    void Update();
+    void AddReloadCallback(ShaderReloadCallback callback);
+    // the sources whose variants have to be rebuilt when 'path' changes
+    auto GetDependentSources(const stdfs::path &path) const -> std::vector<stdfs::path>;
     bool LoadShaderStageCreateInfo(const ShaderLoadInfo &loadInfo, vk::PipelineShaderStageCreateInfo &outputCreateInfo);
+    // reflected when the module was created, null for modules the manager does not own
+    auto GetShaderReflection(vk::ShaderModule shaderModule) const -> const vkgfx::ShaderReflection *;
 private:
-    auto LoadFromCache(UUID128 uuid, const stdfs::path &sourcePath, const stdfs::path &cachePath) -> vk::ShaderModule;
-    auto LoadFromByteCode(UUID128 uuid, std::span<const char> byteCode) -> vk::ShaderModule;
-    using ShaderModuleMap = std::unordered_map<UUID128, vk::ShaderModule>;
-    using ShaderByteCodeMap = std::unordered_map<UUID128, std::vector<char>>;
-    using ShaderDependencyMap = std::unordered_map<stdfs::path, std::unique_ptr<ShaderDependency>>;
+    // everything needed to compile a variant again, it outlives the caller's load info
+    struct ShaderVariant {
+        ShaderKey key;
+        stdfs::path sourcePath;
+        std::string entryPoint;
+        vkgfx::ShaderType shaderType = {};
+        std::shared_ptr<vkgfx::DefineList> pDefineList;
+        std::string keyString;
+        std::optional<UUID128> cacheKey;
+        vk::ShaderModule shaderModule = nullptr;    // null until it compiled once
+        uint32_t reloadGeneration = 0;
+    public:
+        auto GetLoadInfo() const -> ShaderLoadInfo;
+    };
+    struct CompileResult {
+        bool succeeded = false;
+        std::vector<char> byteCode;
+        std::vector<stdfs::path> includeFiles;
+        std::string errorMessage;
+    };
+    struct ReloadTask {
+        uint32_t variantIndex;
+        uint32_t generation;
+        std::future<CompileResult> future;
+    };
+    struct RetiredShaderModule {
+        vk::ShaderModule shaderModule;
+        std::optional<uint64_t> compileSerial;    // the last pipeline compile submitted by the callbacks
+        std::optional<size_t> releaseFrame;       // the frame that no longer drew with the old pipelines
+    };
+    // the index of the variant in '_variants', registered on the first sight of 'key'
+    auto RegisterVariant(const ShaderKey &key, const ShaderLoadInfo &loadInfo) -> uint32_t;
+    static auto CompileShader(const ShaderVariant &variant) -> CompileResult;
+    auto SubmitCompile(const ShaderVariant &variant) -> std::future<CompileResult>;
+    auto FinishCompile(uint32_t variantIndex, CompileResult result) -> vk::ShaderModule;
+    void ScheduleReload(uint32_t variantIndex);
+    void PublishReloads();
+    void RetireShaderModule(vk::ShaderModule oldShaderModule, vk::ShaderModule newShaderModule);
+    void ReleaseRetiredShaderModules();
+    auto MakeShaderKey(const ShaderLoadInfo &loadInfo) -> ShaderKey;
+    // nullopt until the variant compiled once, its include closure is unknown before that
+    auto MakeCacheKey(const ShaderVariant &variant) -> std::optional<UUID128>;
+    auto CreateShaderModule(uint32_t variantIndex, UUID128 cacheKey, std::vector<char> byteCode) -> vk::ShaderModule;
+    auto LoadFromCache(uint32_t variantIndex, UUID128 cacheKey) -> vk::ShaderModule;
+    auto LoadFromByteCode(uint32_t variantIndex, std::span<const char> byteCode) -> vk::ShaderModule;
+    using VariantIndexMap = nstd::OpenHashMap<ShaderKey, uint32_t, ShaderKeyHash>;
+    // retired modules keep their entry until they are released, pipelines may still be built from them
+    using ShaderReflectionMap = std::unordered_map<vk::ShaderModule, std::unique_ptr<vkgfx::ShaderReflection>>;
 private:
-    ShaderModuleMap _shaderModuleMap;
-    ShaderByteCodeMap _shaderByteCodeMap;
-    ShaderDependencyMap _shaderDependencyMap;
+    ShaderKeyTable _keyTable;
+    VariantIndexMap _variantIndexMap;
+    std::vector<ShaderVariant> _variants;
+    ShaderReflectionMap _shaderReflectionMap;
+    ShaderDependencyDatabase _dependencyDatabase;
+    std::unordered_map<stdfs::path, std::vector<uint32_t>> _sourceVariantMap;
+    FileWatcher _fileWatcher;
+    std::vector<ReloadTask> _reloadTasks;
+    std::vector<ShaderModuleReload> _moduleReloads;
+    std::vector<RetiredShaderModule> _retiredShaderModules;
+    std::vector<ShaderReloadCallback> _reloadCallbacks;
+    size_t _numBackBuffers = 0;
+    size_t _frameCount = 0;
+    bool _useDebugInfo = false;
+    ShaderCacheArchive _cacheArchive;
+    ShaderCacheArchive _debugCacheArchive;    // full bytecode, only opened while RenderDoc is loaded
 };
 
 inline RuntimeStatic<ShaderManager> gShaderManager;
\ No newline at end of file
@@ -29,21 +29,25 @@ void AssetProjectSetting::Destroy() {
 void AssetProjectSetting::SetAssetRelativePath(stdfs::path path) {
     _assetRelativePath = std::move(path);
     RepairPath(_assetRelativePath, _assetAbsolutePath);
+    SerializeToFileAsync();
 }
 
 void AssetProjectSetting::SetAssetAbsolutePath(stdfs::path path) {
     _assetAbsolutePath = std::move(path);
     RepairPath(_assetRelativePath, _assetAbsolutePath);
+    SerializeToFileAsync();
 }
 
 void AssetProjectSetting::SetAssetCacheRelativePath(stdfs::path path) {
     _assetCacheRelativePath = std::move(path);
     RepairPath(_assetCacheRelativePath, _assetCacheAbsolutePath);
+    SerializeToFileAsync();
 }
 
 void AssetProjectSetting::SetAssetCacheAbsolutePath(stdfs::path path) {
     _assetCacheAbsolutePath = std::move(path);
     RepairPath(_assetCacheRelativePath, _assetCacheAbsolutePath);
+    SerializeToFileAsync();
 }
 
 bool AssetProjectSetting::SerializeToFile() {
@@ -51,6 +55,13 @@ bool AssetProjectSetting::SerializeToFile() {
     return Serialize(jsonWriter, *this);
 }
 
+auto AssetProjectSetting::SerializeToFileAsync(AsyncFileWriter::Callback callback) -> std::shared_future<bool> {
+    TransferJsonWriter jsonWriter(sSerializePath);
+    jsonWriter.SetAsync(std::move(callback));
+    Serialize(jsonWriter, *this);
+    return jsonWriter.GetFuture();
+}
+
 void AssetProjectSetting::RepairPath(stdfs::path &relativePath, stdfs::path &absolutePath) {
     if (!relativePath.empty() && !relativePath.is_relative()) {
 	   relativePath =  relative(relativePath);
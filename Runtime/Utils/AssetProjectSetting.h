@@ -11,11 +11,14 @@ class AssetProjectSetting : public TypeBase {
 public:
     void Initialize();
     void Destroy();
+    // the setters save the settings in the background, a changed path survives a crash
     void SetAssetRelativePath(stdfs::path path);
     void SetAssetAbsolutePath(stdfs::path path);
     void SetAssetCacheRelativePath(stdfs::path path);
     void SetAssetCacheAbsolutePath(stdfs::path path);
     bool SerializeToFile();
+    // returns as soon as the file is queued, 'callback' runs on the I/O thread
+    auto SerializeToFileAsync(AsyncFileWriter::Callback callback = nullptr) -> std::shared_future<bool>;
 
     auto GetAssetRelativePath() const -> const stdfs::path & {
         return _assetRelativePath;
@@ -1,99 +1,220 @@
 #include "DefineList.h"
 #include <algorithm>
-#include <sstream>
+#include <charconv>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 #include <fmt/format.h>
-#include <regex>
 
 #include "Foundation/Exception.h"
+#include "Foundation/Hash.hpp"
 
 namespace vkgfx {
 
+namespace {
+
+struct MacroNameTable {
+    std::mutex mutex;
+    // a deque never moves its elements, so the views handed out stay valid
+    std::deque<std::string> names;
+    std::vector<uint64_t> nameHashes;
+    std::unordered_map<std::string_view, DefineList::MacroID> idMap;
+};
+
+auto GetMacroNameTable() -> MacroNameTable & {
+    static MacroNameTable table;
+    return table;
+}
+
+auto GetMacroNameHash(DefineList::MacroID id) -> uint64_t {
+    MacroNameTable &table = GetMacroNameTable();
+    std::lock_guard lock(table.mutex);
+    ExceptionAssert(id < table.nameHashes.size());
+    return table.nameHashes[id];
+}
+
+auto IsIdentifierChar(char c, bool first) -> bool {
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (!first && c >= '0' && c <= '9');
+}
+
+}    // namespace
+
+auto DefineList::MacroItem::GetKey() const -> std::string_view {
+    return GetMacroName(id);
+}
+
 void DefineList::Set(std::string_view key, int value) {
-    auto iter = Find(key);
-    if (iter != _macroItems.end()) {
-        iter->value = value;
+    Set(InternMacro(key), value);
+}
+
+void DefineList::Set(MacroID id, int value) {
+    size_t index = LowerBound(id);
+    MacroItem *pItems = GetItems();
+    if (index < _count && pItems[index].id == id) {
+        _hash -= HashItem(id, pItems[index].value);
+        pItems[index].value = value;
+        _hash += HashItem(id, value);
+        return;
     }
-    auto &back = _macroItems.emplace_back();
-    back.key = key;
-    back.value = value;
+    InsertAt(index, MacroItem{id, value});
+    _hash += HashItem(id, value);
 }
 
 auto DefineList::Get(std::string_view key) const -> std::optional<int> {
-    auto iter = Find(key);
-    if (iter == _macroItems.end()) {
+    std::optional<MacroID> pID = FindMacro(key);
+    if (!pID.has_value()) {
+        return std::nullopt;
+    }
+    size_t index = LowerBound(*pID);
+    if (index == _count || GetItems()[index].id != *pID) {
         return std::nullopt;
     }
-    return std::make_optional(iter->value);
+    return std::make_optional(GetItems()[index].value);
 }
 
 bool DefineList::Remove(std::string_view key) {
-    auto iter = Find(key);
-    if (iter == _macroItems.end()) {
+    std::optional<MacroID> pID = FindMacro(key);
+    if (!pID.has_value()) {
         return false;
     }
-    _macroItems.erase(iter);
+    size_t index = LowerBound(*pID);
+    if (index == _count || GetItems()[index].id != *pID) {
+        return false;
+    }
+    _hash -= HashItem(*pID, GetItems()[index].value);
+    EraseAt(index);
     return true;
 }
 
 void DefineList::Clear() {
-    _macroItems.clear();
+    _heapItems.clear();
+    _count = 0;
+    _hash = 0;
 }
 
-auto DefineList::GetCount() const -> size_t {
-    return _macroItems.size();
+auto DefineList::ToString() const -> std::string {
+    std::vector<std::pair<std::string_view, int>> items;
+    items.reserve(_count);
+    for (const MacroItem &item : *this) {
+        items.emplace_back(item.GetKey(), item.value);
+    }
+    std::ranges::sort(items);
+
+    std::string result;
+    for (auto &&[key, value] : items) {
+        fmt::format_to(std::back_inserter(result), "#{}={}", key, value);
+    }
+    return result;
 }
 
-auto DefineList::operator[](std::string_view key) -> int & {
-    auto iter = Find(key);
-    if (iter != _macroItems.end()) {
-        return iter->value;
+auto DefineList::FromString(std::string_view source) -> size_t {
+    // every KEY=VALUE in 'source', the separators in between are ignored
+    size_t count = 0;
+    size_t pos = 0;
+    while (pos < source.size()) {
+        if (!IsIdentifierChar(source[pos], true)) {
+            ++pos;
+            continue;
+        }
+        size_t keyBegin = pos;
+        while (pos < source.size() && IsIdentifierChar(source[pos], false)) {
+            ++pos;
+        }
+        std::string_view key = source.substr(keyBegin, pos - keyBegin);
+        if (pos == source.size() || source[pos] != '=') {
+            continue;
+        }
+
+        int value = 0;
+        const char *pBegin = source.data() + pos + 1;
+        const char *pEnd = source.data() + source.size();
+        auto [pNext, errorCode] = std::from_chars(pBegin, pEnd, value);
+        if (errorCode != std::errc{}) {
+            continue;
+        }
+        Set(key, value);
+        ++count;
+        pos = static_cast<size_t>(pNext - source.data());
     }
-    auto &back = _macroItems.emplace_back();
-    back.key = key;
-    back.value = 1;
-    return back.value;
+    return count;
 }
 
-auto DefineList::ToString() const -> std::string {
-    std::ranges::stable_sort(_macroItems, [](const MacroItem &lhs, const MacroItem &rhs) {
-        return lhs.key < rhs.key;
+bool operator==(const DefineList &lhs, const DefineList &rhs) {
+    if (lhs._count != rhs._count || lhs._hash != rhs._hash) {
+        return false;
+    }
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), [](const auto &left, const auto &right) {
+        return left.id == right.id && left.value == right.value;
     });
+}
+
+auto DefineList::InternMacro(std::string_view key) -> MacroID {
+    MacroNameTable &table = GetMacroNameTable();
+    std::lock_guard lock(table.mutex);
+    if (auto iter = table.idMap.find(key); iter != table.idMap.end()) {
+        return iter->second;
+    }
+
+    MacroID id = static_cast<MacroID>(table.names.size());
+    const std::string &name = table.names.emplace_back(key);
+    table.nameHashes.push_back(nstd::FNV1a64(name));
+    table.idMap.emplace(name, id);
+    return id;
+}
 
-    std::stringstream sbuf;
-    for (const MacroItem &item : _macroItems) {
-        sbuf << fmt::format("#{}={}", item.key.c_str(), item.value);
+auto DefineList::FindMacro(std::string_view key) -> std::optional<MacroID> {
+    MacroNameTable &table = GetMacroNameTable();
+    std::lock_guard lock(table.mutex);
+    auto iter = table.idMap.find(key);
+    if (iter == table.idMap.end()) {
+        return std::nullopt;
     }
-    return sbuf.str();
+    return iter->second;
 }
 
-static DefineList::MacroItem ParseMacroItem(std::string_view string) {
-	DefineList::MacroItem item;
-	size_t pos = string.find("=");
-    ExceptionAssert(pos != std::string_view::npos);
-    item.key = string.substr(0, pos);
-    item.value = std::stoi(string.substr(pos+1).data());
-    return item;
+auto DefineList::GetMacroName(MacroID id) -> std::string_view {
+    MacroNameTable &table = GetMacroNameTable();
+    std::lock_guard lock(table.mutex);
+    ExceptionAssert(id < table.names.size());
+    return table.names[id];
 }
 
-auto DefineList::FromString(std::string source) -> size_t {
-    size_t count = 0;
-    std::smatch match;
-    std::regex pattern("[_a-zA-Z][a-zA-Z0-9_]*=[0-9]+");
-    while (std::regex_search(source, match, pattern)) {
-		_macroItems.push_back(ParseMacroItem(match.str()));
-        ++count;
-        source = match.suffix().str();
+auto DefineList::HashItem(MacroID id, int value) -> uint64_t {
+    // the items are summed up, so every item hash has to be well mixed on its own (splitmix64)
+    uint64_t hash = nstd::HashCombine(GetMacroNameHash(id), static_cast<uint32_t>(value));
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+auto DefineList::LowerBound(MacroID id) const -> size_t {
+    const MacroItem *pItems = GetItems();
+    const MacroItem *pIter = std::lower_bound(pItems, pItems + _count, id, [](const MacroItem &item, MacroID id) {
+        return item.id < id;
+    });
+    return static_cast<size_t>(pIter - pItems);
+}
+
+void DefineList::InsertAt(size_t index, const MacroItem &item) {
+    if (_heapItems.empty() && _count == kInlineCapacity) {
+        _heapItems.assign(_inlineItems, _inlineItems + _count);
     }
-    return count;
+    if (!_heapItems.empty()) {
+        _heapItems.insert(_heapItems.begin() + index, item);
+    } else {
+        std::copy_backward(_inlineItems + index, _inlineItems + _count, _inlineItems + _count + 1);
+        _inlineItems[index] = item;
+    }
+    ++_count;
 }
 
-auto DefineList::Find(std::string_view key) const -> std::vector<MacroItem>::iterator {
-    for (auto iter = _macroItems.begin(); iter != _macroItems.end(); ++iter) {
-        if (iter->key == key) {
-            return iter;
-        }
+void DefineList::EraseAt(size_t index) {
+    if (!_heapItems.empty()) {
+        _heapItems.erase(_heapItems.begin() + index);
+    } else {
+        std::copy(_inlineItems + index + 1, _inlineItems + _count, _inlineItems + index);
     }
-    return _macroItems.end();
+    --_count;
 }
 
 }    // namespace vkgfx
@@ -1,40 +1,74 @@
 #pragma once
+#include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
-#include "Foundation/NonCopyable.h"
 
 namespace vkgfx {
 
-class DefineList : public NonCopyable {
+// Macro definitions of a shader variant. The names are interned into MacroIDs, the items are kept
+// sorted by ID in a small inline buffer, and an order independent 64-bit hash is updated on every
+// change, so comparing and hashing a variant never touches a string.
+class DefineList {
 public:
+    using MacroID = uint32_t;
     struct MacroItem {
-        std::string key;
+        MacroID id;
         int value;
+    public:
+        auto GetKey() const -> std::string_view;
     };
-    using iterator = std::vector<MacroItem>::iterator;
-    using const_iterator = std::vector<MacroItem>::const_iterator;
+    using const_iterator = const MacroItem *;
 public:
     DefineList() = default;
     void Set(std::string_view key, int value = 1);
+    void Set(MacroID id, int value = 1);
     auto Get(std::string_view key) const -> std::optional<int>;
     bool Remove(std::string_view key);
     void Clear();
-    auto GetCount() const -> size_t;
-    auto operator[](std::string_view key) -> int &;
+    auto GetCount() const -> size_t {
+        return _count;
+    }
+    // stable across runs, unlike the MacroIDs, so it can be part of an on-disk key
+    auto GetHash() const -> uint64_t {
+        return _hash;
+    }
+    // "#KEY=VALUE" for every item, sorted by name
     auto ToString() const -> std::string;
-    auto FromString(std::string source) -> size_t;
+    auto FromString(std::string_view source) -> size_t;
 
     auto begin() const -> const_iterator {
-        return _macroItems.begin();
+        return GetItems();
     }
     auto end() const -> const_iterator {
-        return _macroItems.end();
+        return GetItems() + _count;
     }
+    friend bool operator==(const DefineList &lhs, const DefineList &rhs);
+
+    // names are interned once per process and never released
+    static auto InternMacro(std::string_view key) -> MacroID;
+    static auto FindMacro(std::string_view key) -> std::optional<MacroID>;
+    static auto GetMacroName(MacroID id) -> std::string_view;
 private:
-    auto Find(std::string_view key) const -> iterator;
+    static constexpr size_t kInlineCapacity = 8;
+    static auto HashItem(MacroID id, int value) -> uint64_t;
+    auto GetItems() const -> const MacroItem * {
+        return _heapItems.empty() ? _inlineItems : _heapItems.data();
+    }
+    auto GetItems() -> MacroItem * {
+        return _heapItems.empty() ? _inlineItems : _heapItems.data();
+    }
+    // index of the first item with an ID not less than 'id'
+    auto LowerBound(MacroID id) const -> size_t;
+    void InsertAt(size_t index, const MacroItem &item);
+    void EraseAt(size_t index);
 private:
-    mutable std::vector<MacroItem> _macroItems;
+    // the inline buffer is used until it overflows, after that '_heapItems' holds all '_count' items
+    MacroItem _inlineItems[kInlineCapacity] = {};
+    std::vector<MacroItem> _heapItems;
+    uint32_t _count = 0;
+    uint64_t _hash = 0;
 };
 
 }    // namespace vkgfx
@@ -3,9 +3,15 @@
 #include "InstanceProperties.h"
 #include "ExtDebugUtils.h"
 #include "ExtValidation.h"
+#include "Foundation/AsyncFileWriter.h"
 #include "Foundation/Exception.h"
+#include "Foundation/Hash.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <map>
+#include <type_traits>
 #include <Windows.h>
 #include <vulkan/vulkan_win32.h>
 
@@ -111,6 +117,17 @@ auto Device::GetComputeQueue() const -> vk::Queue {
     return _computeQueue;
 }
 
+auto Device::GetTransferQueue() const -> vk::Queue {
+    return _transferQueue;
+}
+
+auto Device::LockQueue(vk::Queue queue) -> std::unique_lock<std::mutex> {
+    if (queue && queue == _sharedQueue) {
+        return std::unique_lock(_sharedQueueMutex);
+    }
+    return {};
+}
+
 auto Device::GetPresentQueueFamilyIndex() const -> uint32_t {
     return _presentQueueFamilyIndex;
 }
@@ -123,6 +140,10 @@ auto Device::GetComputeQueueFamilyIndex() const -> uint32_t {
     return _computeQueueFamilyIndex;
 }
 
+auto Device::GetTransferQueueFamilyIndex() const -> uint32_t {
+    return _transferQueueFamilyIndex;
+}
+
 auto Device::GetPhysicalDevice() const -> vk::PhysicalDevice {
     return _physicalDevice;
 }
@@ -147,16 +168,129 @@ auto Device::GetPhysicalDeviceSubgroupProperties() const -> vk::PhysicalDeviceSu
     return _physicalDeviceSubgroupProperties;
 }
 
-void Device::CreatePipelineCache() {
+namespace {
+
+struct PipelineCacheFileHeader {
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t vendorID = 0;
+    uint32_t deviceID = 0;
+    uint32_t driverVersion = 0;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE] = {};
+    uint32_t reserved = 0;    // spells out the padding before 'dataSize', so every byte of the file is set
+    uint64_t dataSize = 0;
+    uint64_t dataHash = 0;
+};
+static_assert(std::has_unique_object_representations_v<PipelineCacheFileHeader>);
+
+constexpr uint32_t kPipelineCacheMagic = 0x43505856;    // "VXPC"
+constexpr uint32_t kPipelineCacheVersion = 1;
+
+auto MakePipelineCacheFileHeader(const vk::PhysicalDeviceProperties &properties) -> PipelineCacheFileHeader {
+    PipelineCacheFileHeader header;
+    header.magic = kPipelineCacheMagic;
+    header.version = kPipelineCacheVersion;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+    return header;
+}
+
+auto ReadPipelineCacheFile(const stdfs::path &cachePath, const vk::PhysicalDeviceProperties &properties)
+    -> std::vector<char> {
+
+    std::ifstream fin(cachePath, std::ios::binary);
+    if (!fin.is_open()) {
+        return {};
+    }
+
+    PipelineCacheFileHeader header;
+    PipelineCacheFileHeader expected = MakePipelineCacheFileHeader(properties);
+    fin.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!fin || header.magic != expected.magic || header.version != expected.version ||
+        header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+        header.driverVersion != expected.driverVersion ||
+        std::memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        Logger::Warning("Pipeline cache {} was written by another device or driver, ignored", cachePath.string());
+        return {};
+    }
+
+    // the size comes from the file, a damaged one must not turn into a huge allocation
+    std::error_code errorCode;
+    uintmax_t fileSize = stdfs::file_size(cachePath, errorCode);
+    if (errorCode || header.dataSize != fileSize - sizeof(header)) {
+        Logger::Warning("Pipeline cache {} is truncated, ignored", cachePath.string());
+        return {};
+    }
+
+    std::vector<char> data(header.dataSize);
+    fin.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!fin || nstd::FNV1a64(data.data(), data.size()) != header.dataHash) {
+        Logger::Warning("Pipeline cache {} is corrupted, ignored", cachePath.string());
+        return {};
+    }
+    return data;
+}
+
+}    // namespace
+
+void Device::CreatePipelineCache(const stdfs::path &cachePath) {
+    _pipelineCachePath = cachePath;
+    std::vector<char> data = ReadPipelineCacheFile(cachePath, _physicalDeviceProperties);
+
     vk::PipelineCacheCreateInfo pipelineCacheInfo = {};
+    pipelineCacheInfo.initialDataSize = data.size();
+    pipelineCacheInfo.pInitialData = data.data();
     _pipelineCache = _device.createPipelineCache(pipelineCacheInfo);
+    _savedPipelineCacheSize = data.size();
+    Logger::Info("Pipeline cache loaded {} bytes from {}", data.size(), cachePath.string());
 }
 
 void Device::DestroyPipelineCache() {
+    SavePipelineCache();
     _device.destroyPipelineCache(_pipelineCache);
     _pipelineCache = nullptr;
 }
 
+bool Device::SavePipelineCache() {
+    if (!_pipelineCache || _pipelineCachePath.empty()) {
+        return false;
+    }
+
+    // the cache only grows, an unchanged size means nothing new was compiled
+    std::vector<uint8_t> data = _device.getPipelineCacheData(_pipelineCache);
+    if (_pipelineCacheSaveFuture.valid() && _pipelineCacheSaveFuture.wait_for(std::chrono::seconds(0)) ==
+        std::future_status::ready) {
+        // the last write failed, the data on disk is older than '_savedPipelineCacheSize' says
+        if (!_pipelineCacheSaveFuture.get()) {
+            _savedPipelineCacheSize = 0;
+        }
+        _pipelineCacheSaveFuture = {};
+    }
+    if (data.size() == _savedPipelineCacheSize) {
+        return true;
+    }
+
+    PipelineCacheFileHeader header = MakePipelineCacheFileHeader(_physicalDeviceProperties);
+    header.dataSize = data.size();
+    header.dataHash = nstd::FNV1a64(data.data(), data.size());
+
+    std::string content(sizeof(header) + data.size(), '\0');
+    std::memcpy(content.data(), &header, sizeof(header));
+    std::memcpy(content.data() + sizeof(header), data.data(), data.size());
+
+    std::error_code errorCode;
+    stdfs::create_directories(_pipelineCachePath.parent_path(), errorCode);
+
+    // written on the I/O thread through a temporary file, a crash never leaves a truncated cache behind
+    AsyncFileWriter::File file = gAsyncFileWriter->Open(_pipelineCachePath);
+    file.Append(std::move(content));
+    _pipelineCacheSaveFuture = file.Commit();
+    _savedPipelineCacheSize = data.size();
+    return true;
+}
+
 auto Device::GetPipelineCache() const -> vk::PipelineCache {
     return _pipelineCache;
 }
@@ -209,22 +343,50 @@ void Device::OnCreateEx(const DeviceProperties &deviceProperties) {
         }
     }
 
-    uint32_t queueCount = 1;
-    float queuePriorities[1] = {0.f};
-    vk::DeviceQueueCreateInfo queueCreateInfos[2];
-    queueCreateInfos[0].sType = vk::StructureType::eDeviceQueueCreateInfo;
-    queueCreateInfos[0].pNext = nullptr;
-    queueCreateInfos[0].queueCount = 1;
-    queueCreateInfos[0].pQueuePriorities = queuePriorities;
-    queueCreateInfos[0].queueFamilyIndex = _graphicsQueueFamilyIndex;
-
-    if (_computeQueueFamilyIndex != _graphicsQueueFamilyIndex) {
-        queueCount = 2;
-        queueCreateInfos[1].sType = vk::StructureType::eDeviceQueueCreateInfo;
-        queueCreateInfos[1].pNext = nullptr;
-        queueCreateInfos[1].queueCount = 1;
-        queueCreateInfos[1].pQueuePriorities = queuePriorities;
-        queueCreateInfos[1].queueFamilyIndex = _computeQueueFamilyIndex;
+    // prefer a transfer-only family (the copy engine), then any non-graphics family that can copy,
+    // so uploads do not compete with rendering on the graphics queue
+    for (size_t i = 0; i < queueProps.size(); ++i) {
+        const vk::QueueFamilyProperties &prop = queueProps[i];
+        if (!(prop.queueFlags & vk::QueueFlagBits::eTransfer) || (prop.queueFlags & vk::QueueFlagBits::eGraphics)) {
+            continue;
+        }
+        if (!(prop.queueFlags & vk::QueueFlagBits::eCompute)) {
+            _transferQueueFamilyIndex = i;
+            break;
+        }
+        if (_transferQueueFamilyIndex == -1) {
+            _transferQueueFamilyIndex = i;
+        }
+    }
+    if (_transferQueueFamilyIndex == -1) {
+        _transferQueueFamilyIndex = _graphicsQueueFamilyIndex;
+    }
+
+    // without a copy engine the transfer family is the compute family, it then takes a second queue of
+    // that family when there is one, so uploads and compute work don't have to share a queue
+    uint32_t transferQueueIndex = 0;
+    if (_transferQueueFamilyIndex == _computeQueueFamilyIndex &&
+        _transferQueueFamilyIndex != _graphicsQueueFamilyIndex &&
+        queueProps[_transferQueueFamilyIndex].queueCount > 1) {
+        transferQueueIndex = 1;
+    }
+
+    float queuePriorities[2] = {0.f, 0.f};
+    std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+    for (uint32_t familyIndex : {_graphicsQueueFamilyIndex, _computeQueueFamilyIndex, _transferQueueFamilyIndex}) {
+        auto iter = std::find_if(queueCreateInfos.begin(), queueCreateInfos.end(), [=](const auto &createInfo) {
+            return createInfo.queueFamilyIndex == familyIndex;
+        });
+        if (familyIndex == -1 || iter != queueCreateInfos.end()) {
+            continue;
+        }
+        vk::DeviceQueueCreateInfo queueCreateInfo;
+        queueCreateInfo.sType = vk::StructureType::eDeviceQueueCreateInfo;
+        queueCreateInfo.pNext = nullptr;
+        queueCreateInfo.queueCount = (familyIndex == _transferQueueFamilyIndex) ? transferQueueIndex + 1 : 1;
+        queueCreateInfo.pQueuePriorities = queuePriorities;
+        queueCreateInfo.queueFamilyIndex = familyIndex;
+        queueCreateInfos.push_back(queueCreateInfo);
     }
 
     vk::PhysicalDeviceFeatures physicalDeviceFeatures = {};
@@ -243,10 +405,17 @@ void Device::OnCreateEx(const DeviceProperties &deviceProperties) {
         .shaderSubgroupExtendedTypes = VK_TRUE,
     };
 
+    // UploadHeap signals a timeline semaphore that the graphics queue waits on
+    vk::PhysicalDeviceTimelineSemaphoreFeatures timelineSemaphore = {
+        .sType = vk::StructureType::ePhysicalDeviceTimelineSemaphoreFeatures,
+        .pNext = &shaderSubgroupExtendedType,
+        .timelineSemaphore = VK_TRUE,
+    };
+
     // bufferԽΪ
     vk::PhysicalDeviceRobustness2FeaturesEXT robustness2 = {
         .sType = vk::StructureType::ePhysicalDeviceRobustness2FeaturesEXT,
-        .pNext = &shaderSubgroupExtendedType,
+        .pNext = &timelineSemaphore,
         .nullDescriptor = VK_TRUE,
     };
 
@@ -260,8 +429,8 @@ void Device::OnCreateEx(const DeviceProperties &deviceProperties) {
 
     deviceCreateInfo.sType = vk::StructureType::eDeviceCreateInfo;
     deviceCreateInfo.pNext = &physicalDeviceFeatures2;
-    deviceCreateInfo.queueCreateInfoCount = queueCount;
-    deviceCreateInfo.pQueueCreateInfos = queueCreateInfos;
+    deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+    deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
     deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceProperties._deviceExtensionNames.size());
     deviceCreateInfo.ppEnabledExtensionNames = deviceProperties._deviceExtensionNames.data();
 
@@ -292,6 +461,23 @@ void Device::OnCreateEx(const DeviceProperties &deviceProperties) {
     } else if (_computeQueueFamilyIndex > -1) {
         _computeQueue = _device.getQueue(_computeQueueFamilyIndex, 0);
     }
+
+    if (_transferQueueFamilyIndex == _graphicsQueueFamilyIndex) {
+        _transferQueue = _graphicsQueue;
+    } else {
+        _transferQueue = _device.getQueue(_transferQueueFamilyIndex, transferQueueIndex);
+    }
+    // the graphics queue is only submitted to from the main thread, sharing it needs no lock
+    if (_transferQueue == _graphicsQueue) {
+        Logger::Info("The uploads run on the graphics queue");
+    } else if (_transferQueue == _computeQueue) {
+        _sharedQueue = _transferQueue;
+        Logger::Warning("The transfer and compute work share one queue, the submissions are serialized");
+    }
+    Logger::Info("Queue family index: graphics {}, compute {}, transfer {}",
+        _graphicsQueueFamilyIndex,
+        _computeQueueFamilyIndex,
+        _transferQueueFamilyIndex);
 }
 
 static uint32_t GetScore(vk::PhysicalDevice physicalDevice) {
@@ -1,7 +1,10 @@
 #pragma once
+#include <future>
+#include <mutex>
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.h>
 #include <GLFW/glfw3.h>
+#include "Foundation/NamespeceAlias.h"
 #include "Foundation/NonCopyable.h"
 #include "Foundation/RuntimeStatic.h"
 
@@ -25,17 +28,26 @@ public:
     auto GetPresentQueue() const -> vk::Queue;
     auto GetGraphicsQueue() const -> vk::Queue;
     auto GetComputeQueue() const -> vk::Queue;
+    auto GetTransferQueue() const -> vk::Queue;
+    // Compute and transfer share one queue when their family has no second one. Hold this lock while
+    // submitting to such a queue; for any other queue the lock is empty
+    auto LockQueue(vk::Queue queue) -> std::unique_lock<std::mutex>;
     auto GetPresentQueueFamilyIndex() const -> uint32_t;
     auto GetGraphicsQueueFamilyIndex() const -> uint32_t;
     auto GetComputeQueueFamilyIndex() const -> uint32_t;
+    auto GetTransferQueueFamilyIndex() const -> uint32_t;
     auto GetPhysicalDevice() const -> vk::PhysicalDevice;
     auto GetSurface() const -> vk::SurfaceKHR;
     auto GetAllocator() const -> VmaAllocator;
     auto GetPhysicalDeviceMemoryProperties() const -> vk::PhysicalDeviceMemoryProperties;
     auto GetPhysicalDeviceProperties() const -> vk::PhysicalDeviceProperties;
     auto GetPhysicalDeviceSubgroupProperties() const -> vk::PhysicalDeviceSubgroupProperties;
-    void CreatePipelineCache();
+    // Loads the cache file when it was written by the same device and driver, the file is written back
+    // by 'SavePipelineCache' and 'DestroyPipelineCache'. The writes are queued on 'gAsyncFileWriter',
+    // which must outlive the device.
+    void CreatePipelineCache(const stdfs::path &cachePath);
     void DestroyPipelineCache();
+    bool SavePipelineCache();
     auto GetPipelineCache() const -> vk::PipelineCache;
     void WaitGPUFlush();
 private:
@@ -61,13 +73,20 @@ private:
     vk::Queue _presentQueue;
     vk::Queue _graphicsQueue;
     vk::Queue _computeQueue;
+    vk::Queue _transferQueue;
+    vk::Queue _sharedQueue;
+    std::mutex _sharedQueueMutex;
     uint32_t _presentQueueFamilyIndex = -1;
     uint32_t _graphicsQueueFamilyIndex = -1;
     uint32_t _computeQueueFamilyIndex = -1;
+    uint32_t _transferQueueFamilyIndex = -1;
     bool _usingValidationLayer = false;
     bool _usingFp16 = false;
     VmaAllocator _hAllocator = nullptr;
     vk::PipelineCache _pipelineCache;
+    stdfs::path _pipelineCachePath;
+    size_t _savedPipelineCacheSize = 0;
+    std::shared_future<bool> _pipelineCacheSaveFuture;
 };
 
 inline RuntimeStatic<Device> gDevice;
@@ -1,5 +1,9 @@
 #include "DxcModule.h"
 #include "combaseapi.h"
+#include "Foundation/Hash.hpp"
+#include "Foundation/Logger.h"
+#include "Foundation/ThreadPool.h"
+#include <fmt/format.h>
 
 namespace vkgfx {
 
@@ -8,6 +12,27 @@ void DxcModule::OnCreate() {
 	DxcCreateInstance(CLSID_DxcLinker, IID_PPV_ARGS(&_pLinker));
 	DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&_pUtils));
 	DxcCreateInstance(CLSID_DxcLibrary, IID_PPV_ARGS(&_pLibrary));
+	_workerContexts.resize(gThreadPool->GetThreadCount());
+
+	std::string version = "unknown";
+	Microsoft::WRL::ComPtr<IDxcVersionInfo> pVersionInfo;
+	if (SUCCEEDED(_pCompiler.As(&pVersionInfo))) {
+		UINT32 major = 0;
+		UINT32 minor = 0;
+		pVersionInfo->GetVersion(&major, &minor);
+		version = fmt::format("{}.{}", major, minor);
+	}
+	Microsoft::WRL::ComPtr<IDxcVersionInfo2> pVersionInfo2;
+	if (SUCCEEDED(_pCompiler.As(&pVersionInfo2))) {
+		UINT32 commitCount = 0;
+		char *pCommitHash = nullptr;
+		if (SUCCEEDED(pVersionInfo2->GetCommitInfo(&commitCount, &pCommitHash))) {
+			version += fmt::format("-{}-{}", commitCount, (pCommitHash != nullptr) ? pCommitHash : "");
+			CoTaskMemFree(pCommitHash);
+		}
+	}
+	_versionHash = nstd::FNV1a64(version);
+	Logger::Info("Dxc compiler version: {}", version);
 }
 
 void DxcModule::OnDestroy() {
@@ -15,11 +40,39 @@ void DxcModule::OnDestroy() {
 	_pLinker = nullptr;
 	_pLibrary = nullptr;
 	_pCompiler = nullptr;
+	_workerContexts.clear();
 }
 
 auto DxcModule::GetCompiler3() const -> IDxcCompiler3 * {
 	return _pCompiler.Get();
 }
+auto DxcModule::GetThreadCompiler3() -> IDxcCompiler3 * {
+	WorkerContext *pContext = GetWorkerContext();
+	if (pContext == nullptr) {
+		return _pCompiler.Get();
+	}
+	if (pContext->pCompiler == nullptr) {
+		DxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&pContext->pCompiler));
+	}
+	return pContext->pCompiler.Get();
+}
+
+auto DxcModule::GetThreadUtils() -> IDxcUtils * {
+	WorkerContext *pContext = GetWorkerContext();
+	if (pContext == nullptr) {
+		return _pUtils.Get();
+	}
+	if (pContext->pUtils == nullptr) {
+		DxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&pContext->pUtils));
+	}
+	return pContext->pUtils.Get();
+}
+
+auto DxcModule::GetWorkerContext() -> WorkerContext * {
+	size_t workerIndex = ThreadPool::GetWorkerIndex();
+	return (workerIndex < _workerContexts.size()) ? &_workerContexts[workerIndex] : nullptr;
+}
+
 auto DxcModule::GetLinker() const -> IDxcLinker * {
 	return _pLinker.Get();
 }
@@ -31,4 +84,8 @@ auto DxcModule::GetLibrary() const -> IDxcLibrary * {
 	return _pLibrary.Get();
 }
 
+auto DxcModule::GetVersionHash() const -> uint64_t {
+	return _versionHash;
+}
+
 }
@@ -1,25 +1,42 @@
 #pragma once
 #include <Windows.h>
 #include <dxcapi.h>
+#include <cstdint>
+#include <vector>
 #include <wrl/client.h>
 #include "Foundation/NonCopyable.h"
 #include "Foundation/RuntimeStatic.h"
 
 namespace vkgfx {
 
+// IDxcCompiler3 is not safe to share between threads, so the main thread and every worker of
+// gThreadPool get their own compiler and utils through 'GetThreadCompiler3' / 'GetThreadUtils'.
 class DxcModule : public NonCopyable {
 public:
     void OnCreate();
     void OnDestroy();
     auto GetCompiler3() const -> IDxcCompiler3 *;
+    auto GetThreadCompiler3() -> IDxcCompiler3 *;
+    auto GetThreadUtils() -> IDxcUtils *;
     auto GetLinker() const -> IDxcLinker *;
     auto GetUtils() const -> IDxcUtils *;
     auto GetLibrary() const -> IDxcLibrary *;
+    // identifies the compiler build, part of every shader cache key
+    auto GetVersionHash() const -> uint64_t;
 private:
     Microsoft::WRL::ComPtr<IDxcUtils> _pUtils;
     Microsoft::WRL::ComPtr<IDxcLinker> _pLinker;
     Microsoft::WRL::ComPtr<IDxcLibrary> _pLibrary;
     Microsoft::WRL::ComPtr<IDxcCompiler3> _pCompiler;
+    uint64_t _versionHash = 0;
+
+    struct WorkerContext {
+        Microsoft::WRL::ComPtr<IDxcUtils> pUtils;
+        Microsoft::WRL::ComPtr<IDxcCompiler3> pCompiler;
+    };
+    auto GetWorkerContext() -> WorkerContext *;
+    // one slot per worker thread, a slot is only touched by its own worker
+    std::vector<WorkerContext> _workerContexts;
 };
 
 inline RuntimeStatic<DxcModule> gDxcModule;
@@ -1,8 +1,10 @@
 #include "DynamicBufferRing.h"
+#include <algorithm>
 #include "Device.h"
 #include "VKException.h"
 #include "ExtDebugUtils.h"
 #include "Misc.h"
+#include "Foundation/Logger.h"
 #include "Foundation/TypeAlias.h"
 
 namespace vkgfx {
@@ -13,8 +15,14 @@ void DynamicBufferRing::OnCreate(std::string_view name,
     size_t numBackBuffers,
     size_t memoryTotalSize) {
 
+    _name = name;
     _memTotalSize = memoryTotalSize;
     _mem.OnCreate(numBackBuffers, _memTotalSize);
+    _numBackBuffers = numBackBuffers;
+    _frameIndex = 0;
+    _frameCount = 0;
+    _frameOverflowPages.resize(numBackBuffers);
+    _statistics = {};
 
     VkBufferCreateInfo bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
     bufferInfo.size = _memTotalSize;
@@ -31,6 +39,7 @@ void DynamicBufferRing::OnCreate(std::string_view name,
     if (HasFlag(bufferType, Structured)) {
         bufferInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
     }
+    _bufferUsage = bufferInfo.usage;
 
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
@@ -53,6 +62,17 @@ void DynamicBufferRing::OnCreate(std::string_view name,
 }
 
 void DynamicBufferRing::OnDestroy() {
+    for (OverflowPageList &pages : _frameOverflowPages) {
+        for (std::unique_ptr<OverflowPage> &pPage : pages) {
+            DestroyOverflowPage(*pPage);
+        }
+    }
+    for (std::unique_ptr<OverflowPage> &pPage : _freeOverflowPages) {
+        DestroyOverflowPage(*pPage);
+    }
+    _frameOverflowPages.clear();
+    _freeOverflowPages.clear();
+
     if (_buffer) {
         VmaAllocator allocator = GetDevice()->GetAllocator();
         vmaUnmapMemory(allocator, _bufferAlloc);
@@ -68,7 +88,16 @@ void DynamicBufferRing::OnDestroy() {
 
 auto DynamicBufferRing::AllocBuffer(size_t size, const void *pInitData) -> std::optional<vk::DescriptorBufferInfo> {
     void *pBuffer = nullptr;
-    std::optional<vk::DescriptorBufferInfo> res = AllocBufferInternal(size, &pBuffer);
+    std::optional<vk::DescriptorBufferInfo> res = AllocBufferInternal(size, &pBuffer, true);
+    if (pBuffer) {
+        memcpy(pBuffer, pInitData, size);
+    }
+    return res;
+}
+
+auto DynamicBufferRing::AllocDynamic(size_t size, const void *pInitData) -> std::optional<vk::DescriptorBufferInfo> {
+    void *pBuffer = nullptr;
+    std::optional<vk::DescriptorBufferInfo> res = AllocBufferInternal(size, &pBuffer, false);
     if (pBuffer) {
         memcpy(pBuffer, pInitData, size);
     }
@@ -101,15 +130,32 @@ void DynamicBufferRing::AttachBufferToDescriptorSet(vk::DescriptorSet descriptor
 }
 
 void DynamicBufferRing::OnBeginFrame() {
+    size_t overflowSize = _overflowAllocatedInFrame.exchange(0, std::memory_order_relaxed);
+    size_t frameSize = _mem.GetAllocatedInFrame() + overflowSize;
+    _statistics.peakFrameSize = std::max(_statistics.peakFrameSize, frameSize);
+    _statistics.peakOverflowSize = std::max(_statistics.peakOverflowSize, overflowSize);
+
     _mem.OnBeginFrame();
+    _frameIndex = (_frameIndex + 1) % _numBackBuffers;
+    ++_frameCount;
+    RetireOverflowPages();
 }
 
-auto DynamicBufferRing::AllocBufferInternal(size_t size, void **pOutBufferPtr)
+auto DynamicBufferRing::GetStatistics() const -> const Statistics & {
+    return _statistics;
+}
+
+auto DynamicBufferRing::AllocBufferInternal(size_t size, void **pOutBufferPtr, bool allowOverflow)
     -> std::optional<vk::DescriptorBufferInfo> {
 
     size = AlignUp<size_t>(size, 256u);
     uint32_t memOffset;
     if (!_mem.Alloc(size, &memOffset)) {
+        if (allowOverflow) {
+            return AllocFromOverflowPage(size, pOutBufferPtr);
+        }
+        // a dynamic offset only works within '_buffer', another buffer would be read from the wrong memory
+        Logger::Error("DynamicBufferRing_{} is full, can't allocate {} bytes for a dynamic offset", _name, size);
         *pOutBufferPtr = nullptr;
         return std::nullopt;
     }
@@ -122,4 +168,102 @@ auto DynamicBufferRing::AllocBufferInternal(size_t size, void **pOutBufferPtr)
     return std::make_optional(bufferInfo);
 }
 
+auto DynamicBufferRing::AllocFromOverflowPage(size_t size, void **pOutBufferPtr)
+    -> std::optional<vk::DescriptorBufferInfo> {
+
+    std::lock_guard lock(_overflowMutex);
+    OverflowPageList &framePages = _frameOverflowPages[_frameIndex];
+    OverflowPage *pPage = framePages.empty() ? nullptr : framePages.back().get();
+    if (pPage == nullptr || pPage->offset + size > pPage->size) {
+        auto iter = std::ranges::find_if(_freeOverflowPages, [&](const std::unique_ptr<OverflowPage> &pFreePage) {
+            return pFreePage->size >= size;
+        });
+        if (iter != _freeOverflowPages.end()) {
+            framePages.push_back(std::move(*iter));
+            _freeOverflowPages.erase(iter);
+        } else {
+            size_t pageSize = std::max(size, AlignUp<size_t>(_memTotalSize / kOverflowPageDivisor, 256u));
+            std::unique_ptr<OverflowPage> pNewPage = CreateOverflowPage(pageSize);
+            if (pNewPage == nullptr) {
+                *pOutBufferPtr = nullptr;
+                return std::nullopt;
+            }
+            framePages.push_back(std::move(pNewPage));
+        }
+        pPage = framePages.back().get();
+    }
+
+    size_t offset = pPage->offset;
+    pPage->offset += size;
+    pPage->lastUsedFrame = _frameCount;
+    _overflowAllocatedInFrame.fetch_add(size, std::memory_order_relaxed);
+
+    *pOutBufferPtr = pPage->pData + offset;
+    vk::DescriptorBufferInfo bufferInfo;
+    bufferInfo.buffer = pPage->buffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = size;
+    return std::make_optional(bufferInfo);
+}
+
+auto DynamicBufferRing::CreateOverflowPage(size_t size) -> std::unique_ptr<OverflowPage> {
+    VkBufferCreateInfo bufferInfo = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size = size;
+    bufferInfo.usage = _bufferUsage;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VkBuffer buffer;
+    VmaAllocationInfo allocationInfo = {};
+    std::unique_ptr<OverflowPage> pPage = std::make_unique<OverflowPage>();
+    VmaAllocator allocator = GetDevice()->GetAllocator();
+    VkResult res = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer, &pPage->bufferAlloc, &allocationInfo);
+    if (res != VK_SUCCESS) {
+        Logger::Error("DynamicBufferRing_{} failed to create a {} bytes overflow page", _name, size);
+        return nullptr;
+    }
+
+    pPage->buffer = vk::Buffer(buffer);
+    pPage->pData = static_cast<uint8 *>(allocationInfo.pMappedData);
+    pPage->size = size;
+    pPage->offset = 0;
+
+    ++_statistics.overflowPageCount;
+    _statistics.peakOverflowPageCount = std::max(_statistics.peakOverflowPageCount, _statistics.overflowPageCount);
+    std::string pageName = fmt::format("DynamicBufferRing_{}_Overflow{}", _name, _statistics.overflowPageCount);
+    SetResourceName(GetDevice()->GetVKDevice(), pPage->buffer, pageName);
+    Logger::Warning("DynamicBufferRing_{} is full, allocate a {} bytes overflow page", _name, size);
+    return pPage;
+}
+
+void DynamicBufferRing::DestroyOverflowPage(OverflowPage &page) {
+    vmaDestroyBuffer(GetDevice()->GetAllocator(), page.buffer, page.bufferAlloc);
+    page.buffer = nullptr;
+    page.bufferAlloc = VK_NULL_HANDLE;
+    page.pData = nullptr;
+    --_statistics.overflowPageCount;
+}
+
+void DynamicBufferRing::RetireOverflowPages() {
+    std::lock_guard lock(_overflowMutex);
+
+    // the frame that used these pages has been retired together with its ring entries
+    for (std::unique_ptr<OverflowPage> &pPage : _frameOverflowPages[_frameIndex]) {
+        pPage->offset = 0;
+        _freeOverflowPages.push_back(std::move(pPage));
+    }
+    _frameOverflowPages[_frameIndex].clear();
+
+    // shrink back once the demand drops
+    std::erase_if(_freeOverflowPages, [&](std::unique_ptr<OverflowPage> &pPage) {
+        if (_frameCount - pPage->lastUsedFrame < kOverflowPageRetireFrames) {
+            return false;
+        }
+        DestroyOverflowPage(*pPage);
+        return true;
+    });
+}
+
 }    // namespace vkgfx
@@ -1,4 +1,7 @@
 #pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.hpp>
@@ -9,6 +12,15 @@
 namespace vkgfx {
 
 class Device;
+
+// Per-frame constant/vertex memory. 'AllocBuffer' is lock-free, so worker threads can write their
+// draw data in parallel during a frame; 'OnBeginFrame' must be called from the main thread once
+// all allocations of the previous frame are done.
+//
+// When the ring is full, 'AllocBuffer' spills into overflow pages. Those pages live in their own
+// vk::Buffer, so data bound through 'AttachBufferToDescriptorSet' with a dynamic offset is allocated
+// with 'AllocDynamic', which never spills and fails instead. Overflow pages are recycled once the
+// frames that used them are retired and destroyed after they stay unused for a while.
 class DynamicBufferRing : public VKObject {
 public:
     enum BufferType {
@@ -18,35 +30,87 @@ public:
         Structured = 1 << 3,
     };
     ENUM_FLAGS_AS_MEMBER(BufferType);
+
+    struct Statistics {
+        size_t peakFrameSize = 0;            // the most memory a single frame needed, ring and overflow
+        size_t peakOverflowSize = 0;         // the most overflow memory a single frame needed
+        size_t overflowPageCount = 0;        // overflow pages currently alive
+        size_t peakOverflowPageCount = 0;
+    };
 public:
-    void OnCreate(std::string_view name, 
+    void OnCreate(std::string_view name,
         Device *pDevice,
         BufferType bufferType,
         size_t numBackBuffers,
         size_t memoryTotalSize);
     void OnDestroy();
+    // the result may live in an overflow page, bind 'DescriptorBufferInfo::buffer'
     auto AllocBuffer(size_t size, const void *pInitData) -> std::optional<vk::DescriptorBufferInfo>;
+    // always in the buffer 'AttachBufferToDescriptorSet' binds, nullopt when the ring is full
+    auto AllocDynamic(size_t size, const void *pInitData) -> std::optional<vk::DescriptorBufferInfo>;
     auto GetAllocatableSize() const -> size_t;
     void AttachBufferToDescriptorSet(vk::DescriptorSet descriptorSet, uint32_t binding, size_t size) const;
     void OnBeginFrame();
+    auto GetStatistics() const -> const Statistics &;
 
     template<typename T>
     auto AllocBuffer(size_t size, T **pOutBufferPtr) -> std::optional<vk::DescriptorBufferInfo> {
-	    return AllocBufferInternal(size, reinterpret_cast<void **>(pOutBufferPtr));
+	    return AllocBufferInternal(size, reinterpret_cast<void **>(pOutBufferPtr), true);
     }
 
     template<typename T>
     auto AllocBuffer(const T &data) -> std::optional<vk::DescriptorBufferInfo> {
         return AllocBuffer(sizeof(T), &data);
     }
+
+    template<typename T>
+    auto AllocDynamic(size_t size, T **pOutBufferPtr) -> std::optional<vk::DescriptorBufferInfo> {
+        return AllocBufferInternal(size, reinterpret_cast<void **>(pOutBufferPtr), false);
+    }
+
+    template<typename T>
+    auto AllocDynamic(const T &data) -> std::optional<vk::DescriptorBufferInfo> {
+        return AllocDynamic(sizeof(T), &data);
+    }
 private:
-    auto AllocBufferInternal(size_t size, void **pOutBufferPtr) -> std::optional<vk::DescriptorBufferInfo>;
+    struct OverflowPage {
+        vk::Buffer buffer;
+        VmaAllocation bufferAlloc = VK_NULL_HANDLE;
+        uint8_t *pData = nullptr;
+        size_t size = 0;
+        size_t offset = 0;
+        size_t lastUsedFrame = 0;
+    };
+    using OverflowPageList = std::vector<std::unique_ptr<OverflowPage>>;
+
+    auto AllocBufferInternal(size_t size, void **pOutBufferPtr, bool allowOverflow)
+        -> std::optional<vk::DescriptorBufferInfo>;
+    auto AllocFromOverflowPage(size_t size, void **pOutBufferPtr) -> std::optional<vk::DescriptorBufferInfo>;
+    auto CreateOverflowPage(size_t size) -> std::unique_ptr<OverflowPage>;
+    void DestroyOverflowPage(OverflowPage &page);
+    void RetireOverflowPages();
 private:
+    // overflow pages are at least 1/kOverflowPageDivisor of the ring size
+    static constexpr size_t kOverflowPageDivisor = 4;
+    // free overflow pages that were not needed for this many frames are released
+    static constexpr size_t kOverflowPageRetireFrames = 120;
+
+    std::string _name;
     void *_pData = nullptr;
     RingWithTabs _mem;
     size_t _memTotalSize = 0;
     vk::Buffer _buffer;
     VmaAllocation _bufferAlloc = VK_NULL_HANDLE;
+    VkBufferUsageFlags _bufferUsage = 0;
+
+    size_t _numBackBuffers = 0;
+    size_t _frameIndex = 0;
+    size_t _frameCount = 0;
+    std::mutex _overflowMutex;
+    std::atomic<size_t> _overflowAllocatedInFrame = 0;
+    std::vector<OverflowPageList> _frameOverflowPages;
+    OverflowPageList _freeOverflowPages;
+    Statistics _statistics;
 };
 
 }    // namespace vkgfx
@@ -0,0 +1,350 @@
+#include "GraphicsPipelineCache.h"
+#include "Device.h"
+#include "Utils.hpp"
+#include "VKException.h"
+#include "Foundation/Hash.hpp"
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace vkgfx {
+
+namespace {
+
+class PipelineKeyWriter {
+public:
+    explicit PipelineKeyWriter(std::vector<uint8_t> &key) : _key(key) {
+    }
+    // only for fields and structs without padding, so equal states give equal bytes
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    void Write(const T &value) {
+        const uint8_t *pBytes = reinterpret_cast<const uint8_t *>(&value);
+        _key.insert(_key.end(), pBytes, pBytes + sizeof(T));
+    }
+    template<typename T>
+    void WriteArray(std::span<const T> values) {
+        Write(static_cast<uint32_t>(values.size()));
+        for (const T &value : values) {
+            Write(value);
+        }
+    }
+    void WriteString(std::string_view str) {
+        Write(static_cast<uint32_t>(str.size()));
+        _key.insert(_key.end(), str.begin(), str.end());
+    }
+private:
+    std::vector<uint8_t> &_key;
+};
+
+class PipelineKeyReader {
+public:
+    explicit PipelineKeyReader(const std::vector<uint8_t> &key) : _key(key) {
+    }
+    template<typename T>
+        requires std::is_trivially_copyable_v<T>
+    auto Read() -> T {
+        T value;
+        std::memcpy(&value, _key.data() + _offset, sizeof(T));
+        _offset += sizeof(T);
+        return value;
+    }
+    void SkipString() {
+        _offset += Read<uint32_t>();
+    }
+private:
+    const std::vector<uint8_t> &_key;
+    size_t _offset = 0;
+};
+
+// follows the stage layout written by 'GraphicsPipelineDesc::GetKey'
+bool UsesShaderModule(const std::vector<uint8_t> &key, vk::ShaderModule shaderModule) {
+    PipelineKeyReader reader(key);
+    uint32_t stageCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < stageCount; ++i) {
+        reader.Read<vk::ShaderStageFlagBits>();
+        vk::ShaderModule module = reader.Read<vk::ShaderModule>();
+        reader.SkipString();
+        if (module == shaderModule) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}    // namespace
+
+GraphicsPipelineDesc::GraphicsPipelineDesc() {
+    _inputAssemblyState = *GetInputAssemblyState_TriangleList();
+    _multisampleState = *GetMultiSampleState_Disable();
+    _depthStencilState = *GetDepthStencilState_DepthStandard();
+    _colorBlendAttachments.push_back(*GetColorBlendAttachmentState_Opaque());
+
+    const vk::PipelineDynamicStateCreateInfo *pDynamicState = GetDynamicState_ViewportScissor();
+    _dynamicStates.assign(pDynamicState->pDynamicStates,
+        pDynamicState->pDynamicStates + pDynamicState->dynamicStateCount);
+
+    _rasterizationState.polygonMode = vk::PolygonMode::eFill;
+    _rasterizationState.cullMode = vk::CullModeFlagBits::eBack;
+    _rasterizationState.frontFace = vk::FrontFace::eClockwise;
+    _rasterizationState.depthClampEnable = VK_FALSE;
+    _rasterizationState.rasterizerDiscardEnable = VK_FALSE;
+    _rasterizationState.depthBiasEnable = VK_FALSE;
+    _rasterizationState.lineWidth = 1.f;
+}
+
+void GraphicsPipelineDesc::SetShaderStage(vk::ShaderStageFlagBits stage,
+    vk::ShaderModule module,
+    std::string_view entryPoint) {
+
+    auto iter = std::find_if(_shaderStages.begin(), _shaderStages.end(), [=](const ShaderStage &shaderStage) {
+        return shaderStage.stage == stage;
+    });
+    if (iter == _shaderStages.end()) {
+        iter = _shaderStages.insert(_shaderStages.end(), ShaderStage{});
+    }
+    iter->stage = stage;
+    iter->module = module;
+    iter->entryPoint = entryPoint;
+    // keep the stages sorted, so the order they are set in does not change the key
+    std::sort(_shaderStages.begin(), _shaderStages.end(), [](const ShaderStage &lhs, const ShaderStage &rhs) {
+        return lhs.stage < rhs.stage;
+    });
+}
+
+void GraphicsPipelineDesc::SetShaderStage(const vk::PipelineShaderStageCreateInfo &stageCreateInfo) {
+    ExceptionAssert(stageCreateInfo.pSpecializationInfo == nullptr);
+    SetShaderStage(stageCreateInfo.stage, stageCreateInfo.module, stageCreateInfo.pName);
+}
+
+auto GraphicsPipelineDesc::ReplaceShaderModule(vk::ShaderModule oldModule, vk::ShaderModule newModule) -> bool {
+    bool replaced = false;
+    for (ShaderStage &shaderStage : _shaderStages) {
+        if (oldModule && shaderStage.module == oldModule) {
+            shaderStage.module = newModule;
+            replaced = true;
+        }
+    }
+    return replaced;
+}
+
+void GraphicsPipelineDesc::SetVertexInput(std::span<const vk::VertexInputBindingDescription> bindings,
+    std::span<const vk::VertexInputAttributeDescription> attributes) {
+    _vertexBindings.assign(bindings.begin(), bindings.end());
+    _vertexAttributes.assign(attributes.begin(), attributes.end());
+}
+
+void GraphicsPipelineDesc::SetInputAssemblyState(const vk::PipelineInputAssemblyStateCreateInfo &state) {
+    _inputAssemblyState = state;
+}
+
+void GraphicsPipelineDesc::SetViewportCount(uint32_t viewportCount, uint32_t scissorCount) {
+    _viewportCount = viewportCount;
+    _scissorCount = scissorCount;
+}
+
+void GraphicsPipelineDesc::SetRasterizationState(const vk::PipelineRasterizationStateCreateInfo &state) {
+    _rasterizationState = state;
+}
+
+void GraphicsPipelineDesc::SetMultisampleState(const vk::PipelineMultisampleStateCreateInfo &state) {
+    ExceptionAssert(state.pSampleMask == nullptr);
+    _multisampleState = state;
+}
+
+void GraphicsPipelineDesc::SetDepthStencilState(const vk::PipelineDepthStencilStateCreateInfo &state) {
+    _depthStencilState = state;
+}
+
+void GraphicsPipelineDesc::SetColorBlendAttachments(
+    std::span<const vk::PipelineColorBlendAttachmentState> attachments) {
+    _colorBlendAttachments.assign(attachments.begin(), attachments.end());
+}
+
+void GraphicsPipelineDesc::SetDynamicStates(std::span<const vk::DynamicState> dynamicStates) {
+    _dynamicStates.assign(dynamicStates.begin(), dynamicStates.end());
+}
+
+void GraphicsPipelineDesc::SetPipelineLayout(vk::PipelineLayout pipelineLayout) {
+    _pipelineLayout = pipelineLayout;
+}
+
+void GraphicsPipelineDesc::SetRenderPass(vk::RenderPass renderPass, uint32_t subpass) {
+    _renderPass = renderPass;
+    _subpass = subpass;
+}
+
+auto GraphicsPipelineDesc::GetKey() const -> std::vector<uint8_t> {
+    std::vector<uint8_t> key;
+    key.reserve(512);
+    PipelineKeyWriter writer(key);
+
+    writer.Write(static_cast<uint32_t>(_shaderStages.size()));
+    for (const ShaderStage &shaderStage : _shaderStages) {
+        writer.Write(shaderStage.stage);
+        writer.Write(shaderStage.module);
+        writer.WriteString(shaderStage.entryPoint);
+    }
+
+    // binding and attribute descriptions are plain 32-bit fields
+    writer.WriteArray(std::span<const vk::VertexInputBindingDescription>(_vertexBindings));
+    writer.WriteArray(std::span<const vk::VertexInputAttributeDescription>(_vertexAttributes));
+
+    writer.Write(_inputAssemblyState.topology);
+    writer.Write(_inputAssemblyState.primitiveRestartEnable);
+    writer.Write(_viewportCount);
+    writer.Write(_scissorCount);
+
+    writer.Write(_rasterizationState.depthClampEnable);
+    writer.Write(_rasterizationState.rasterizerDiscardEnable);
+    writer.Write(_rasterizationState.polygonMode);
+    writer.Write(_rasterizationState.cullMode);
+    writer.Write(_rasterizationState.frontFace);
+    writer.Write(_rasterizationState.depthBiasEnable);
+    writer.Write(_rasterizationState.depthBiasConstantFactor);
+    writer.Write(_rasterizationState.depthBiasClamp);
+    writer.Write(_rasterizationState.depthBiasSlopeFactor);
+    writer.Write(_rasterizationState.lineWidth);
+
+    writer.Write(_multisampleState.rasterizationSamples);
+    writer.Write(_multisampleState.sampleShadingEnable);
+    writer.Write(_multisampleState.minSampleShading);
+    writer.Write(_multisampleState.alphaToCoverageEnable);
+    writer.Write(_multisampleState.alphaToOneEnable);
+
+    writer.Write(_depthStencilState.depthTestEnable);
+    writer.Write(_depthStencilState.depthWriteEnable);
+    writer.Write(_depthStencilState.depthCompareOp);
+    writer.Write(_depthStencilState.depthBoundsTestEnable);
+    writer.Write(_depthStencilState.stencilTestEnable);
+    writer.Write(_depthStencilState.front);
+    writer.Write(_depthStencilState.back);
+    writer.Write(_depthStencilState.minDepthBounds);
+    writer.Write(_depthStencilState.maxDepthBounds);
+
+    writer.WriteArray(std::span<const vk::PipelineColorBlendAttachmentState>(_colorBlendAttachments));
+    writer.WriteArray(std::span<const vk::DynamicState>(_dynamicStates));
+    writer.Write(_pipelineLayout);
+    writer.Write(_renderPass);
+    writer.Write(_subpass);
+    return key;
+}
+
+auto GraphicsPipelineDesc::CreatePipeline(vk::Device device, vk::PipelineCache pipelineCache) const
+    -> vk::Pipeline {
+
+    std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+    for (const ShaderStage &shaderStage : _shaderStages) {
+        vk::PipelineShaderStageCreateInfo stageCreateInfo;
+        stageCreateInfo.stage = shaderStage.stage;
+        stageCreateInfo.module = shaderStage.module;
+        stageCreateInfo.pName = shaderStage.entryPoint.c_str();
+        shaderStages.push_back(stageCreateInfo);
+    }
+
+    vk::PipelineVertexInputStateCreateInfo vertexInputCreateInfo;
+    vertexInputCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(_vertexBindings.size());
+    vertexInputCreateInfo.pVertexBindingDescriptions = _vertexBindings.data();
+    vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(_vertexAttributes.size());
+    vertexInputCreateInfo.pVertexAttributeDescriptions = _vertexAttributes.data();
+
+    vk::PipelineViewportStateCreateInfo viewportCreateInfo;
+    viewportCreateInfo.viewportCount = _viewportCount;
+    viewportCreateInfo.scissorCount = _scissorCount;
+
+    vk::PipelineColorBlendStateCreateInfo colorBlendCreateInfo;
+    colorBlendCreateInfo.logicOpEnable = VK_FALSE;
+    colorBlendCreateInfo.attachmentCount = static_cast<uint32_t>(_colorBlendAttachments.size());
+    colorBlendCreateInfo.pAttachments = _colorBlendAttachments.data();
+    colorBlendCreateInfo.blendConstants = std::array<float, 4>{0.f};
+
+    vk::PipelineDynamicStateCreateInfo dynamicCreateInfo;
+    dynamicCreateInfo.dynamicStateCount = static_cast<uint32_t>(_dynamicStates.size());
+    dynamicCreateInfo.pDynamicStates = _dynamicStates.data();
+
+    vk::GraphicsPipelineCreateInfo pipelineCreateInfo;
+    pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineCreateInfo.pStages = shaderStages.data();
+    pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+    pipelineCreateInfo.pInputAssemblyState = &_inputAssemblyState;
+    pipelineCreateInfo.pTessellationState = nullptr;
+    pipelineCreateInfo.pViewportState = &viewportCreateInfo;
+    pipelineCreateInfo.pRasterizationState = &_rasterizationState;
+    pipelineCreateInfo.pMultisampleState = &_multisampleState;
+    pipelineCreateInfo.pDepthStencilState = &_depthStencilState;
+    pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
+    pipelineCreateInfo.pDynamicState = &dynamicCreateInfo;
+    pipelineCreateInfo.layout = _pipelineLayout;
+    pipelineCreateInfo.renderPass = _renderPass;
+    pipelineCreateInfo.subpass = _subpass;
+    pipelineCreateInfo.basePipelineHandle = nullptr;
+    pipelineCreateInfo.basePipelineIndex = -1;
+    // a success code other than eSuccess comes without a pipeline, it must not reach the cache
+    vk::ResultValue<vk::Pipeline> result = device.createGraphicsPipeline(pipelineCache, pipelineCreateInfo);
+    VKException::Throw(result.result);
+    return result.value;
+}
+
+void GraphicsPipelineCache::OnCreate(Device *pDevice) {
+    SetDevice(pDevice);
+    SetIsCreate(true);
+}
+
+void GraphicsPipelineCache::OnDestroy() {
+    Clear();
+    SetIsCreate(false);
+    SetDevice(nullptr);
+}
+
+auto PipelineKeyHash::operator()(const std::vector<uint8_t> &key) const -> size_t {
+    return static_cast<size_t>(nstd::FNV1a64(key.data(), key.size()));
+}
+
+auto GraphicsPipelineCache::GetPipeline(const GraphicsPipelineDesc &desc) -> vk::Pipeline {
+    std::vector<uint8_t> key = desc.GetKey();
+    if (auto iter = _pipelineMap.find(key); iter != _pipelineMap.end()) {
+        return iter->second;
+    }
+
+    vk::Pipeline pipeline = desc.CreatePipeline(GetDevice()->GetVKDevice(), GetDevice()->GetPipelineCache());
+    _pipelineMap.emplace(std::move(key), pipeline);
+    return pipeline;
+}
+
+auto GraphicsPipelineCache::FindPipeline(const std::vector<uint8_t> &key) const -> vk::Pipeline {
+    auto iter = _pipelineMap.find(key);
+    return (iter != _pipelineMap.end()) ? iter->second : nullptr;
+}
+
+auto GraphicsPipelineCache::AddPipeline(std::vector<uint8_t> key, vk::Pipeline pipeline) -> vk::Pipeline {
+    auto [iter, inserted] = _pipelineMap.emplace(std::move(key), pipeline);
+    if (!inserted) {
+        GetDevice()->GetVKDevice().destroyPipeline(pipeline);
+    }
+    return iter->second;
+}
+
+auto GraphicsPipelineCache::GetPipelineCount() const -> size_t {
+    return _pipelineMap.size();
+}
+
+auto GraphicsPipelineCache::EvictShaderModule(vk::ShaderModule shaderModule) -> size_t {
+    vk::Device device = GetDevice()->GetVKDevice();
+    return std::erase_if(_pipelineMap, [&](const auto &item) {
+        if (!UsesShaderModule(item.first, shaderModule)) {
+            return false;
+        }
+        device.destroyPipeline(item.second);
+        return true;
+    });
+}
+
+void GraphicsPipelineCache::Clear() {
+    vk::Device device = GetDevice()->GetVKDevice();
+    for (auto &&[_, pipeline] : _pipelineMap) {
+        device.destroyPipeline(pipeline);
+    }
+    _pipelineMap.clear();
+}
+
+}    // namespace vkgfx
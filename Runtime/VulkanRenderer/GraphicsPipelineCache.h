@@ -0,0 +1,86 @@
+#pragma once
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "Foundation/RuntimeStatic.h"
+#include "VKObject.h"
+
+namespace vkgfx {
+
+class Device;
+
+// Full description of a graphics pipeline. Unlike vk::GraphicsPipelineCreateInfo it owns all of its
+// state, so it can be hashed and kept as a cache key. The defaults come from the helpers in Utils.hpp.
+class GraphicsPipelineDesc {
+public:
+    GraphicsPipelineDesc();
+    void SetShaderStage(vk::ShaderStageFlagBits stage, vk::ShaderModule module, std::string_view entryPoint);
+    void SetShaderStage(const vk::PipelineShaderStageCreateInfo &stageCreateInfo);
+    // for shader hot reload, returns whether any stage used 'oldModule'
+    auto ReplaceShaderModule(vk::ShaderModule oldModule, vk::ShaderModule newModule) -> bool;
+    void SetVertexInput(std::span<const vk::VertexInputBindingDescription> bindings,
+        std::span<const vk::VertexInputAttributeDescription> attributes);
+    void SetInputAssemblyState(const vk::PipelineInputAssemblyStateCreateInfo &state);
+    void SetViewportCount(uint32_t viewportCount, uint32_t scissorCount);
+    void SetRasterizationState(const vk::PipelineRasterizationStateCreateInfo &state);
+    void SetMultisampleState(const vk::PipelineMultisampleStateCreateInfo &state);
+    void SetDepthStencilState(const vk::PipelineDepthStencilStateCreateInfo &state);
+    void SetColorBlendAttachments(std::span<const vk::PipelineColorBlendAttachmentState> attachments);
+    void SetDynamicStates(std::span<const vk::DynamicState> dynamicStates);
+    void SetPipelineLayout(vk::PipelineLayout pipelineLayout);
+    void SetRenderPass(vk::RenderPass renderPass, uint32_t subpass = 0);
+
+    // every field that affects the pipeline, packed without padding
+    auto GetKey() const -> std::vector<uint8_t>;
+    auto CreatePipeline(vk::Device device, vk::PipelineCache pipelineCache) const -> vk::Pipeline;
+private:
+    struct ShaderStage {
+        vk::ShaderStageFlagBits stage;
+        vk::ShaderModule module;
+        std::string entryPoint;
+    };
+    std::vector<ShaderStage> _shaderStages;
+    std::vector<vk::VertexInputBindingDescription> _vertexBindings;
+    std::vector<vk::VertexInputAttributeDescription> _vertexAttributes;
+    vk::PipelineInputAssemblyStateCreateInfo _inputAssemblyState;
+    uint32_t _viewportCount = 1;
+    uint32_t _scissorCount = 1;
+    vk::PipelineRasterizationStateCreateInfo _rasterizationState;
+    vk::PipelineMultisampleStateCreateInfo _multisampleState;
+    vk::PipelineDepthStencilStateCreateInfo _depthStencilState;
+    std::vector<vk::PipelineColorBlendAttachmentState> _colorBlendAttachments;
+    std::vector<vk::DynamicState> _dynamicStates;
+    vk::PipelineLayout _pipelineLayout;
+    vk::RenderPass _renderPass;
+    uint32_t _subpass = 0;
+};
+
+// the whole key is compared on lookup, so a hash collision can never return the wrong pipeline
+struct PipelineKeyHash {
+    auto operator()(const std::vector<uint8_t> &key) const -> size_t;
+};
+
+// Hands out one vk::Pipeline per distinct GraphicsPipelineDesc. Pipelines live until 'Clear' or
+// 'OnDestroy', so callers must not destroy them.
+class GraphicsPipelineCache : public VKObject {
+public:
+    void OnCreate(Device *pDevice);
+    void OnDestroy();
+    auto GetPipeline(const GraphicsPipelineDesc &desc) -> vk::Pipeline;
+    // for pipelines built outside the cache, e.g. by PipelineCompileService. 'FindPipeline' returns null
+    // on a miss; 'AddPipeline' keeps the pipeline already cached under 'key' and destroys the new one.
+    auto FindPipeline(const std::vector<uint8_t> &key) const -> vk::Pipeline;
+    auto AddPipeline(std::vector<uint8_t> key, vk::Pipeline pipeline) -> vk::Pipeline;
+    auto GetPipelineCount() const -> size_t;
+    // destroys every pipeline with a stage built from 'shaderModule', returns how many were removed
+    auto EvictShaderModule(vk::ShaderModule shaderModule) -> size_t;
+    void Clear();
+private:
+    std::unordered_map<std::vector<uint8_t>, vk::Pipeline, PipelineKeyHash> _pipelineMap;
+};
+
+inline RuntimeStatic<GraphicsPipelineCache> gGraphicsPipelineCache;
+
+}    // namespace vkgfx
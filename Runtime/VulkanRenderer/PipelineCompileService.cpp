@@ -0,0 +1,216 @@
+#include "PipelineCompileService.h"
+#include "Device.h"
+#include "VKException.h"
+#include "Foundation/Logger.h"
+#include "Foundation/MainThread.h"
+#include "Foundation/ThreadPool.h"
+#include <chrono>
+#include <cstring>
+
+namespace vkgfx {
+
+auto ComputePipelineDesc::GetKey() const -> std::vector<uint8_t> {
+    std::vector<uint8_t> key(sizeof(module) + sizeof(pipelineLayout) + entryPoint.size());
+    std::memcpy(key.data(), &module, sizeof(module));
+    std::memcpy(key.data() + sizeof(module), &pipelineLayout, sizeof(pipelineLayout));
+    std::memcpy(key.data() + sizeof(module) + sizeof(pipelineLayout), entryPoint.data(), entryPoint.size());
+    return key;
+}
+
+auto ComputePipelineDesc::CreatePipeline(vk::Device device, vk::PipelineCache pipelineCache) const
+    -> vk::Pipeline {
+    vk::ComputePipelineCreateInfo pipelineCreateInfo;
+    pipelineCreateInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipelineCreateInfo.stage.module = module;
+    pipelineCreateInfo.stage.pName = entryPoint.c_str();
+    pipelineCreateInfo.layout = pipelineLayout;
+    pipelineCreateInfo.basePipelineHandle = nullptr;
+    pipelineCreateInfo.basePipelineIndex = -1;
+    vk::ResultValue<vk::Pipeline> result = device.createComputePipeline(pipelineCache, pipelineCreateInfo);
+    VKException::Throw(result.result);
+    return result.value;
+}
+
+auto PipelineHandle::IsReady() const -> bool {
+    return _pState != nullptr && _pState->ready;
+}
+
+auto PipelineHandle::GetPipeline() const -> vk::Pipeline {
+    if (_pState == nullptr) {
+        return nullptr;
+    }
+    // a failed compile also falls back, the error was already logged
+    return (_pState->ready && _pState->pipeline) ? _pState->pipeline : _pState->fallback;
+}
+
+auto PipelineHandle::GetFuture() const -> std::shared_future<vk::Pipeline> {
+    ExceptionAssert(_pState != nullptr);
+    return _pState->future;
+}
+
+void PipelineCompileService::OnCreate(Device *pDevice, GraphicsPipelineCache *pGraphicsPipelineCache) {
+    _pGraphicsPipelineCache = pGraphicsPipelineCache;
+    SetDevice(pDevice);
+    SetIsCreate(true);
+}
+
+void PipelineCompileService::OnDestroy() {
+    WaitForCompileJobs();
+    // the finished pipelines are handed over by begin-frame jobs, run them before the caches go away
+    MainThread::ExecuteBeginFrameJob();
+    ExceptionAssert(_pendingGraphicsMap.empty() && _pendingComputeMap.empty());
+
+    vk::Device device = GetDevice()->GetVKDevice();
+    for (auto &&[_, pipeline] : _computePipelineMap) {
+        device.destroyPipeline(pipeline);
+    }
+    _computePipelineMap.clear();
+    _pGraphicsPipelineCache = nullptr;
+    SetIsCreate(false);
+    SetDevice(nullptr);
+}
+
+auto PipelineCompileService::CompileGraphics(const GraphicsPipelineDesc &desc, vk::Pipeline fallback)
+    -> PipelineHandle {
+
+    MainThread::EnsureMainThread();
+    std::vector<uint8_t> key = desc.GetKey();
+    if (vk::Pipeline pipeline = _pGraphicsPipelineCache->FindPipeline(key)) {
+        return MakeHandle(pipeline, fallback);
+    }
+
+    PipelineHandle handle = MakeHandle(nullptr, fallback);
+    auto [iter, inserted] = _pendingGraphicsMap.try_emplace(key);
+    iter->second.push_back(handle._pState);
+    if (!inserted) {
+        return handle;
+    }
+
+    std::erase_if(_compileJobs, [](const std::future<void> &job) {
+        return job.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+    vk::Device device = GetDevice()->GetVKDevice();
+    vk::PipelineCache pipelineCache = GetDevice()->GetPipelineCache();
+    uint64_t serial = ++_submittedSerial;
+    _pendingSerials.insert(serial);
+    _compileJobs.push_back(gThreadPool->Submit([=, this]() {
+        vk::Pipeline pipeline = nullptr;
+        try {
+            pipeline = desc.CreatePipeline(device, pipelineCache);
+        } catch (const std::exception &exception) {
+            Logger::Error("Compile graphics pipeline failed: {}", exception.what());
+        }
+        MainThread::AddBeginFrameJob([=, this]() { PublishGraphics(key, pipeline, serial); });
+    }));
+    return handle;
+}
+
+auto PipelineCompileService::CompileCompute(const ComputePipelineDesc &desc, vk::Pipeline fallback)
+    -> PipelineHandle {
+
+    MainThread::EnsureMainThread();
+    std::vector<uint8_t> key = desc.GetKey();
+    if (auto iter = _computePipelineMap.find(key); iter != _computePipelineMap.end()) {
+        return MakeHandle(iter->second, fallback);
+    }
+
+    PipelineHandle handle = MakeHandle(nullptr, fallback);
+    auto [iter, inserted] = _pendingComputeMap.try_emplace(key);
+    iter->second.push_back(handle._pState);
+    if (!inserted) {
+        return handle;
+    }
+
+    std::erase_if(_compileJobs, [](const std::future<void> &job) {
+        return job.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+    vk::Device device = GetDevice()->GetVKDevice();
+    vk::PipelineCache pipelineCache = GetDevice()->GetPipelineCache();
+    uint64_t serial = ++_submittedSerial;
+    _pendingSerials.insert(serial);
+    _compileJobs.push_back(gThreadPool->Submit([=, this]() {
+        vk::Pipeline pipeline = nullptr;
+        try {
+            pipeline = desc.CreatePipeline(device, pipelineCache);
+        } catch (const std::exception &exception) {
+            Logger::Error("Compile compute pipeline failed: {}", exception.what());
+        }
+        MainThread::AddBeginFrameJob([=, this]() { PublishCompute(key, pipeline, serial); });
+    }));
+    return handle;
+}
+
+auto PipelineCompileService::GetPendingCount() const -> size_t {
+    return _pendingGraphicsMap.size() + _pendingComputeMap.size();
+}
+
+auto PipelineCompileService::MakeHandle(vk::Pipeline pipeline, vk::Pipeline fallback) -> PipelineHandle {
+    PipelineHandle handle;
+    handle._pState = std::make_shared<PipelineHandle::State>();
+    handle._pState->fallback = fallback;
+    handle._pState->future = handle._pState->promise.get_future().share();
+    if (pipeline) {
+        Resolve(*handle._pState, pipeline);
+    }
+    return handle;
+}
+
+auto PipelineCompileService::IsPublished(uint64_t serial) const -> bool {
+    return _pendingSerials.empty() || *_pendingSerials.begin() > serial;
+}
+
+void PipelineCompileService::EvictShaderModule(vk::ShaderModule shaderModule) {
+    MainThread::EnsureMainThread();
+    _pGraphicsPipelineCache->EvictShaderModule(shaderModule);
+    vk::Device device = GetDevice()->GetVKDevice();
+    std::erase_if(_computePipelineMap, [&](const auto &item) {
+        // the key starts with the module, see 'ComputePipelineDesc::GetKey'
+        vk::ShaderModule module;
+        std::memcpy(&module, item.first.data(), sizeof(module));
+        if (module != shaderModule) {
+            return false;
+        }
+        device.destroyPipeline(item.second);
+        return true;
+    });
+}
+
+void PipelineCompileService::PublishGraphics(std::vector<uint8_t> key, vk::Pipeline pipeline, uint64_t serial) {
+    _pendingSerials.erase(serial);
+    auto node = _pendingGraphicsMap.extract(key);
+    ExceptionAssert(!node.empty());
+    if (pipeline) {
+        // a synchronous 'GetPipeline' may have built the same pipeline in the meantime
+        pipeline = _pGraphicsPipelineCache->AddPipeline(std::move(key), pipeline);
+    }
+    for (const StatePtr &pState : node.mapped()) {
+        Resolve(*pState, pipeline);
+    }
+}
+
+void PipelineCompileService::PublishCompute(std::vector<uint8_t> key, vk::Pipeline pipeline, uint64_t serial) {
+    _pendingSerials.erase(serial);
+    auto node = _pendingComputeMap.extract(key);
+    ExceptionAssert(!node.empty());
+    if (pipeline) {
+        _computePipelineMap.emplace(std::move(key), pipeline);
+    }
+    for (const StatePtr &pState : node.mapped()) {
+        Resolve(*pState, pipeline);
+    }
+}
+
+void PipelineCompileService::Resolve(PipelineHandle::State &state, vk::Pipeline pipeline) {
+    state.pipeline = pipeline;
+    state.ready = true;
+    state.promise.set_value(pipeline);
+}
+
+void PipelineCompileService::WaitForCompileJobs() {
+    for (std::future<void> &job : _compileJobs) {
+        job.wait();
+    }
+    _compileJobs.clear();
+}
+
+}    // namespace vkgfx
@@ -0,0 +1,88 @@
+#pragma once
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "GraphicsPipelineCache.h"
+#include "Foundation/RuntimeStatic.h"
+#include "VKObject.h"
+
+namespace vkgfx {
+
+class Device;
+
+struct ComputePipelineDesc {
+    vk::ShaderModule module;
+    std::string entryPoint;
+    vk::PipelineLayout pipelineLayout;
+public:
+    auto GetKey() const -> std::vector<uint8_t>;
+    auto CreatePipeline(vk::Device device, vk::PipelineCache pipelineCache) const -> vk::Pipeline;
+};
+
+// A pipeline that may still be compiling. Only query it on the main thread; it turns ready at the
+// beginning of a frame, when the compile service publishes the finished pipelines.
+class PipelineHandle {
+public:
+    auto IsValid() const -> bool {
+        return _pState != nullptr;
+    }
+    auto IsReady() const -> bool;
+    // the compiled pipeline, or the fallback while compiling; null means the draw should be skipped
+    auto GetPipeline() const -> vk::Pipeline;
+    auto GetFuture() const -> std::shared_future<vk::Pipeline>;
+private:
+    friend class PipelineCompileService;
+    struct State {
+        vk::Pipeline pipeline;
+        vk::Pipeline fallback;
+        bool ready = false;
+        std::promise<vk::Pipeline> promise;
+        std::shared_future<vk::Pipeline> future;
+    };
+    std::shared_ptr<State> _pState;
+};
+
+// Creates graphics and compute pipelines on the worker threads of gThreadPool. The shader modules
+// and pipeline layouts of a request must stay alive until its handle is ready.
+class PipelineCompileService : public VKObject {
+public:
+    void OnCreate(Device *pDevice, GraphicsPipelineCache *pGraphicsPipelineCache);
+    void OnDestroy();
+    auto CompileGraphics(const GraphicsPipelineDesc &desc, vk::Pipeline fallback = nullptr) -> PipelineHandle;
+    auto CompileCompute(const ComputePipelineDesc &desc, vk::Pipeline fallback = nullptr) -> PipelineHandle;
+    auto GetPendingCount() const -> size_t;
+    // every compile gets the next serial, a request that joins a pending compile shares its serial
+    auto GetSubmittedSerial() const -> uint64_t {
+        return _submittedSerial;
+    }
+    // true once every compile up to 'serial' has finished and its pipeline was published
+    auto IsPublished(uint64_t serial) const -> bool;
+    // destroys the cached pipelines built from 'shaderModule', none of them may be in use anymore
+    void EvictShaderModule(vk::ShaderModule shaderModule);
+    // blocks until no worker uses the shader modules and layouts of a request anymore
+    void WaitForCompileJobs();
+private:
+    using StatePtr = std::shared_ptr<PipelineHandle::State>;
+    // every request gets its own state, so each keeps its own fallback
+    using PendingMap = std::unordered_map<std::vector<uint8_t>, std::vector<StatePtr>, PipelineKeyHash>;
+    static auto MakeHandle(vk::Pipeline pipeline, vk::Pipeline fallback) -> PipelineHandle;
+    void PublishGraphics(std::vector<uint8_t> key, vk::Pipeline pipeline, uint64_t serial);
+    void PublishCompute(std::vector<uint8_t> key, vk::Pipeline pipeline, uint64_t serial);
+    static void Resolve(PipelineHandle::State &state, vk::Pipeline pipeline);
+private:
+    GraphicsPipelineCache *_pGraphicsPipelineCache = nullptr;
+    PendingMap _pendingGraphicsMap;
+    PendingMap _pendingComputeMap;
+    std::unordered_map<std::vector<uint8_t>, vk::Pipeline, PipelineKeyHash> _computePipelineMap;
+    std::vector<std::future<void>> _compileJobs;
+    uint64_t _submittedSerial = 0;
+    std::set<uint64_t> _pendingSerials;
+};
+
+inline RuntimeStatic<PipelineCompileService> gPipelineCompileService;
+
+}    // namespace vkgfx
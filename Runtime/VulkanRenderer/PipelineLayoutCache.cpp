@@ -0,0 +1,154 @@
+#include "PipelineLayoutCache.h"
+#include <algorithm>
+#include <cstring>
+#include "Device.h"
+#include "Foundation/Logger.h"
+#include "ShaderReflection.h"
+
+namespace vkgfx {
+
+namespace {
+
+template<typename T>
+    requires std::is_trivially_copyable_v<T>
+void WriteKey(std::vector<uint8_t> &key, const T &value) {
+    const uint8_t *pBytes = reinterpret_cast<const uint8_t *>(&value);
+    key.insert(key.end(), pBytes, pBytes + sizeof(T));
+}
+
+}    // namespace
+
+bool PipelineLayoutDesc::AddShaderStage(const ShaderReflection &reflection) {
+    vk::ShaderStageFlagBits stage = reflection.GetStage();
+    for (const ShaderReflection::DescriptorBinding &descriptorBinding : reflection.GetDescriptorBindings()) {
+        if (descriptorBinding.set >= _setBindings.size()) {
+            _setBindings.resize(descriptorBinding.set + 1);
+        }
+        std::vector<vk::DescriptorSetLayoutBinding> &bindings = _setBindings[descriptorBinding.set];
+        auto iter = std::ranges::lower_bound(bindings,
+            descriptorBinding.binding,
+            {},
+            &vk::DescriptorSetLayoutBinding::binding);
+        if (iter != bindings.end() && iter->binding == descriptorBinding.binding) {
+            if (iter->descriptorType != descriptorBinding.descriptorType ||
+                iter->descriptorCount != descriptorBinding.descriptorCount) {
+                Logger::Warning("The stages disagree on set {} binding {}",
+                    descriptorBinding.set,
+                    descriptorBinding.binding);
+                return false;
+            }
+            iter->stageFlags |= stage;
+            continue;
+        }
+
+        vk::DescriptorSetLayoutBinding binding;
+        binding.binding = descriptorBinding.binding;
+        binding.descriptorType = descriptorBinding.descriptorType;
+        binding.descriptorCount = descriptorBinding.descriptorCount;
+        binding.stageFlags = stage;
+        binding.pImmutableSamplers = nullptr;
+        bindings.insert(iter, binding);
+    }
+
+    // stages that share a block get one range, Vulkan allows a stage in only one range
+    for (const vk::PushConstantRange &stageRange : reflection.GetPushConstantRanges()) {
+        auto iter = std::ranges::find_if(_pushConstantRanges, [&](const vk::PushConstantRange &range) {
+            return range.offset == stageRange.offset && range.size == stageRange.size;
+        });
+        if (iter != _pushConstantRanges.end()) {
+            iter->stageFlags |= stageRange.stageFlags;
+        } else {
+            _pushConstantRanges.push_back(stageRange);
+        }
+    }
+    return true;
+}
+
+void PipelineLayoutCache::OnCreate(Device *pDevice) {
+    SetDevice(pDevice);
+    SetIsCreate(true);
+}
+
+void PipelineLayoutCache::OnDestroy() {
+    Clear();
+    SetIsCreate(false);
+    SetDevice(nullptr);
+}
+
+auto PipelineLayoutCache::GetDescriptorSetLayout(std::span<const vk::DescriptorSetLayoutBinding> bindings)
+    -> vk::DescriptorSetLayout {
+
+    // immutable samplers are not supported, everything else of a binding is four 32-bit fields
+    std::vector<uint8_t> key;
+    key.reserve(bindings.size() * 16);
+    for (const vk::DescriptorSetLayoutBinding &binding : bindings) {
+        ExceptionAssert(binding.pImmutableSamplers == nullptr);
+        WriteKey(key, binding.binding);
+        WriteKey(key, binding.descriptorType);
+        WriteKey(key, binding.descriptorCount);
+        WriteKey(key, binding.stageFlags);
+    }
+    if (auto iter = _setLayoutMap.find(key); iter != _setLayoutMap.end()) {
+        return iter->second;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo createInfo;
+    createInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    createInfo.pBindings = bindings.data();
+    vk::DescriptorSetLayout setLayout = GetDevice()->GetVKDevice().createDescriptorSetLayout(createInfo);
+    _setLayoutMap.emplace(std::move(key), setLayout);
+    return setLayout;
+}
+
+auto PipelineLayoutCache::GetPipelineLayout(const PipelineLayoutDesc &desc) -> vk::PipelineLayout {
+    // equal binding tables share a set layout, so the handles identify the sets
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    setLayouts.reserve(desc.GetSetCount());
+    for (uint32_t set = 0; set < desc.GetSetCount(); ++set) {
+        setLayouts.push_back(GetDescriptorSetLayout(desc.GetSetBindings(set)));
+    }
+
+    std::vector<uint8_t> key;
+    WriteKey(key, static_cast<uint32_t>(setLayouts.size()));
+    for (vk::DescriptorSetLayout setLayout : setLayouts) {
+        WriteKey(key, setLayout);
+    }
+    for (const vk::PushConstantRange &range : desc.GetPushConstantRanges()) {
+        WriteKey(key, range);
+    }
+    if (auto iter = _pipelineLayoutMap.find(key); iter != _pipelineLayoutMap.end()) {
+        return iter->second;
+    }
+
+    std::span<const vk::PushConstantRange> pushConstantRanges = desc.GetPushConstantRanges();
+    vk::PipelineLayoutCreateInfo createInfo;
+    createInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    createInfo.pSetLayouts = setLayouts.data();
+    createInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    createInfo.pPushConstantRanges = pushConstantRanges.data();
+    vk::PipelineLayout pipelineLayout = GetDevice()->GetVKDevice().createPipelineLayout(createInfo);
+    _pipelineLayoutMap.emplace(std::move(key), pipelineLayout);
+    return pipelineLayout;
+}
+
+auto PipelineLayoutCache::GetDescriptorSetLayoutCount() const -> size_t {
+    return _setLayoutMap.size();
+}
+
+auto PipelineLayoutCache::GetPipelineLayoutCount() const -> size_t {
+    return _pipelineLayoutMap.size();
+}
+
+void PipelineLayoutCache::Clear() {
+    vk::Device device = GetDevice()->GetVKDevice();
+    for (auto &&[_, pipelineLayout] : _pipelineLayoutMap) {
+        device.destroyPipelineLayout(pipelineLayout);
+    }
+    for (auto &&[_, setLayout] : _setLayoutMap) {
+        device.destroyDescriptorSetLayout(setLayout);
+    }
+    _pipelineLayoutMap.clear();
+    _setLayoutMap.clear();
+}
+
+}    // namespace vkgfx
@@ -0,0 +1,56 @@
+#pragma once
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+#include "Foundation/RuntimeStatic.h"
+#include "GraphicsPipelineCache.h"
+#include "VKObject.h"
+
+namespace vkgfx {
+
+class Device;
+class ShaderReflection;
+
+// The descriptor set bindings and push constant ranges of a pipeline, merged from the reflection of
+// its shader stages. A binding used by several stages gets the stage flags of all of them.
+class PipelineLayoutDesc {
+public:
+    // false when the stage declares a binding another stage declared with a different type or count,
+    // the desc is then unusable
+    bool AddShaderStage(const ShaderReflection &reflection);
+    auto GetSetCount() const -> uint32_t {
+        return static_cast<uint32_t>(_setBindings.size());
+    }
+    // sorted by binding, empty for a set no stage uses
+    auto GetSetBindings(uint32_t set) const -> std::span<const vk::DescriptorSetLayoutBinding> {
+        return _setBindings[set];
+    }
+    auto GetPushConstantRanges() const -> std::span<const vk::PushConstantRange> {
+        return _pushConstantRanges;
+    }
+private:
+    std::vector<std::vector<vk::DescriptorSetLayoutBinding>> _setBindings;
+    std::vector<vk::PushConstantRange> _pushConstantRanges;
+};
+
+// Hands out one vk::DescriptorSetLayout per distinct binding table and one vk::PipelineLayout per
+// distinct PipelineLayoutDesc, so pipelines with the same layout share it. Like GraphicsPipelineCache
+// the objects live until 'Clear' or 'OnDestroy' and callers must not destroy them. Main thread only.
+class PipelineLayoutCache : public VKObject {
+public:
+    void OnCreate(Device *pDevice);
+    void OnDestroy();
+    auto GetDescriptorSetLayout(std::span<const vk::DescriptorSetLayoutBinding> bindings) -> vk::DescriptorSetLayout;
+    auto GetPipelineLayout(const PipelineLayoutDesc &desc) -> vk::PipelineLayout;
+    auto GetDescriptorSetLayoutCount() const -> size_t;
+    auto GetPipelineLayoutCount() const -> size_t;
+    void Clear();
+private:
+    std::unordered_map<std::vector<uint8_t>, vk::DescriptorSetLayout, PipelineKeyHash> _setLayoutMap;
+    std::unordered_map<std::vector<uint8_t>, vk::PipelineLayout, PipelineKeyHash> _pipelineLayoutMap;
+};
+
+inline RuntimeStatic<PipelineLayoutCache> gPipelineLayoutCache;
+
+}    // namespace vkgfx
@@ -18,6 +18,7 @@
 // THE SOFTWARE.
 
 #pragma once
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include "Foundation/NonCopyable.h"
@@ -30,18 +31,18 @@ class Ring {
 public:
     void Create(uint32_t TotalSize) {
         _head = 0;
-        _allocatedSize = 0;
+        _allocatedSize.store(0, std::memory_order_relaxed);
         _totalSize = TotalSize;
     }
 
     uint32_t GetSize() const {
-        return _allocatedSize;
+        return _allocatedSize.load(std::memory_order_relaxed);
     }
     uint32_t GetHead() const {
         return _head;
     }
     uint32_t GetTail() const {
-        return (_head + _allocatedSize) % _totalSize;
+        return (_head + GetSize()) % _totalSize;
     }
 
     //helper to avoid allocating chunks that wouldn't fit contiguously in the ring
@@ -54,11 +55,12 @@ public:
     }
 
     bool Alloc(uint32_t size, uint32_t *pOut) {
-        if (_allocatedSize + size <= _totalSize) {
+        uint32_t allocatedSize = GetSize();
+        if (allocatedSize + size <= _totalSize) {
             if (pOut)
                 *pOut = GetTail();
 
-            _allocatedSize += size;
+            _allocatedSize.store(allocatedSize + size, std::memory_order_relaxed);
             return true;
         }
 
@@ -66,22 +68,42 @@ public:
         return false;
     }
 
+    // Lock-free version of 'PaddingToAvoidCrossOver' + 'Alloc'. Several threads may call it at the same time,
+    // but never concurrently with 'Free'. 'pOutAllocated' receives the padding plus size that was consumed.
+    bool AllocContiguous(uint32_t size, uint32_t *pOut, uint32_t *pOutAllocated) {
+        uint32_t allocatedSize = _allocatedSize.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t tail = (_head + allocatedSize) % _totalSize;
+            uint32_t padding = (tail + size > _totalSize) ? (_totalSize - tail) : 0;
+            uint32_t newAllocatedSize = allocatedSize + padding + size;
+            if (newAllocatedSize > _totalSize) {
+                return false;
+            }
+            if (_allocatedSize.compare_exchange_weak(allocatedSize, newAllocatedSize, std::memory_order_relaxed)) {
+                *pOut = (tail + padding) % _totalSize;
+                *pOutAllocated = padding + size;
+                return true;
+            }
+        }
+    }
+
     bool Free(uint32_t size) {
-        if (_allocatedSize >= size) {
+        uint32_t allocatedSize = GetSize();
+        if (allocatedSize >= size) {
             _head = (_head + size) % _totalSize;
-            _allocatedSize -= size;
+            _allocatedSize.store(allocatedSize - size, std::memory_order_relaxed);
             return true;
         }
         return false;
     }
 
     size_t GetAllocatableSize() const {
-	    return _totalSize - _allocatedSize;
+	    return _totalSize - GetSize();
     }
 private:
     uint32_t _head = 0;
     uint32_t _totalSize = 0;
-    uint32_t _allocatedSize = 0;
+    std::atomic<uint32_t> _allocatedSize = 0;
 };
 
 //
@@ -93,6 +115,9 @@ private:
 // of the oldest frame and makes those entries available for the next frame. This happens
 // when you call 'OnBeginFrame()'
 //
+// 'Alloc' is lock-free and may be called from any number of threads during a frame.
+// 'OnBeginFrame' retires a whole frame at once, so it must not race with 'Alloc'.
+//
 class RingWithTabs : public NonCopyable {
 public:
     void OnCreate(uint32_t numberOfBackBuffers, uint32_t memTotalSize) {
@@ -100,7 +125,7 @@ public:
         _numberOfBackBuffers = numberOfBackBuffers;
 
         //init mem per frame tracker
-        _memAllocatedInFrame = 0;
+        _memAllocatedInFrame.store(0, std::memory_order_relaxed);
         for (int i = 0; i < 4; i++) {
             _allocatedMemPerBackBuffer[i] = 0;
         }
@@ -112,26 +137,17 @@ public:
     }
 
     bool Alloc(uint32_t size, uint32_t *pOut) {
-        uint32_t padding = _mem.PaddingToAvoidCrossOver(size);
-        if (padding > 0) {
-            _memAllocatedInFrame += padding;
-
-            if (_mem.Alloc(padding, NULL) == false)    //alloc chunk to avoid crossover, ignore offset
-            {
-                return false;    //no mem, cannot allocate apdding
-            }
-        }
-
-        if (_mem.Alloc(size, pOut) == true) {
-            _memAllocatedInFrame += size;
-            return true;
+        uint32_t allocated = 0;
+        if (!_mem.AllocContiguous(size, pOut, &allocated)) {
+            return false;
         }
-        return false;
+        // padding to avoid crossover is accounted to this frame as well
+        _memAllocatedInFrame.fetch_add(allocated, std::memory_order_relaxed);
+        return true;
     }
 
     void OnBeginFrame() {
-        _allocatedMemPerBackBuffer[_backBufferIndex] = _memAllocatedInFrame;
-        _memAllocatedInFrame = 0;
+        _allocatedMemPerBackBuffer[_backBufferIndex] = _memAllocatedInFrame.exchange(0, std::memory_order_relaxed);
 
         _backBufferIndex = (_backBufferIndex + 1) % _numberOfBackBuffers;
 
@@ -143,12 +159,15 @@ public:
     size_t GetAllocatableSize() const {
 	    return _mem.GetAllocatableSize();
     }
+    uint32_t GetAllocatedInFrame() const {
+        return _memAllocatedInFrame.load(std::memory_order_relaxed);
+    }
 private:
     //internal ring buffer
     Ring _mem;
     //this is the external ring buffer (I could have reused the Ring class though)
     uint32_t _backBufferIndex = 0;
-    uint32_t _memAllocatedInFrame = 0;
+    std::atomic<uint32_t> _memAllocatedInFrame = 0;
     uint32_t _numberOfBackBuffers = 0;
     uint32_t _allocatedMemPerBackBuffer[4] = {0};
 };
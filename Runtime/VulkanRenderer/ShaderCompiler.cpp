@@ -1,36 +1,45 @@
 #include "ShaderCompiler.h"
 #include "DxcModule.h"
 #include "Foundation/Exception.h"
+#include "Foundation/Hash.hpp"
 #include "Foundation/StringConvert.h"
 #include "DefineList.h"
-#include "Foundation/PathUtils.h"
-#include "Utils/AssetProjectSetting.h"
-#include "DxcModule.h"
+#include "ShaderIncludeCache.h"
+#include <cstring>
+#include <unordered_set>
 
 namespace vkgfx {
 
 class CustomIncludeHandler : public IDxcIncludeHandler {
 public:
+    // the files loaded from now on are appended to 'pIncludeFiles'
+    void RecordIncludeFiles(std::vector<stdfs::path> *pIncludeFiles) {
+        _pIncludeFiles = pIncludeFiles;
+    }
+
     HRESULT STDMETHODCALLTYPE LoadSource(_In_ LPCWSTR pFilename,
         _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) override {
-        using Microsoft::WRL::ComPtr;
-        ComPtr<IDxcBlobEncoding> pEncoding;
-
-        stdfs::path filePath(nstd::to_string(std::wstring(pFilename)));
-        stdfs::path assetAbsolutePath = gAssetProjectSetting->GetAssetAbsolutePath();
-        std::optional<stdfs::path> pRelativePath = nstd::ToRelativePath(assetAbsolutePath, filePath);
-        if (!pRelativePath) {
+        *ppIncludeSource = nullptr;
+        std::shared_ptr<const ShaderIncludeCache::SourceFile> pSourceFile = gShaderIncludeCache->Load(pFilename);
+        if (pSourceFile == nullptr) {
             return S_FALSE;
         }
 
-        filePath = assetAbsolutePath / pRelativePath.value();
-        std::wstring wFileName = nstd::to_wstring(filePath.string());
-        HRESULT hr = gDxcModule->GetUtils()->LoadFile(wFileName.c_str(), nullptr, pEncoding.GetAddressOf());
-        if (SUCCEEDED(hr)) {
-            *ppIncludeSource = pEncoding.Detach();
-            return S_OK;
+        // the blob points into the cached file, which is pinned until the compile is done
+        Microsoft::WRL::ComPtr<IDxcBlobEncoding> pEncoding;
+        HRESULT hr = gDxcModule->GetThreadUtils()->CreateBlobFromPinned(pSourceFile->content.data(),
+            static_cast<UINT32>(pSourceFile->content.size()),
+            DXC_CP_UTF8,
+            pEncoding.GetAddressOf());
+        if (FAILED(hr)) {
+            return S_FALSE;
+        }
+        if (_pIncludeFiles != nullptr) {
+            _pIncludeFiles->push_back(pSourceFile->path);
         }
-        return S_FALSE;
+        _sourceFiles.push_back(std::move(pSourceFile));
+        *ppIncludeSource = pEncoding.Detach();
+        return S_OK;
     }
 
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, _COM_Outptr_ void __RPC_FAR *__RPC_FAR *ppvObject) override {
@@ -42,6 +51,9 @@ public:
     ULONG STDMETHODCALLTYPE Release(void) override {
         return 0;
     }
+private:
+    std::vector<stdfs::path> *_pIncludeFiles = nullptr;
+    std::vector<std::shared_ptr<const ShaderIncludeCache::SourceFile>> _sourceFiles;
 };
 
 bool ShaderCompiler::Compile(const stdfs::path &path,
@@ -53,11 +65,55 @@ bool ShaderCompiler::Compile(const stdfs::path &path,
     std::wstring fileName = nstd::to_wstring(path.string());
     CustomIncludeHandler includeHandler;
     Microsoft::WRL::ComPtr<IDxcBlob> pSourceBlob;
+    // a missing file is reported as S_FALSE with no blob, e.g. while an editor replaces it by a rename
     _result = includeHandler.LoadSource(fileName.c_str(), pSourceBlob.GetAddressOf());
-    if (FAILED(_result)) {
+    if (_result != S_OK || pSourceBlob == nullptr) {
+        _result = E_FAIL;
         _errorMessage = fmt::format("Can't open the file {}", path.string());
         return false;
     }
+    _includeFiles.clear();
+    includeHandler.RecordIncludeFiles(&_includeFiles);
+
+    std::vector<std::wstring> argumentStrings = MakeArguments(entryPoint, type, pDefineList, makeDebugInfo);
+    std::vector<LPCWSTR> arguments = {fileName.c_str()};
+    for (const std::wstring &argument : argumentStrings) {
+        arguments.push_back(argument.c_str());
+    }
+
+    // Compile shader
+    DxcBuffer buffer{};
+    buffer.Encoding = DXC_CP_UTF8;
+    buffer.Ptr = pSourceBlob->GetBufferPointer();
+    buffer.Size = pSourceBlob->GetBufferSize();
+
+    Microsoft::WRL::ComPtr<IDxcResult> pCompileResult;
+    _result = gDxcModule->GetThreadCompiler3()->Compile(&buffer,
+        arguments.data(),
+        static_cast<uint32_t>(arguments.size()),
+        &includeHandler,
+        IID_PPV_ARGS(&pCompileResult));
+
+    if (pCompileResult == nullptr) {
+	    return false;
+    }
+
+    pCompileResult->GetStatus(&_result);
+    if (FAILED(_result)) {
+	    Microsoft::WRL::ComPtr<IDxcBlobEncoding> pErrorBlob;
+	    _result = pCompileResult->GetErrorBuffer(&pErrorBlob);
+	    _errorMessage = static_cast<const char *>(pErrorBlob->GetBufferPointer());
+	    return false;
+    }
+
+    _result = pCompileResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&_pByteCode), nullptr);
+    return SUCCEEDED(_result);
+}
+
+auto ShaderCompiler::MakeArguments(std::string_view entryPoint,
+    ShaderType type,
+    ObjectView<const DefineList> pDefineList,
+    bool makeDebugInfo) -> std::vector<std::wstring> {
 
     std::wstring_view target;
     switch (type) {
@@ -84,51 +140,41 @@ bool ShaderCompiler::Compile(const stdfs::path &path,
         break;
     }
 
-    std::wstring entryPointStr = nstd::to_wstring(entryPoint);
-    std::vector<LPCWSTR> arguments = {fileName.c_str(), L"-E", entryPointStr.c_str(), L"-T", target.data(), L"-spirv"};
-
-	if (makeDebugInfo) {
-		arguments.push_back(L"-Zi");
+    std::vector<std::wstring> arguments = {L"-E", nstd::to_wstring(entryPoint), L"-T", std::wstring(target), L"-spirv"};
+    if (makeDebugInfo) {
+        arguments.push_back(L"-Zi");
         arguments.push_back(L"-O0");
-	}
-
+    }
 
-    std::vector<std::wstring> macros;
     if (pDefineList.HasValue()) {
-	    for (auto &&[key, value] : *pDefineList) {
-	        std::string arg = fmt::format("-D{}={}", key, value);
-	        macros.push_back(nstd::to_wstring(arg));
-	        arguments.push_back(macros.back().c_str());
-	    }
+        for (const DefineList::MacroItem &item : *pDefineList) {
+            arguments.push_back(nstd::to_wstring(fmt::format("-D{}={}", item.GetKey(), item.value)));
+        }
     }
+    return arguments;
+}
 
-    // Compile shader
-    DxcBuffer buffer{};
-    buffer.Encoding = DXC_CP_ACP;
-    buffer.Ptr = pSourceBlob->GetBufferPointer();
-    buffer.Size = pSourceBlob->GetBufferSize();
-
-    Microsoft::WRL::ComPtr<IDxcResult> pCompileResult;
-    _result = gDxcModule->GetCompiler3()->Compile(&buffer,
-        arguments.data(),
-        static_cast<uint32_t>(arguments.size()),
-        &includeHandler,
-        IID_PPV_ARGS(&pCompileResult));
+auto ShaderCompiler::GetArgumentsHash(std::string_view entryPoint,
+    ShaderType type,
+    ObjectView<const DefineList> pDefineList,
+    bool makeDebugInfo) -> uint64_t {
 
-    if (pCompileResult == nullptr) {
-	    return false;
+    uint64_t hash = nstd::kFNV1a64OffsetBasis;
+    for (const std::wstring &argument : MakeArguments(entryPoint, type, nullptr, makeDebugInfo)) {
+        // include the terminator, so "-DA" "B" and "-DAB" differ
+        hash = nstd::FNV1a64(argument.c_str(), (argument.size() + 1) * sizeof(wchar_t), hash);
     }
-
-    pCompileResult->GetStatus(&_result);
-    if (FAILED(_result)) {
-	    Microsoft::WRL::ComPtr<IDxcBlobEncoding> pErrorBlob;
-	    _result = pCompileResult->GetErrorBuffer(&pErrorBlob);
-	    _errorMessage = static_cast<const char *>(pErrorBlob->GetBufferPointer());
-	    return false;
+    // the -D arguments follow the interned macro order, which differs between runs; the define
+    // list hash does not depend on the order. No list and an empty list compile the same code,
+    // so they share a key
+    if (pDefineList.HasValue() && pDefineList->GetCount() > 0) {
+        hash = nstd::HashCombine(hash, pDefineList->GetHash());
     }
+    return hash;
+}
 
-    _result = pCompileResult->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&_pByteCode), nullptr);
-    return SUCCEEDED(_result);
+auto ShaderCompiler::GetIncludeFiles() const -> const std::vector<stdfs::path> & {
+    return _includeFiles;
 }
 
 auto ShaderCompiler::GetErrorMessage() const -> const std::string & {
@@ -146,4 +192,77 @@ auto ShaderCompiler::GetByteCodeSize() const -> size_t {
         return _pByteCode->GetBufferSize();
     return 0;
 }
+
+auto ShaderCompiler::StripDebugInfo(std::span<const char> byteCode) -> std::vector<char> {
+    constexpr uint32_t kSpirvMagic = 0x07230203;
+    constexpr size_t kHeaderWordCount = 5;
+    constexpr uint32_t kOpSourceContinued = 2;
+    constexpr uint32_t kOpSource = 3;
+    constexpr uint32_t kOpSourceExtension = 4;
+    constexpr uint32_t kOpName = 5;
+    constexpr uint32_t kOpMemberName = 6;
+    constexpr uint32_t kOpString = 7;
+    constexpr uint32_t kOpLine = 8;
+    constexpr uint32_t kOpExtInstImport = 11;
+    constexpr uint32_t kOpExtInst = 12;
+    constexpr uint32_t kOpNoLine = 317;
+    constexpr uint32_t kOpModuleProcessed = 330;
+
+    std::vector<uint32_t> words(byteCode.size() / sizeof(uint32_t));
+    std::memcpy(words.data(), byteCode.data(), words.size() * sizeof(uint32_t));
+    if (words.size() < kHeaderWordCount || words[0] != kSpirvMagic) {
+        return std::vector<char>(byteCode.begin(), byteCode.end());
+    }
+
+    // the results of non-semantic instructions may only be used by other non-semantic instructions
+    std::unordered_set<uint32_t> nonSemanticSets;
+    std::vector<uint32_t> strippedWords(words.begin(), words.begin() + kHeaderWordCount);
+    strippedWords.reserve(words.size());
+    for (size_t offset = kHeaderWordCount; offset < words.size();) {
+        uint32_t opcode = words[offset] & 0xffff;
+        uint32_t wordCount = words[offset] >> 16;
+        if (wordCount == 0 || offset + wordCount > words.size()) {
+            return std::vector<char>(byteCode.begin(), byteCode.end());
+        }
+
+        bool strip = false;
+        switch (opcode) {
+        case kOpSourceContinued:
+        case kOpSource:
+        case kOpSourceExtension:
+        case kOpName:
+        case kOpMemberName:
+        case kOpString:
+        case kOpLine:
+        case kOpNoLine:
+        case kOpModuleProcessed:
+            strip = true;
+            break;
+        case kOpExtInstImport: {
+            const char *pName = reinterpret_cast<const char *>(&words[offset + 2]);
+            size_t nameCapacity = (wordCount - 2) * sizeof(uint32_t);
+            std::string_view name(pName, strnlen(pName, nameCapacity));
+            if (name.starts_with("NonSemantic.")) {
+                nonSemanticSets.insert(words[offset + 1]);
+                strip = true;
+            }
+            break;
+        }
+        case kOpExtInst:
+            strip = (wordCount > 3) && nonSemanticSets.contains(words[offset + 3]);
+            break;
+        default:
+            break;
+        }
+
+        if (!strip) {
+            strippedWords.insert(strippedWords.end(), words.begin() + offset, words.begin() + offset + wordCount);
+        }
+        offset += wordCount;
+    }
+
+    std::vector<char> result(strippedWords.size() * sizeof(uint32_t));
+    std::memcpy(result.data(), strippedWords.data(), result.size());
+    return result;
+}
 }    // namespace vkgfx
@@ -1,5 +1,7 @@
 #pragma once
+#include <span>
 #include <string>
+#include <vector>
 #include <Windows.h>
 #include <wrl/client.h>
 #include <dxcapi.h>
@@ -21,11 +23,27 @@ public:
         ObjectView<const DefineList> pDefineList,
         bool makeDebugInfo = !CompileEnvInfo::IsModeRelease());
     auto GetErrorMessage() const -> const std::string &;
+    // every file the compiler included, in the order it asked for them; kept when compiling fails
+    auto GetIncludeFiles() const -> const std::vector<stdfs::path> &;
+    // the command line without the source path, which would tie the shader cache to one machine
+    static auto MakeArguments(std::string_view entryPoint,
+        ShaderType type,
+        ObjectView<const DefineList> pDefineList,
+        bool makeDebugInfo = !CompileEnvInfo::IsModeRelease()) -> std::vector<std::wstring>;
+    static auto GetArgumentsHash(std::string_view entryPoint,
+        ShaderType type,
+        ObjectView<const DefineList> pDefineList,
+        bool makeDebugInfo = !CompileEnvInfo::IsModeRelease()) -> uint64_t;
     auto GetByteCodePtr() const -> void *;
     auto GetByteCodeSize() const -> size_t;
+    // The SPIR-V without its debug instructions (source text, names, line info and non-semantic
+    // debug info), which change neither the code nor the interface. The -Zi output of a debug build
+    // shrinks to what the driver needs.
+    static auto StripDebugInfo(std::span<const char> byteCode) -> std::vector<char>;
 private:
     HRESULT _result = 0;
     std::string _errorMessage;
+    std::vector<stdfs::path> _includeFiles;
     Microsoft::WRL::ComPtr<IDxcBlob> _pByteCode = nullptr;
 };
 
@@ -0,0 +1,90 @@
+#include "ShaderIncludeCache.h"
+#include "Foundation/Hash.hpp"
+#include "Foundation/PathUtils.h"
+#include "Foundation/StringConvert.h"
+#include "Utils/AssetProjectSetting.h"
+#include <fstream>
+#include <mutex>
+
+namespace vkgfx {
+
+auto ShaderIncludeCache::Load(std::wstring_view fileName) -> std::shared_ptr<const SourceFile> {
+    std::optional<stdfs::path> pPath = ResolvePath(fileName);
+    if (!pPath.has_value()) {
+        return nullptr;
+    }
+    {
+        std::shared_lock lock(_mutex);
+        auto iter = _sourceFileMap.find(*pPath);
+        if (iter != _sourceFileMap.end()) {
+            return iter->second;
+        }
+    }
+
+    // read without the lock, the other compiles keep going; the first one to finish wins
+    std::shared_ptr<const SourceFile> pSourceFile = ReadFile(*pPath);
+    if (pSourceFile == nullptr) {
+        return nullptr;
+    }
+    std::unique_lock lock(_mutex);
+    auto iter = _sourceFileMap.try_emplace(*pPath, std::move(pSourceFile)).first;
+    return iter->second;
+}
+
+void ShaderIncludeCache::Invalidate(const stdfs::path &path) {
+    std::unique_lock lock(_mutex);
+    _sourceFileMap.erase(path.lexically_normal());
+}
+
+void ShaderIncludeCache::Clear() {
+    std::unique_lock lock(_mutex);
+    _resolvedPathMap.clear();
+    _sourceFileMap.clear();
+}
+
+auto ShaderIncludeCache::ResolvePath(std::wstring_view fileName) -> std::optional<stdfs::path> {
+    std::wstring key(fileName);
+    {
+        std::shared_lock lock(_mutex);
+        auto iter = _resolvedPathMap.find(key);
+        if (iter != _resolvedPathMap.end()) {
+            return iter->second;
+        }
+    }
+
+    stdfs::path filePath(nstd::to_string(fileName));
+    stdfs::path assetAbsolutePath = gAssetProjectSetting->GetAssetAbsolutePath();
+    std::optional<stdfs::path> pRelativePath = nstd::ToRelativePath(assetAbsolutePath, filePath);
+    if (!pRelativePath) {
+        return std::nullopt;
+    }
+
+    filePath = (assetAbsolutePath / pRelativePath.value()).lexically_normal();
+    std::unique_lock lock(_mutex);
+    _resolvedPathMap.try_emplace(std::move(key), filePath);
+    return filePath;
+}
+
+auto ShaderIncludeCache::ReadFile(const stdfs::path &path) -> std::shared_ptr<const SourceFile> {
+    std::ifstream input(path, std::ios::binary);
+    if (!input.is_open()) {
+        return nullptr;
+    }
+
+    auto pSourceFile = std::make_shared<SourceFile>();
+    pSourceFile->path = path;
+    pSourceFile->content.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    if (input.bad()) {
+        return nullptr;
+    }
+
+    // 'IDxcUtils::LoadFile' used to detect the BOM, the blob is handed over as UTF-8 instead
+    constexpr std::string_view kUtf8Bom = "\xEF\xBB\xBF";
+    if (pSourceFile->content.starts_with(kUtf8Bom)) {
+        pSourceFile->content.erase(0, kUtf8Bom.size());
+    }
+    pSourceFile->contentHash = nstd::FNV1a64(pSourceFile->content);
+    return pSourceFile;
+}
+
+}    // namespace vkgfx
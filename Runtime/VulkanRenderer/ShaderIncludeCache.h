@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/NonCopyable.h"
+#include "Foundation/RuntimeStatic.h"
+
+namespace vkgfx {
+
+// The sources and headers read by the shader compiler, shared by every compile on every thread.
+// A file is read once per process, and the spelling the compiler asks for is resolved against the
+// asset directory once per spelling. The hot reload invalidates the changed files.
+class ShaderIncludeCache : public NonCopyable {
+public:
+    struct SourceFile {
+        stdfs::path path;    // absolute and lexically normal
+        uint64_t contentHash = 0;
+        std::string content;    // without the UTF-8 BOM
+    };
+    // null when the file is outside the asset directory or can't be read; the returned file stays
+    // valid after 'Invalidate', a compile in flight keeps what it already read
+    auto Load(std::wstring_view fileName) -> std::shared_ptr<const SourceFile>;
+    void Invalidate(const stdfs::path &path);
+    void Clear();
+private:
+    auto ResolvePath(std::wstring_view fileName) -> std::optional<stdfs::path>;
+    static auto ReadFile(const stdfs::path &path) -> std::shared_ptr<const SourceFile>;
+private:
+    std::shared_mutex _mutex;
+    std::unordered_map<std::wstring, stdfs::path> _resolvedPathMap;
+    std::unordered_map<stdfs::path, std::shared_ptr<const SourceFile>> _sourceFileMap;
+};
+
+inline RuntimeStatic<ShaderIncludeCache> gShaderIncludeCache;
+
+}    // namespace vkgfx
@@ -0,0 +1,106 @@
+#include "ShaderReflection.h"
+#include <algorithm>
+#include <tuple>
+#include <spirv_reflect.h>
+#include "Foundation/Logger.h"
+
+namespace vkgfx {
+
+namespace {
+
+// releases the reflect module on every return path
+class ReflectModuleGuard {
+public:
+    explicit ReflectModuleGuard(SpvReflectShaderModule &module) : _module(module) {
+    }
+    ~ReflectModuleGuard() {
+        spvReflectDestroyShaderModule(&_module);
+    }
+private:
+    SpvReflectShaderModule &_module;
+};
+
+}    // namespace
+
+bool ShaderReflection::Reflect(std::span<const char> byteCode) {
+    _descriptorBindings.clear();
+    _pushConstantRanges.clear();
+    _vertexInputs.clear();
+
+    SpvReflectShaderModule module = {};
+    if (spvReflectCreateShaderModule(byteCode.size(), byteCode.data(), &module) != SPV_REFLECT_RESULT_SUCCESS) {
+        Logger::Error("Reflect shader module failed: invalid SPIR-V");
+        return false;
+    }
+    ReflectModuleGuard guard(module);
+
+    // the SpvReflect enums share the values of their Vulkan counterparts
+    _stage = static_cast<vk::ShaderStageFlagBits>(module.shader_stage);
+
+    uint32_t count = 0;
+    spvReflectEnumerateDescriptorBindings(&module, &count, nullptr);
+    std::vector<SpvReflectDescriptorBinding *> bindings(count);
+    spvReflectEnumerateDescriptorBindings(&module, &count, bindings.data());
+    for (const SpvReflectDescriptorBinding *pBinding : bindings) {
+        DescriptorBinding &descriptorBinding = _descriptorBindings.emplace_back();
+        descriptorBinding.set = pBinding->set;
+        descriptorBinding.binding = pBinding->binding;
+        descriptorBinding.descriptorType = static_cast<vk::DescriptorType>(pBinding->descriptor_type);
+        descriptorBinding.descriptorCount = pBinding->count;
+    }
+    std::ranges::sort(_descriptorBindings, [](const DescriptorBinding &lhs, const DescriptorBinding &rhs) {
+        return std::tie(lhs.set, lhs.binding) < std::tie(rhs.set, rhs.binding);
+    });
+
+    count = 0;
+    spvReflectEnumeratePushConstantBlocks(&module, &count, nullptr);
+    std::vector<SpvReflectBlockVariable *> pushConstantBlocks(count);
+    spvReflectEnumeratePushConstantBlocks(&module, &count, pushConstantBlocks.data());
+    for (const SpvReflectBlockVariable *pBlock : pushConstantBlocks) {
+        vk::PushConstantRange &range = _pushConstantRanges.emplace_back();
+        range.stageFlags = _stage;
+        range.offset = pBlock->offset;
+        range.size = pBlock->size;
+    }
+
+    if (_stage != vk::ShaderStageFlagBits::eVertex) {
+        return true;
+    }
+
+    count = 0;
+    spvReflectEnumerateInputVariables(&module, &count, nullptr);
+    std::vector<SpvReflectInterfaceVariable *> inputVariables(count);
+    spvReflectEnumerateInputVariables(&module, &count, inputVariables.data());
+    for (const SpvReflectInterfaceVariable *pVariable : inputVariables) {
+        if (pVariable->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN) {
+            continue;
+        }
+        uint32_t componentCount = std::max(pVariable->numeric.vector.component_count, 1u);
+        VertexInput &vertexInput = _vertexInputs.emplace_back();
+        vertexInput.location = pVariable->location;
+        vertexInput.format = static_cast<vk::Format>(pVariable->format);
+        vertexInput.size = pVariable->numeric.scalar.width / 8 * componentCount;
+    }
+    std::ranges::sort(_vertexInputs, {}, &VertexInput::location);
+    return true;
+}
+
+auto ShaderReflection::MakeVertexInput(uint32_t binding,
+    std::vector<vk::VertexInputAttributeDescription> &attributes) const -> vk::VertexInputBindingDescription {
+
+    vk::VertexInputBindingDescription bindingDescription;
+    bindingDescription.binding = binding;
+    bindingDescription.stride = 0;
+    bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+    for (const VertexInput &vertexInput : _vertexInputs) {
+        vk::VertexInputAttributeDescription &attribute = attributes.emplace_back();
+        attribute.location = vertexInput.location;
+        attribute.binding = binding;
+        attribute.format = vertexInput.format;
+        attribute.offset = bindingDescription.stride;
+        bindingDescription.stride += vertexInput.size;
+    }
+    return bindingDescription;
+}
+
+}    // namespace vkgfx
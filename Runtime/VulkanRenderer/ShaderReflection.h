@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace vkgfx {
+
+// What a SPIR-V module declares: its descriptor bindings, push constant ranges and, for a vertex
+// shader, the vertex inputs. PipelineLayoutDesc merges the stages of a pipeline into its layout.
+class ShaderReflection {
+public:
+    struct DescriptorBinding {
+        uint32_t set;
+        uint32_t binding;
+        vk::DescriptorType descriptorType;
+        uint32_t descriptorCount;
+    };
+    struct VertexInput {
+        uint32_t location;
+        vk::Format format;
+        uint32_t size;    // in bytes
+    };
+public:
+    // false when the byte code is not valid SPIR-V
+    bool Reflect(std::span<const char> byteCode);
+    auto GetStage() const -> vk::ShaderStageFlagBits {
+        return _stage;
+    }
+    // sorted by set and binding
+    auto GetDescriptorBindings() const -> std::span<const DescriptorBinding> {
+        return _descriptorBindings;
+    }
+    auto GetPushConstantRanges() const -> std::span<const vk::PushConstantRange> {
+        return _pushConstantRanges;
+    }
+    // sorted by location, without the built-ins
+    auto GetVertexInputs() const -> std::span<const VertexInput> {
+        return _vertexInputs;
+    }
+    // the vertex input state of one interleaved vertex buffer holding the inputs in location order
+    auto MakeVertexInput(uint32_t binding, std::vector<vk::VertexInputAttributeDescription> &attributes) const
+        -> vk::VertexInputBindingDescription;
+private:
+    vk::ShaderStageFlagBits _stage = {};
+    std::vector<DescriptorBinding> _descriptorBindings;
+    std::vector<vk::PushConstantRange> _pushConstantRanges;
+    std::vector<VertexInput> _vertexInputs;
+};
+
+}    // namespace vkgfx
@@ -2,19 +2,31 @@
 #include "Device.h"
 #include "ExtDebugUtils.h"
 #include "Misc.h"
+#include "VKException.h"
 #include "Foundation/Exception.h"
 #include "Foundation/TypeAlias.h"
+#include <algorithm>
 
 namespace vkgfx {
 
 StaticBufferPool::StaticBufferPool() {
 }
 
-auto StaticBufferPool::OnCreate(std::string_view name, Device *pDevice, std::size_t totalMemorySize) -> vk::Result {
+auto StaticBufferPool::OnCreate(std::string_view name,
+    Device *pDevice,
+    std::size_t totalMemorySize,
+    uint32_t numBackBuffers) -> vk::Result {
+
     totalMemorySize = AlignUp<std::size_t>(totalMemorySize, 256);
 
+    _name = name;
     _totalMemorySize = totalMemorySize;
-    _memoryOffset = 0;
+    _numBackBuffers = numBackBuffers;
+    _frameCount = 0;
+
+    VmaVirtualBlockCreateInfo virtualBlockCreateInfo = {};
+    virtualBlockCreateInfo.size = totalMemorySize;
+    VKException::Throw(vmaCreateVirtualBlock(&virtualBlockCreateInfo, &_virtualBlock));
 
     VkResult res = {};
     vk::Device device = pDevice->GetVKDevice();
@@ -24,7 +36,7 @@ auto StaticBufferPool::OnCreate(std::string_view name, Device *pDevice, std::siz
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = totalMemorySize;
     bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-                       VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+                       VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;    // preference for CPU
@@ -38,23 +50,6 @@ auto StaticBufferPool::OnCreate(std::string_view name, Device *pDevice, std::siz
     std::string bufferName = fmt::format("StaticBufferPool_{}_Store", name.data());
     SetResourceName(device, _staticBuffer, bufferName);
 
-    // create upload buffer
-    VkBuffer uploadBuffer = nullptr;
-    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    bufferInfo.flags = 0;
-    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;    // preference for CPU
-    allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-
-    res = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &uploadBuffer, &_uploadBufferAlloc, nullptr);
-    ExceptionAssert(res == VK_SUCCESS);
-
-    _uploadBuffer = vk::Buffer(uploadBuffer);
-    bufferName = fmt::format("StaticBufferPool_{}_Upload", name.data());
-    SetResourceName(device, _uploadBuffer, bufferName);
-
-    res = vmaMapMemory(allocator, _uploadBufferAlloc, &_pData);
-    ExceptionAssert(res == VK_SUCCESS);
-
     SetIsCreate(true);
     SetDevice(pDevice);
     return static_cast<vk::Result>(res);
@@ -71,64 +66,255 @@ void StaticBufferPool::OnDestroy() {
     }
 
     FreeUploadHeap();
-    _memoryOffset = 0;
+    _allocations.clear();
+    _pendingFrees.clear();
+    if (_virtualBlock) {
+        vmaClearVirtualBlock(_virtualBlock);
+        vmaDestroyVirtualBlock(_virtualBlock);
+        _virtualBlock = VK_NULL_HANDLE;
+    }
     _totalMemorySize = 0;
     SetIsCreate(false);
 }
 
-auto StaticBufferPool::AllocBuffer(size_t numElement, size_t stride, void **pData)
-    -> std::optional<vk::DescriptorBufferInfo> {
-
-    ExceptionAssert(_uploadBuffer);
+auto StaticBufferPool::AllocBuffer(size_t numElement, size_t stride, void **pData) -> BufferView {
     ExceptionAssert(pData != nullptr);
+    if (!_uploadBuffer) {
+        CreateUploadBuffer();
+    }
 
-    size_t size = AlignUp(numElement * stride, static_cast<size_t>(256));
+    Allocation *pAllocation = AllocRange(numElement * stride);
     // bad allocate
-    if (_memoryOffset + size > _totalMemorySize) {
+    if (pAllocation == nullptr) {
         *pData = nullptr;
-        return std::nullopt;
+        return nullptr;
     }
-
-    *pData = (static_cast<uint8 *>(_pData) + _memoryOffset);
-    vk::DescriptorBufferInfo info;
-    info.buffer = _staticBuffer;
-    info.offset = _memoryOffset;
-    info.range = size;
-    _memoryOffset += size;
-    return std::make_optional(info);
+    *pData = (static_cast<uint8 *>(_pData) + pAllocation->bufferInfo.offset);
+    return pAllocation->bufferInfo;
 }
 
-auto StaticBufferPool::AllocBuffer(size_t numElement, size_t stride, const void *pInitData)
-    -> std::optional<vk::DescriptorBufferInfo> {
-
+auto StaticBufferPool::AllocBuffer(size_t numElement, size_t stride, const void *pInitData) -> BufferView {
     void *pBufferPtr = nullptr;
-    std::optional<vk::DescriptorBufferInfo> info = AllocBuffer(numElement, stride, &pBufferPtr);
+    BufferView view = AllocBuffer(numElement, stride, &pBufferPtr);
     if (pBufferPtr != nullptr) {
         std::memcpy(pBufferPtr, pInitData, numElement * stride);
     }
-    return info;
+    return view;
+}
+
+auto StaticBufferPool::AllocBuffer(UploadHeap &uploadHeap, size_t numElement, size_t stride, const void *pInitData)
+    -> BufferView {
+
+    Allocation *pAllocation = AllocRange(numElement * stride);
+    if (pAllocation == nullptr) {
+        return nullptr;
+    }
+    uploadHeap.UploadBuffer(_staticBuffer,
+        pAllocation->bufferInfo.offset,
+        pInitData,
+        numElement * stride,
+        vk::PipelineStageFlagBits::eVertexInput,
+        vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead);
+    pAllocation->uploaded = true;
+    pAllocation->uploadTimelineValue = uploadHeap.GetRecordingTimelineValue();
+    return pAllocation->bufferInfo;
+}
+
+void StaticBufferPool::FreeBuffer(BufferView bufferView) {
+    auto iter = _allocations.find(bufferView.operator->());
+    ExceptionAssert(iter != _allocations.end());
+    _pendingFrees.push_back({iter->second->virtualAlloc, _frameCount});
+    _allocations.erase(iter);
+}
+
+void StaticBufferPool::OnBeginFrame() {
+    ++_frameCount;
+    std::erase_if(_pendingFrees, [&](const PendingFree &pendingFree) {
+        if (pendingFree.frameCount + _numBackBuffers > _frameCount) {
+            return false;
+        }
+        vmaVirtualFree(_virtualBlock, pendingFree.virtualAlloc);
+        return true;
+    });
+}
+
+// Moves live ranges towards the start of the store, at most 'maxBytesToMove' bytes per call. The copies
+// are recorded into 'cmd', which has to execute before any draw that reads the patched ranges; the old
+// ranges stay reserved until the frames in flight that may still read them are retired. A range is only
+// moved once the upload batch that carried it has finished and was acquired, so 'cmd' has to be submitted
+// to the graphics queue after the command buffer of the last 'RecordAcquireBarriers'.
+auto StaticBufferPool::Defragment(vk::CommandBuffer cmd, const UploadHeap &uploadHeap, size_t maxBytesToMove)
+    -> size_t {
+
+    uint64_t finishedValue = uploadHeap.GetFinishedTimelineValue();
+    std::vector<Allocation *> allocations;
+    allocations.reserve(_allocations.size());
+    for (auto &&[_, pAllocation] : _allocations) {
+        // the copy into the range may not have landed yet, moving it would copy stale data
+        if (pAllocation->uploaded && pAllocation->uploadTimelineValue <= finishedValue) {
+            allocations.push_back(pAllocation.get());
+        }
+    }
+    std::ranges::sort(allocations, [](const Allocation *lhs, const Allocation *rhs) {
+        return lhs->bufferInfo.offset > rhs->bufferInfo.offset;
+    });
+
+    size_t movedBytes = 0;
+    std::vector<vk::BufferCopy> regions;
+    for (Allocation *pAllocation : allocations) {
+        vk::DescriptorBufferInfo &bufferInfo = pAllocation->bufferInfo;
+        if (movedBytes + bufferInfo.range > maxBytesToMove) {
+            break;
+        }
+
+        VmaVirtualAllocationCreateInfo allocCreateInfo = {};
+        allocCreateInfo.size = bufferInfo.range;
+        allocCreateInfo.alignment = 256;
+        allocCreateInfo.flags = VMA_VIRTUAL_ALLOCATION_CREATE_STRATEGY_MIN_OFFSET_BIT;
+
+        VmaVirtualAllocation virtualAlloc = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        if (vmaVirtualAllocate(_virtualBlock, &allocCreateInfo, &virtualAlloc, &offset) != VK_SUCCESS) {
+            continue;
+        }
+        if (offset >= bufferInfo.offset) {
+            vmaVirtualFree(_virtualBlock, virtualAlloc);
+            continue;
+        }
+
+        vk::BufferCopy region;
+        region.srcOffset = bufferInfo.offset;
+        region.dstOffset = offset;
+        region.size = bufferInfo.range;
+        regions.push_back(region);
+        if (_pData != nullptr) {
+            std::memcpy(static_cast<uint8 *>(_pData) + offset,
+                static_cast<uint8 *>(_pData) + bufferInfo.offset,
+                bufferInfo.range);
+        }
+
+        _pendingFrees.push_back({pAllocation->virtualAlloc, _frameCount});
+        pAllocation->virtualAlloc = virtualAlloc;
+        bufferInfo.offset = offset;
+        movedBytes += bufferInfo.range;
+    }
+
+    if (regions.empty()) {
+        return 0;
+    }
+
+    vk::BufferMemoryBarrier barrier;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = _staticBuffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eTransfer,
+        {},
+        0,
+        nullptr,
+        1,
+        &barrier,
+        0,
+        nullptr);
+
+    cmd.copyBuffer(_staticBuffer, _staticBuffer, regions);
+
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead;
+    cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eVertexInput,
+        {},
+        0,
+        nullptr,
+        1,
+        &barrier,
+        0,
+        nullptr);
+    return movedBytes;
 }
 
-void StaticBufferPool::UploadData(const UploadHeap &uploadHeap, const vk::DescriptorBufferInfo &bufferInfo) {
-    ExceptionAssert(_uploadBuffer);
-    vk::BufferCopy region;
-    region.srcOffset = bufferInfo.offset;
-    region.dstOffset = bufferInfo.offset;
-    region.size = bufferInfo.range;
-    uploadHeap.GetCommandBuffer().copyBuffer(_uploadBuffer, _staticBuffer, region);
+void StaticBufferPool::UploadData(UploadHeap &uploadHeap, BufferView bufferView) {
+    auto iter = _allocations.find(bufferView.operator->());
+    ExceptionAssert(iter != _allocations.end() && _uploadBuffer);
+    Allocation &allocation = *iter->second;
+    allocation.uploaded = true;
+    allocation.uploadTimelineValue = uploadHeap.GetRecordingTimelineValue();
+
+    const vk::DescriptorBufferInfo &bufferInfo = allocation.bufferInfo;
+    UploadHeap::BufferUploadJob job;
+    job.srcBuffer = _uploadBuffer;
+    job.dstBuffer = _staticBuffer;
+    job.bufferCopy.srcOffset = bufferInfo.offset;
+    job.bufferCopy.dstOffset = bufferInfo.offset;
+    job.bufferCopy.size = bufferInfo.range;
+    job.dstStageMask = vk::PipelineStageFlagBits::eVertexInput;
+    job.dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead;
+    uploadHeap.AddBufferJob(job);
 }
 
-void StaticBufferPool::UploadData(const UploadHeap &uploadHeap) {
-    ExceptionAssert(_uploadBuffer);
-    vk::BufferCopy region;
-    region.srcOffset = 0;
-    region.dstOffset = 0;
-    region.size = _totalMemorySize;
-    uploadHeap.GetCommandBuffer().copyBuffer(_uploadBuffer, _staticBuffer, region);
+void StaticBufferPool::UploadData(UploadHeap &uploadHeap) {
+    // the staging buffer may have been created again since the first upload, only the new ranges hold data
+    for (auto &&[pBufferInfo, pAllocation] : _allocations) {
+        if (!pAllocation->uploaded) {
+            UploadData(uploadHeap, *pBufferInfo);
+        }
+    }
 }
 
 auto StaticBufferPool::GetAllocatableSize() const -> size_t {
-    return _totalMemorySize - _memoryOffset;
+    VmaStatistics statistics = {};
+    vmaGetVirtualBlockStatistics(_virtualBlock, &statistics);
+    return _totalMemorySize - statistics.allocationBytes;
+}
+
+auto StaticBufferPool::AllocRange(size_t size) -> Allocation * {
+    size = AlignUp(size, static_cast<size_t>(256));
+    VmaVirtualAllocationCreateInfo allocCreateInfo = {};
+    allocCreateInfo.size = size;
+    allocCreateInfo.alignment = 256;
+
+    VmaVirtualAllocation virtualAlloc = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    if (vmaVirtualAllocate(_virtualBlock, &allocCreateInfo, &virtualAlloc, &offset) != VK_SUCCESS) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Allocation> pAllocation = std::make_unique<Allocation>();
+    pAllocation->bufferInfo.buffer = _staticBuffer;
+    pAllocation->bufferInfo.offset = offset;
+    pAllocation->bufferInfo.range = size;
+    pAllocation->virtualAlloc = virtualAlloc;
+    Allocation *pResult = pAllocation.get();
+    _allocations.emplace(&pResult->bufferInfo, std::move(pAllocation));
+    return pResult;
+}
+
+void StaticBufferPool::CreateUploadBuffer() {
+    VmaAllocator allocator = GetDevice()->GetAllocator();
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = _totalMemorySize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;    // preference for CPU
+    allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+    VkBuffer uploadBuffer = nullptr;
+    VkResult res = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &uploadBuffer, &_uploadBufferAlloc, nullptr);
+    ExceptionAssert(res == VK_SUCCESS);
+
+    _uploadBuffer = vk::Buffer(uploadBuffer);
+    std::string bufferName = fmt::format("StaticBufferPool_{}_Upload", _name);
+    SetResourceName(GetDevice()->GetVKDevice(), _uploadBuffer, bufferName);
+
+    res = vmaMapMemory(allocator, _uploadBufferAlloc, &_pData);
+    ExceptionAssert(res == VK_SUCCESS);
 }
 
 void StaticBufferPool::FreeUploadHeap() {
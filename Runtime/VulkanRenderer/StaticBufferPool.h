@@ -1,39 +1,90 @@
 #pragma once
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.h>
+#include <memory>
 #include <span>
+#include <string>
+#include <unordered_map>
 #include "UploadHeap.h"
 #include "VKObject.h"
+#include "Foundation/ObjectView.hpp"
 
 namespace vkgfx {
 
 class Device;
+
+// Device-local store for static vertex/index data. Ranges are sub-allocated with a VMA virtual block
+// (TLSF), so they can be freed and reused while streaming. Freed ranges are only recycled after
+// 'numBackBuffers' calls to 'OnBeginFrame', when no frame in flight can still read them.
+// Data is either streamed through an UploadHeap or written into a host visible staging buffer that
+// 'UploadData' copies from; the staging buffer is created on first use and 'FreeUploadHeap' releases it.
 class StaticBufferPool : public VKObject {
+public:
+    // The pool owns the DescriptorBufferInfo and patches it in place when 'Defragment' moves the range,
+    // so keep the view instead of copying the info out.
+    using BufferView = ObjectView<const vk::DescriptorBufferInfo>;
 public:
     StaticBufferPool();
-    auto OnCreate(std::string_view name, Device *pDevice, std::size_t totalMemorySize) -> vk::Result;
+    auto OnCreate(std::string_view name, Device *pDevice, std::size_t totalMemorySize, uint32_t numBackBuffers = 3)
+        -> vk::Result;
     void OnDestroy();
-    auto AllocBuffer(size_t numElement, size_t stride, void **pData) -> std::optional<vk::DescriptorBufferInfo>;
-    auto AllocBuffer(size_t numElement, size_t stride, const void *pInitData) -> std::optional<vk::DescriptorBufferInfo>;
-    void UploadData(const UploadHeap &uploadHeap, const vk::DescriptorBufferInfo &bufferInfo);
-    void UploadData(const UploadHeap &uploadHeap);
+    auto AllocBuffer(size_t numElement, size_t stride, void **pData) -> BufferView;
+    auto AllocBuffer(size_t numElement, size_t stride, const void *pInitData) -> BufferView;
+    // the data goes through the upload heap in heap sized pieces, the range needs no 'UploadData'
+    auto AllocBuffer(UploadHeap &uploadHeap, size_t numElement, size_t stride, const void *pInitData)
+        -> BufferView;
+    void FreeBuffer(BufferView bufferView);
+    void OnBeginFrame();
+    // 'uploadHeap' is the heap the ranges were uploaded through
+    auto Defragment(vk::CommandBuffer cmd, const UploadHeap &uploadHeap, size_t maxBytesToMove) -> size_t;
+    // the copy runs on the upload heap's transfer queue and hands the range over to the graphics queue
+    void UploadData(UploadHeap &uploadHeap, BufferView bufferView);
+    // uploads every range allocated since the last upload
+    void UploadData(UploadHeap &uploadHeap);
     auto GetAllocatableSize() const -> size_t;
     void FreeUploadHeap();
 
     template<typename T> requires requires { std::span(std::declval<T>()); }
-    auto AllocBuffer(T &&buffer) -> std::optional<vk::DescriptorBufferInfo> {
+    auto AllocBuffer(T &&buffer) -> BufferView {
         std::span view = buffer;
         using ElementType = typename decltype(view)::element_type;
         return AllocBuffer(view.size(), sizeof(ElementType), view.data());
     }
+
+    template<typename T> requires requires { std::span(std::declval<T>()); }
+    auto AllocBuffer(UploadHeap &uploadHeap, T &&buffer) -> BufferView {
+        std::span view = buffer;
+        using ElementType = typename decltype(view)::element_type;
+        return AllocBuffer(uploadHeap, view.size(), sizeof(ElementType), view.data());
+    }
+private:
+    struct Allocation {
+        vk::DescriptorBufferInfo bufferInfo;
+        VmaVirtualAllocation virtualAlloc = VK_NULL_HANDLE;
+        bool uploaded = false;
+        uint64_t uploadTimelineValue = 0;    // the upload heap batch that carries the data
+    };
+    struct PendingFree {
+        VmaVirtualAllocation virtualAlloc = VK_NULL_HANDLE;
+        size_t frameCount = 0;
+    };
+    using AllocationMap = std::unordered_map<const vk::DescriptorBufferInfo *, std::unique_ptr<Allocation>>;
+private:
+    auto AllocRange(size_t size) -> Allocation *;
+    void CreateUploadBuffer();
 private:
+    std::string _name;
     void *_pData = nullptr;
-    size_t _memoryOffset = 0;
     size_t _totalMemorySize = 0;
+    size_t _numBackBuffers = 0;
+    size_t _frameCount = 0;
     vk::Buffer _staticBuffer;
     vk::Buffer _uploadBuffer;
     VmaAllocation _staticBufferAlloc = VK_NULL_HANDLE;
     VmaAllocation _uploadBufferAlloc = VK_NULL_HANDLE;
+    VmaVirtualBlock _virtualBlock = VK_NULL_HANDLE;
+    AllocationMap _allocations;
+    std::vector<PendingFree> _pendingFrees;
 };
 
 }    // namespace vkgfx
@@ -26,6 +26,7 @@ void SwapChain::OnCreate(Device *pDevice, uint32_t numBackBuffers) {
 
 void SwapChain::OnDestroy() {
     OnDestroyWindowDependentResources();
+    DestroyRenderPass();
     vk::Device device = GetDevice()->GetVKDevice();
     for (size_t i = 0; i < _imageAvailableSemaphores.size(); ++i) {
         device.destroySemaphore(_imageAvailableSemaphores[i]);
@@ -236,8 +237,6 @@ void SwapChain::OnCreateWindowDependentResources(size_t width, size_t height, bo
     _width = width;
     _height = height;
 
-    CreateRenderPass();
-
     vk::PhysicalDevice physicalDevice = GetDevice()->GetPhysicalDevice();
     vk::SurfaceKHR surface = GetDevice()->GetSurface();
     vk::SurfaceCapabilitiesKHR surfaceCapabilities = physicalDevice.getSurfaceCapabilitiesKHR(surface);
@@ -313,7 +312,6 @@ void SwapChain::OnCreateWindowDependentResources(size_t width, size_t height, bo
 }
 
 void SwapChain::OnDestroyWindowDependentResources() {
-    DestroyRenderPass();
     DestroyFrameBuffers();
     DestroyRTV();
     if (_swapChain) {
@@ -20,6 +20,8 @@ public:
     auto GetCurrentBackBufferRTV() const -> vk::ImageView;
     auto GetSwapChain() const -> vk::SwapchainKHR;
     auto GetFormat() const -> vk::Format;
+    // the render pass only depends on the surface format, so it survives 'Resize' and pipelines built
+    // against it stay valid
     auto GetRenderPass() const -> vk::RenderPass;
     auto GetFrameBuffer(size_t index) const -> vk::Framebuffer;
     auto GetCurrentFrameBuffer() const -> vk::Framebuffer;
@@ -5,23 +5,48 @@
 #include "VKException.h"
 #include "Foundation/Exception.h"
 #include "Foundation/Logger.h"
+#include <algorithm>
+#include <utility>
 
 namespace vkgfx {
 
-void UploadHeap::OnCreate(std::string_view name, Device *pDevice, size_t size) {
+void UploadHeap::OnCreate(std::string_view name, Device *pDevice, size_t size, uint32_t numBatches) {
     vk::Device device = pDevice->GetVKDevice();
     VmaAllocator allocator = pDevice->GetAllocator();
 
     vk::CommandPoolCreateInfo poolCreateInfo;
-    poolCreateInfo.queueFamilyIndex = pDevice->GetGraphicsQueueFamilyIndex();
+    poolCreateInfo.queueFamilyIndex = pDevice->GetTransferQueueFamilyIndex();
     poolCreateInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
     _commandPool = device.createCommandPool(poolCreateInfo);
 
     vk::CommandBufferAllocateInfo commandBufferAllocateInfo;
     commandBufferAllocateInfo.commandPool = _commandPool;
     commandBufferAllocateInfo.level = vk::CommandBufferLevel::ePrimary;
-    commandBufferAllocateInfo.commandBufferCount = 1;
-    _commandBuffer = device.allocateCommandBuffers(commandBufferAllocateInfo).front();
+    commandBufferAllocateInfo.commandBufferCount = numBatches;
+    std::vector<vk::CommandBuffer> commandBuffers = device.allocateCommandBuffers(commandBufferAllocateInfo);
+
+    _batches.resize(numBatches);
+    for (size_t i = 0; i < numBatches; ++i) {
+        UploadBatch &batch = _batches[i];
+        batch.commandBuffer = commandBuffers[i];
+        batch.timelineValue = 0;
+        batch.allocatedSize = 0;
+        batch.inFlight = false;
+        SetResourceName(device, batch.commandBuffer, fmt::format("{}_Batch{}_CommandBuffer", name.data(), i));
+    }
+
+    vk::SemaphoreTypeCreateInfo semaphoreTypeCreateInfo;
+    semaphoreTypeCreateInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+    semaphoreTypeCreateInfo.initialValue = 0;
+    vk::SemaphoreCreateInfo semaphoreCreateInfo;
+    semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+    _timelineSemaphore = device.createSemaphore(semaphoreCreateInfo);
+    SetResourceName(device, _timelineSemaphore, fmt::format("{}_TimelineSemaphore", name.data()));
+    _lastSubmittedValue = 0;
+    _acquireWaitValue = 0;
+    _acquiredValue = 0;
+    _transferQueueFamilyIndex = pDevice->GetTransferQueueFamilyIndex();
+    _graphicsQueueFamilyIndex = pDevice->GetGraphicsQueueFamilyIndex();
 
     VkBufferCreateInfo bufferCreateInfo = {};
     bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -41,24 +66,27 @@ void UploadHeap::OnCreate(std::string_view name, Device *pDevice, size_t size) {
     SetResourceName(device, _buffer, name);
 
     vmaMapMemory(allocator, _bufferAlloc, reinterpret_cast<void **>(&_pDataBegin));
-    _pDataCur = _pDataBegin;
-    _pDataEnd = _pDataBegin + size;
-
-    vk::FenceCreateInfo fenceCreateInfo;
-    _fence = device.createFence(fenceCreateInfo);
-
-    vk::CommandBufferBeginInfo beginInfo;
-    _commandBuffer.begin(beginInfo);
+    _size = size;
+    _mem.Create(static_cast<uint32_t>(size));
 
     SetIsCreate(true);
     SetDevice(pDevice);
+
+    _batchIndex = 0;
+    BeginBatch();
 }
 
 void UploadHeap::OnDestroy() {
     ExceptionAssert(GetIsCreate());
     vk::Device device = GetDevice()->GetVKDevice();
     VmaAllocator allocator = GetDevice()->GetAllocator();
-    device.destroyFence(_fence);
+    while (RetireOldestBatch()) {
+    }
+    _batches.clear();
+    device.destroySemaphore(_timelineSemaphore);
+    _timelineSemaphore = nullptr;
+    _acquireImageBarriers.clear();
+    _acquireBufferBarriers.clear();
     device.destroyCommandPool(_commandPool);
     vmaUnmapMemory(allocator, _bufferAlloc);
     vmaDestroyBuffer(allocator, _buffer, _bufferAlloc);
@@ -66,25 +94,36 @@ void UploadHeap::OnDestroy() {
     _buffer = nullptr;
     _bufferAlloc = nullptr;
     _pDataBegin = nullptr;
-    _pDataCur = nullptr;
-    _pDataEnd = nullptr;
-    ExceptionAssert(_imageUploadJobs.empty());
+    _size = 0;
+    ExceptionAssert(_imageUploadJobs.empty() && _bufferUploadJobs.empty());
     _imageUploadJobs.clear();
+    _bufferUploadJobs.clear();
 
     SetIsCreate(false);
     SetDevice(nullptr);
 }
 
 auto UploadHeap::AllocBuffer(uint8_t **pOutBufferPtr, size_t sizeInByte, size_t align) -> BufferOffset {
-    sizeInByte = AlignUp<size_t>(sizeInByte, align);
-    uint8_t *ptr = reinterpret_cast<uint8_t *>(AlignUp<intptr_t>(reinterpret_cast<intptr_t>(_pDataCur), align));
-    if ((ptr + sizeInByte) >= _pDataEnd) {
+    align = std::max<size_t>(align, 1);
+    sizeInByte = DivideRoundingUp(sizeInByte, align) * align;
+    size_t requestSize = sizeInByte + align - 1;
+    if (requestSize > _size) {
         return std::nullopt;
     }
 
-    _pDataCur = ptr + sizeInByte;
-    *pOutBufferPtr = ptr;
-    return std::make_optional<vk::DeviceSize>(ptr - _pDataBegin);
+    uint32_t offset = 0;
+    uint32_t allocated = 0;
+    while (!_mem.AllocContiguous(static_cast<uint32_t>(requestSize), &offset, &allocated)) {
+        // wait for the oldest batch in flight to give its staging memory back
+        if (!RetireOldestBatch()) {
+            return std::nullopt;
+        }
+    }
+    _batches[_batchIndex].allocatedSize += allocated;
+
+    size_t alignedOffset = DivideRoundingUp<size_t>(offset, align) * align;
+    *pOutBufferPtr = _pDataBegin + alignedOffset;
+    return std::make_optional<vk::DeviceSize>(alignedOffset);
 }
 
 auto UploadHeap::AllocBuffer(const void *pInitData, size_t sizeInByte, size_t align) -> BufferOffset {
@@ -102,71 +141,274 @@ void UploadHeap::AddImageJob(const ImageUploadJob &job) {
     _imageUploadJobs.push_back(job);
 }
 
+void UploadHeap::AddBufferJob(const BufferUploadJob &job) {
+    _bufferUploadJobs.push_back(job);
+}
+
+void UploadHeap::UploadBuffer(vk::Buffer dstBuffer,
+    vk::DeviceSize dstOffset,
+    const void *pData,
+    size_t sizeInByte,
+    vk::PipelineStageFlags dstStageMask,
+    vk::AccessFlags dstAccessMask) {
+
+    // buffer copies have no alignment requirement, keep the chunks large enough to be worth a copy command
+    constexpr size_t kAlign = 4;
+    const uint8_t *pSrc = static_cast<const uint8_t *>(pData);
+    size_t uploadedSize = 0;
+    while (uploadedSize < sizeInByte) {
+        size_t remainingSize = sizeInByte - uploadedSize;
+        size_t allocatableSize = WaitForAllocatableSize(std::min(remainingSize, _size / 4), kAlign);
+        size_t chunkSize = std::min(remainingSize, allocatableSize);
+
+        BufferOffset offset = AllocBuffer(pSrc + uploadedSize, chunkSize, kAlign);
+        ExceptionAssert(offset.has_value());
+
+        BufferUploadJob job;
+        job.srcBuffer = _buffer;
+        job.dstBuffer = dstBuffer;
+        job.bufferCopy.srcOffset = *offset;
+        job.bufferCopy.dstOffset = dstOffset + uploadedSize;
+        job.bufferCopy.size = chunkSize;
+        job.dstStageMask = dstStageMask;
+        job.dstAccessMask = dstAccessMask;
+        AddBufferJob(job);
+        uploadedSize += chunkSize;
+    }
+}
+
 void UploadHeap::Flush() {
-    vk::Device device = GetDevice()->GetVKDevice();
-    vk::Queue graphicsQueue = GetDevice()->GetGraphicsQueue();
+    vk::Queue transferQueue = GetDevice()->GetTransferQueue();
     VmaAllocator allocator = GetDevice()->GetAllocator();
-    VKException::Throw(vmaFlushAllocation(allocator, _bufferAlloc, 0, (_pDataCur - _pDataBegin)));
+    VKException::Throw(vmaFlushAllocation(allocator, _bufferAlloc, 0, VK_WHOLE_SIZE));
+
+    UploadBatch &batch = _batches[_batchIndex];
+    vk::CommandBuffer commandBuffer = batch.commandBuffer;
+    bool hasAcquireBarriers = IsOwnershipTransfer() && (!_imageUploadJobs.empty() || !_bufferUploadJobs.empty());
+    RecordBufferJobs(commandBuffer);
+    RecordImageJobs(commandBuffer);
+    commandBuffer.end();
+
+    batch.timelineValue = ++_lastSubmittedValue;
+    vk::TimelineSemaphoreSubmitInfo timelineSubmitInfo;
+    timelineSubmitInfo.signalSemaphoreValueCount = 1;
+    timelineSubmitInfo.pSignalSemaphoreValues = &batch.timelineValue;
+
+    vk::SubmitInfo submit;
+    submit.pNext = &timelineSubmitInfo;
+    submit.commandBufferCount = 1;
+    submit.pCommandBuffers = &commandBuffer;
+    submit.signalSemaphoreCount = 1;
+    submit.pSignalSemaphores = &_timelineSemaphore;
+    {
+        std::unique_lock lock = GetDevice()->LockQueue(transferQueue);
+        VKException::Throw(transferQueue.submit(1, &submit, nullptr));
+    }
+    batch.inFlight = true;
+    if (hasAcquireBarriers) {
+        _acquireWaitValue = batch.timelineValue;
+    }
+
+    _batchIndex = (_batchIndex + 1) % _batches.size();
+    BeginBatch();
+}
+
+void UploadHeap::FlushAndFinish() {
+    Flush();
+    while (RetireOldestBatch()) {
+    }
+}
+
+auto UploadHeap::RecordAcquireBarriers(vk::CommandBuffer cmd) -> uint64_t {
+    // the barriers of every submitted batch are recorded below, the ones still recording are not
+    _acquiredValue = _lastSubmittedValue;
+    if (_acquireImageBarriers.empty() && _acquireBufferBarriers.empty()) {
+        return 0;
+    }
+    // the semaphore wait covers these stages, so the acquire is chained after the release
+    cmd.pipelineBarrier(_acquireStageMask,
+        _acquireStageMask,
+        {},
+        0,
+        nullptr,
+        _acquireBufferBarriers.size(),
+        _acquireBufferBarriers.data(),
+        _acquireImageBarriers.size(),
+        _acquireImageBarriers.data());
+
+    _acquireBufferBarriers.clear();
+    _acquireImageBarriers.clear();
+    _acquireStageMask = {};
+    return std::exchange(_acquireWaitValue, 0);
+}
+
+auto UploadHeap::GetFinishedTimelineValue() const -> uint64_t {
+    uint64_t finishedValue = GetDevice()->GetVKDevice().getSemaphoreCounterValue(_timelineSemaphore);
+    if (IsOwnershipTransfer()) {
+        finishedValue = std::min(finishedValue, _acquiredValue);
+    }
+    return finishedValue;
+}
+
+auto UploadHeap::WaitForAllocatableSize(size_t minSize, size_t align) -> size_t {
+    for (;;) {
+        // 'AllocBuffer' rounds the size up and pads the offset, so leave room for both
+        size_t allocatableSize = GetAllocatableSize(2 * align - 1);
+        if (allocatableSize >= minSize) {
+            return allocatableSize;
+        }
+        if (_batches[_batchIndex].allocatedSize > 0) {
+            Flush();
+        } else if (!RetireOldestBatch()) {
+            Exception::Throw("UploadHeap: a piece of {} bytes does not fit into the {} bytes heap", minSize, _size);
+        }
+    }
+}
+
+auto UploadHeap::GetAllocatableSize(size_t align) const -> size_t {
+    size_t head = _mem.GetHead();
+    size_t tail = _mem.GetTail();
+    size_t contiguousSize = 0;
+    if (_mem.GetSize() == _size) {
+        contiguousSize = 0;
+    } else if (tail >= head) {
+        contiguousSize = std::max(_size - tail, head);
+    } else {
+        contiguousSize = head - tail;
+    }
+    size_t padding = (align > 1) ? (align - 1) : 0;
+    return (contiguousSize > padding) ? (contiguousSize - padding) : 0;
+}
+
+void UploadHeap::BeginBatch() {
+    UploadBatch &batch = _batches[_batchIndex];
+    // batches are submitted in ring order, so the next one is the oldest still in flight
+    if (batch.inFlight) {
+        RetireOldestBatch();
+    }
+    vk::CommandBufferBeginInfo cmdBeginInfo;
+    cmdBeginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    batch.commandBuffer.begin(cmdBeginInfo);
+}
+
+bool UploadHeap::RetireOldestBatch() {
+    vk::Device device = GetDevice()->GetVKDevice();
+    for (size_t i = 0; i < _batches.size(); ++i) {
+        UploadBatch &batch = _batches[(_batchIndex + i) % _batches.size()];
+        if (!batch.inFlight) {
+            continue;
+        }
+        if (device.getSemaphoreCounterValue(_timelineSemaphore) < batch.timelineValue) {
+            vk::SemaphoreWaitInfo waitInfo;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &_timelineSemaphore;
+            waitInfo.pValues = &batch.timelineValue;
+            VKException::Throw(device.waitSemaphores(waitInfo, UINT64_MAX));
+        }
+        _mem.Free(batch.allocatedSize);
+        batch.allocatedSize = 0;
+        batch.inFlight = false;
+        return true;
+    }
+    return false;
+}
+
+void UploadHeap::RecordBufferJobs(vk::CommandBuffer commandBuffer) {
+    if (_bufferUploadJobs.empty()) {
+        return;
+    }
+
+    vk::PipelineStageFlags dstStageMask;
+    std::vector<vk::BufferMemoryBarrier> bufferPostBarriers;
+    for (const BufferUploadJob &job : _bufferUploadJobs) {
+        commandBuffer.copyBuffer(job.srcBuffer, job.dstBuffer, 1, &job.bufferCopy);
+
+        vk::BufferMemoryBarrier barrier;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = job.dstAccessMask;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = job.dstBuffer;
+        barrier.offset = job.bufferCopy.dstOffset;
+        barrier.size = job.bufferCopy.size;
+        if (IsOwnershipTransfer()) {
+            barrier.srcQueueFamilyIndex = _transferQueueFamilyIndex;
+            barrier.dstQueueFamilyIndex = _graphicsQueueFamilyIndex;
+            // the acquire half makes the data visible, the release half only needs the source scope
+            vk::BufferMemoryBarrier acquireBarrier = barrier;
+            acquireBarrier.srcAccessMask = {};
+            barrier.dstAccessMask = {};
+            _acquireBufferBarriers.push_back(acquireBarrier);
+            _acquireStageMask |= job.dstStageMask;
+        }
+        dstStageMask |= job.dstStageMask;
+        bufferPostBarriers.push_back(barrier);
+    }
+
+    // a dedicated transfer queue can not name the graphics stages, so the release waits at bottom of pipe
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+        IsOwnershipTransfer() ? vk::PipelineStageFlagBits::eBottomOfPipe : dstStageMask,
+        {},
+        0,
+        nullptr,
+        bufferPostBarriers.size(),
+        bufferPostBarriers.data(),
+        0,
+        nullptr);
+    _bufferUploadJobs.clear();
+}
+
+void UploadHeap::RecordImageJobs(vk::CommandBuffer commandBuffer) {
+    if (_imageUploadJobs.empty()) {
+        return;
+    }
 
     std::vector<vk::ImageMemoryBarrier> imagePrevBarriers;
     std::vector<vk::ImageMemoryBarrier> imagePostBarriers;
     for (const ImageUploadJob &job : _imageUploadJobs) {
         imagePrevBarriers.push_back(job.prevBarrier);
-        imagePostBarriers.push_back(job.postBarrier);
+        vk::ImageMemoryBarrier postBarrier = job.postBarrier;
+        if (IsOwnershipTransfer()) {
+            postBarrier.srcQueueFamilyIndex = _transferQueueFamilyIndex;
+            postBarrier.dstQueueFamilyIndex = _graphicsQueueFamilyIndex;
+            // both halves repeat the layout transition, the driver performs it only once
+            vk::ImageMemoryBarrier acquireBarrier = postBarrier;
+            acquireBarrier.srcAccessMask = {};
+            postBarrier.dstAccessMask = {};
+            _acquireImageBarriers.push_back(acquireBarrier);
+            _acquireStageMask |= vk::PipelineStageFlagBits::eFragmentShader;
+        }
+        imagePostBarriers.push_back(postBarrier);
     }
 
-    if (imagePrevBarriers.size()) {
-        _commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost,
-            vk::PipelineStageFlagBits::eTransfer,
-            {},
-            0,
-            nullptr,
-            0,
-            nullptr,
-            imagePrevBarriers.size(),
-            imagePrevBarriers.data());
-    }
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost,
+        vk::PipelineStageFlagBits::eTransfer,
+        {},
+        0,
+        nullptr,
+        0,
+        nullptr,
+        imagePrevBarriers.size(),
+        imagePrevBarriers.data());
 
     for (const ImageUploadJob &job : _imageUploadJobs) {
-        _commandBuffer.copyBufferToImage(_buffer,
+        commandBuffer.copyBufferToImage(_buffer,
             job.prevBarrier.image,
             vk::ImageLayout::eTransferDstOptimal,
             1,
             &job.bufferImageCopy);
     }
 
-    if (imagePostBarriers.size()) {
-        _commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eFragmentShader,
-            {},
-            0,
-            nullptr,
-            0,
-            nullptr,
-            imagePostBarriers.size(),
-            imagePostBarriers.data());
-    }
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+        IsOwnershipTransfer() ? vk::PipelineStageFlagBits::eBottomOfPipe : vk::PipelineStageFlagBits::eFragmentShader,
+        {},
+        0,
+        nullptr,
+        0,
+        nullptr,
+        imagePostBarriers.size(),
+        imagePostBarriers.data());
     _imageUploadJobs.clear();
-    _commandBuffer.end();
-
-    vk::SubmitInfo submit;
-    submit.commandBufferCount = 1;
-    submit.pCommandBuffers = &_commandBuffer;
-    VKException::Throw((graphicsQueue.submit(1, &submit, _fence)));
-    VKException::Throw(device.waitForFences(1, &_fence, VK_TRUE, UINT64_MAX));
-    device.resetFences(_fence);
-
-    vk::CommandBufferBeginInfo cmdBeginInfo;
-    _commandBuffer.begin(cmdBeginInfo);
-    _pDataCur = _pDataBegin;
-}
-
-auto UploadHeap::GetAllocatableSize(size_t align) const -> size_t {
-    if (align == 0) {
-        return _pDataEnd - _pDataCur;
-    }
-    uint8_t *ptr = reinterpret_cast<uint8_t *>(AlignUp<intptr_t>(reinterpret_cast<intptr_t>(_pDataCur), align));
-    return _pDataEnd - ptr;
 }
 
 }    // namespace vkgfx
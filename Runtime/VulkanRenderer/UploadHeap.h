@@ -2,11 +2,21 @@
 #include <optional>
 #include <vulkan/vulkan.hpp>
 #include <vk_mem_alloc.h>
+#include "Ring.h"
 #include "VKObject.h"
 
 namespace vkgfx {
 
 class Device;
+
+// Staging ring shared by several upload batches. 'Flush' submits the current batch on the transfer
+// queue and returns immediately; each batch signals the next value of a timeline semaphore and its
+// staging memory is handed back once that value is reached, so the CPU can keep filling the heap
+// while earlier batches are still copying.
+//
+// When the transfer queue belongs to another family, the copied resources are released by the
+// upload batch and must be acquired on the graphics queue: call 'RecordAcquireBarriers' on the frame
+// command buffer and make its submission wait for the returned timeline value.
 class UploadHeap : public VKObject {
 public:
     struct ImageUploadJob {
@@ -14,17 +24,37 @@ public:
         vk::ImageMemoryBarrier prevBarrier;
         vk::ImageMemoryBarrier postBarrier;
     };
+    struct BufferUploadJob {
+        vk::Buffer srcBuffer;
+        vk::Buffer dstBuffer;
+        vk::BufferCopy bufferCopy;
+        vk::PipelineStageFlags dstStageMask;    // the stages that read the buffer after the upload
+        vk::AccessFlags dstAccessMask;
+    };
     using BufferOffset = std::optional<vk::DeviceSize>;
 public:
-    void OnCreate(std::string_view name, Device *pDevice, size_t size);
+    void OnCreate(std::string_view name, Device *pDevice, size_t size, uint32_t numBatches = 3);
     void OnDestroy();
     [[nodiscard]]
     auto AllocBuffer(uint8_t **pOutBufferPtr, size_t sizeInByte, size_t align = 1) -> BufferOffset;
     [[nodiscard]]
     auto AllocBuffer(const void *pInitData, size_t sizeInByte, size_t align = 1) -> BufferOffset;
     void AddImageJob(const ImageUploadJob &job);
+    void AddBufferJob(const BufferUploadJob &job);
+    // Streaming upload of any size: the data is split into heap-sized pieces, flushing and reusing the
+    // heap as it goes.
+    void UploadBuffer(vk::Buffer dstBuffer,
+        vk::DeviceSize dstOffset,
+        const void *pData,
+        size_t sizeInByte,
+        vk::PipelineStageFlags dstStageMask,
+        vk::AccessFlags dstAccessMask);
     void Flush();
+    void FlushAndFinish();
     auto GetAllocatableSize(size_t align = 0) const -> size_t;
+    // returns the timeline value the submission of 'cmd' must wait for, 0 when nothing was acquired
+    [[nodiscard]]
+    auto RecordAcquireBarriers(vk::CommandBuffer cmd) -> uint64_t;
 
     auto GetBasePtr() const -> uint8_t * {
         return _pDataBegin;
@@ -33,18 +63,57 @@ public:
         return _buffer;
     }
     auto GetCommandBuffer() const -> vk::CommandBuffer {
-        return _commandBuffer;
+        return _batches[_batchIndex].commandBuffer;
+    }
+    auto GetTimelineSemaphore() const -> vk::Semaphore {
+        return _timelineSemaphore;
+    }
+    auto GetLastSubmittedValue() const -> uint64_t {
+        return _lastSubmittedValue;
+    }
+    // the value the batch being recorded will signal, the jobs added now are done once it is reached
+    auto GetRecordingTimelineValue() const -> uint64_t {
+        return _lastSubmittedValue + 1;
+    }
+    // Batches up to the returned value have finished copying and, when the transfer queue belongs to
+    // another family, their resources were acquired by an earlier 'RecordAcquireBarriers'.
+    auto GetFinishedTimelineValue() const -> uint64_t;
+    auto IsOwnershipTransfer() const -> bool {
+        return _transferQueueFamilyIndex != _graphicsQueueFamilyIndex;
     }
 private:
+    struct UploadBatch {
+        vk::CommandBuffer commandBuffer;
+        uint64_t timelineValue = 0;
+        uint32_t allocatedSize = 0;
+        bool inFlight = false;
+    };
+    void BeginBatch();
+    bool RetireOldestBatch();
+    auto WaitForAllocatableSize(size_t minSize, size_t align) -> size_t;
+    void RecordBufferJobs(vk::CommandBuffer commandBuffer);
+    void RecordImageJobs(vk::CommandBuffer commandBuffer);
+private:
+    size_t _size = 0;
     vk::CommandPool _commandPool;
-    vk::CommandBuffer _commandBuffer;
-    vk::Fence _fence;
     vk::Buffer _buffer;
     VmaAllocation _bufferAlloc = VK_NULL_HANDLE;
     uint8_t *_pDataBegin = nullptr;
-    uint8_t *_pDataCur = nullptr;
-    uint8_t *_pDataEnd = nullptr;
+    Ring _mem;
+    size_t _batchIndex = 0;
+    std::vector<UploadBatch> _batches;
     std::vector<ImageUploadJob> _imageUploadJobs;
+    std::vector<BufferUploadJob> _bufferUploadJobs;
+
+    uint32_t _transferQueueFamilyIndex = 0;
+    uint32_t _graphicsQueueFamilyIndex = 0;
+    vk::Semaphore _timelineSemaphore;
+    uint64_t _lastSubmittedValue = 0;
+    uint64_t _acquireWaitValue = 0;
+    uint64_t _acquiredValue = 0;
+    vk::PipelineStageFlags _acquireStageMask;
+    std::vector<vk::ImageMemoryBarrier> _acquireImageBarriers;
+    std::vector<vk::BufferMemoryBarrier> _acquireBufferBarriers;
 };
 
 }    // namespace vkgfx
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include "VulkanRenderer/Ring.h"
+
+// RingStressTest [threads] [frames]
+// Hammers 'RingWithTabs::Alloc' from many threads per frame and checks after every frame that no two
+// live allocations overlap, that none crosses the end of the ring, and that 'OnBeginFrame' gives back
+// exactly the memory of the frame that left the ring.
+
+namespace {
+
+constexpr uint32_t kRingSize = 1 << 20;
+constexpr uint32_t kNumBackBuffers = 3;
+constexpr uint32_t kAllocsPerThread = 64;
+constexpr uint32_t kMaxAllocSize = 2048;
+
+struct Allocation {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct Frame {
+    std::vector<Allocation> allocations;
+    uint32_t allocatedSize = 0;    // including the padding, as reported by the ring
+};
+
+bool CheckLiveFrames(const std::deque<Frame> &liveFrames, size_t frameIndex) {
+    std::vector<Allocation> allocations;
+    for (const Frame &frame : liveFrames) {
+        allocations.insert(allocations.end(), frame.allocations.begin(), frame.allocations.end());
+    }
+    std::ranges::sort(allocations, {}, &Allocation::offset);
+    for (size_t i = 0; i < allocations.size(); ++i) {
+        const Allocation &allocation = allocations[i];
+        if (allocation.offset + allocation.size > kRingSize) {
+            fmt::print(stderr,
+                "frame {}: [{}, {}) crosses the end of the ring\n",
+                frameIndex,
+                allocation.offset,
+                allocation.offset + allocation.size);
+            return false;
+        }
+        if (i > 0 && allocations[i - 1].offset + allocations[i - 1].size > allocation.offset) {
+            fmt::print(stderr,
+                "frame {}: [{}, {}) overlaps [{}, {})\n",
+                frameIndex,
+                allocations[i - 1].offset,
+                allocations[i - 1].offset + allocations[i - 1].size,
+                allocation.offset,
+                allocation.offset + allocation.size);
+            return false;
+        }
+    }
+    return true;
+}
+
+}    // namespace
+
+int main(int argc, char *argv[]) {
+    uint32_t numThreads = (argc > 1) ? std::stoul(argv[1]) : std::max(std::thread::hardware_concurrency(), 4u);
+    size_t numFrames = (argc > 2) ? std::stoul(argv[2]) : 2000;
+
+    vkgfx::RingWithTabs ring;
+    ring.OnCreate(kNumBackBuffers, kRingSize);
+
+    std::deque<Frame> liveFrames;
+    size_t failedAllocCount = 0;
+    for (size_t frameIndex = 0; frameIndex < numFrames; ++frameIndex) {
+        std::vector<std::vector<Allocation>> threadAllocations(numThreads);
+        std::vector<size_t> threadFailedCounts(numThreads, 0);
+        std::vector<std::thread> threads;
+        threads.reserve(numThreads);
+        for (uint32_t threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+            threads.emplace_back([&, threadIndex]() {
+                std::minstd_rand random(static_cast<uint32_t>(frameIndex * numThreads + threadIndex));
+                std::uniform_int_distribution<uint32_t> sizeDistribution(1, kMaxAllocSize);
+                for (uint32_t i = 0; i < kAllocsPerThread; ++i) {
+                    uint32_t size = sizeDistribution(random);
+                    uint32_t offset = 0;
+                    if (ring.Alloc(size, &offset)) {
+                        threadAllocations[threadIndex].push_back(Allocation{offset, size});
+                    } else {
+                        ++threadFailedCounts[threadIndex];
+                    }
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        Frame &frame = liveFrames.emplace_back();
+        for (uint32_t threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+            frame.allocations.insert(frame.allocations.end(),
+                threadAllocations[threadIndex].begin(),
+                threadAllocations[threadIndex].end());
+            failedAllocCount += threadFailedCounts[threadIndex];
+        }
+        frame.allocatedSize = ring.GetAllocatedInFrame();
+
+        uint32_t requestedSize = 0;
+        for (const Allocation &allocation : frame.allocations) {
+            requestedSize += allocation.size;
+        }
+        if (frame.allocatedSize < requestedSize) {
+            fmt::print(stderr,
+                "frame {}: {} bytes accounted for {} bytes allocated\n",
+                frameIndex,
+                frame.allocatedSize,
+                requestedSize);
+            return 1;
+        }
+        if (!CheckLiveFrames(liveFrames, frameIndex)) {
+            return 1;
+        }
+
+        // the frame that used the next back buffer leaves the ring
+        ring.OnBeginFrame();
+        if (liveFrames.size() == kNumBackBuffers) {
+            liveFrames.pop_front();
+        }
+        uint32_t liveSize = 0;
+        for (const Frame &liveFrame : liveFrames) {
+            liveSize += liveFrame.allocatedSize;
+        }
+        if (ring.GetAllocatableSize() != kRingSize - liveSize) {
+            fmt::print(stderr,
+                "frame {}: {} bytes allocatable after OnBeginFrame, expected {}\n",
+                frameIndex,
+                ring.GetAllocatableSize(),
+                kRingSize - liveSize);
+            return 1;
+        }
+    }
+
+    ring.OnDestroy();
+    fmt::print("{} frames on {} threads passed, {} allocations failed on a full ring\n",
+        numFrames,
+        numThreads,
+        failedAllocCount);
+    return 0;
+}
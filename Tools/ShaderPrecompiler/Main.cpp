@@ -0,0 +1,37 @@
+#include <cstring>
+#include <fmt/format.h>
+#include "Foundation/Logger.h"
+#include "Foundation/ThreadPool.h"
+#include "ShaderPrecompiler.h"
+#include "Utils/AssetProjectSetting.h"
+#include "VulkanRenderer/DxcModule.h"
+
+// ShaderPrecompiler <manifest.json> [--force]
+// Run it from the directory of the application, it uses the same AssetProjectSetting.json.
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fmt::print(stderr, "Usage: ShaderPrecompiler <manifest.json> [--force]\n");
+        return 2;
+    }
+    bool forceCompile = (argc > 2) && std::strcmp(argv[2], "--force") == 0;
+
+    gLogger->Initialize();
+    gLogger->StartLogging();
+    // read only, unlike the application the tool never writes the settings back
+    gAssetProjectSetting->Initialize();
+    gThreadPool->Initialize();
+    vkgfx::gDxcModule->OnCreate();
+
+    bool succeeded = false;
+    try {
+        ShaderPrecompiler precompiler;
+        succeeded = precompiler.Run(argv[1], forceCompile);
+    } catch (const std::exception &exception) {
+        Logger::Error("Precompile shaders failed: {}", exception.what());
+    }
+
+    vkgfx::gDxcModule->OnDestroy();
+    gThreadPool->Destroy();
+    gLogger->Destroy();
+    return succeeded ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#include "ShaderPermutationManifest.h"
+
+IMPLEMENT_SERIALIZER(ShaderEntryPointDesc)
+IMPLEMENT_SERIALIZER(ShaderDefineAxis)
+IMPLEMENT_SERIALIZER(ShaderPermutationDesc)
+IMPLEMENT_SERIALIZER(ShaderPermutationManifest)
+
+template<TransferContextConcept T>
+void ShaderEntryPointDesc::TransferImpl(T &transfer) {
+    TRANSFER(name);
+    TRANSFER(shaderType);
+}
+
+template<TransferContextConcept T>
+void ShaderDefineAxis::TransferImpl(T &transfer) {
+    TRANSFER(name);
+    TRANSFER(values);
+}
+
+template<TransferContextConcept T>
+void ShaderPermutationDesc::TransferImpl(T &transfer) {
+    TRANSFER(sourcePath);
+    TRANSFER(entryPoints);
+    TRANSFER(defineAxes);
+}
+
+template<TransferContextConcept T>
+void ShaderPermutationManifest::TransferImpl(T &transfer) {
+    TRANSFER(shaders);
+}
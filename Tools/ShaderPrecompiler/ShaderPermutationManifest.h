@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Serialize/Transfer.hpp"
+
+// The variants the ShaderPrecompiler builds. Every entry point of a shader is compiled once for each
+// combination of its define axes, e.g. two axes with the values [0, 1] give four variants.
+
+struct ShaderEntryPointDesc {
+    DECLARE_SERIALIZER(ShaderEntryPointDesc)
+public:
+    std::string name;
+    std::string shaderType;    // "VS", "PS", ..., the vkgfx::ShaderType name without the 'k'
+};
+
+struct ShaderDefineAxis {
+    DECLARE_SERIALIZER(ShaderDefineAxis)
+public:
+    std::string name;
+    std::vector<int> values;
+};
+
+struct ShaderPermutationDesc {
+    DECLARE_SERIALIZER(ShaderPermutationDesc)
+public:
+    std::string sourcePath;    // relative to the Asset directory
+    std::vector<ShaderEntryPointDesc> entryPoints;
+    std::vector<ShaderDefineAxis> defineAxes;
+};
+
+struct ShaderPermutationManifest {
+    DECLARE_SERIALIZER(ShaderPermutationManifest)
+public:
+    std::vector<ShaderPermutationDesc> shaders;
+};
@@ -0,0 +1,162 @@
+#include "ShaderPrecompiler.h"
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <fmt/format.h>
+#include <magic_enum.hpp>
+#include "Foundation/Logger.h"
+#include "Foundation/ThreadPool.h"
+#include "Shader/ShaderCacheKey.h"
+#include "Utils/AssetProjectSetting.h"
+#include "VulkanRenderer/ShaderCompiler.h"
+
+bool ShaderPrecompiler::Run(const stdfs::path &manifestPath, bool forceCompile) {
+    ShaderPermutationManifest manifest;
+    TransferJsonReader jsonReader(manifestPath);
+    if (!Serialize(jsonReader, manifest)) {
+        Logger::Error("Can't read the shader permutation manifest {}", manifestPath.string());
+        return false;
+    }
+    std::vector<Variant> variants = ExpandManifest(manifest);
+
+    stdfs::path shaderCacheDir = gAssetProjectSetting->GetAssetCacheAbsolutePath() / GetShaderCacheDirectory();
+    stdfs::create_directories(shaderCacheDir);
+    _cacheArchive.SetCompression(ShaderCacheArchive::Compression::kLZ4);
+    _cacheArchive.Open(shaderCacheDir / "ShaderCache.bin");
+    _dependencyDatabase.Load(shaderCacheDir / "ShaderDependency.bin");
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::future<CompileResult>> compileTasks(variants.size());
+    for (size_t i = 0; i < variants.size(); ++i) {
+        std::optional<UUID128> pCacheKey = MakeCacheKey(variants[i]);
+        if (!forceCompile && pCacheKey.has_value() && _cacheArchive.Find(*pCacheKey).has_value()) {
+            continue;
+        }
+        // 'variants' is not touched until every task has finished
+        compileTasks[i] = gThreadPool->Submit([&variant = variants[i]]() { return CompileVariant(variant); });
+    }
+
+    size_t compiledCount = 0;
+    size_t failedCount = 0;
+    fmt::print("{:<72} {:>12} {:>14}\n", "Variant", "Compile", "SPIR-V");
+    for (size_t i = 0; i < variants.size(); ++i) {
+        const Variant &variant = variants[i];
+        if (!compileTasks[i].valid()) {
+            fmt::print("{:<72} {:>12} {:>14}\n", variant.name, "up to date", "-");
+            continue;
+        }
+
+        // the dependency database and the archive are only used on this thread
+        CompileResult result = compileTasks[i].get();
+        uint64_t variantHash = MakeShaderVariantHash(variant.entryPoint, variant.shaderType, variant.defineList);
+        _dependencyDatabase.SetIncludeFiles(variant.sourcePath, variantHash, result.includeFiles);
+        if (!result.succeeded) {
+            fmt::print("{:<72} {:>12} {:>14}\n", variant.name, "failed", "-");
+            Logger::Error("Compile shader {} error: the error message: {}", variant.name, result.errorMessage);
+            ++failedCount;
+            continue;
+        }
+
+        // the runtime keeps the full bytecode in its own debug archive, the shipped one is stripped
+        std::vector<char> byteCode = vkgfx::ShaderCompiler::StripDebugInfo(result.byteCode);
+        _cacheArchive.Append(MakeCacheKey(variant).value(), byteCode);
+        fmt::print("{:<72} {:>9.2f} ms {:>8} bytes\n", variant.name, result.compileTimeMs, byteCode.size());
+        ++compiledCount;
+    }
+
+    std::chrono::duration<double> totalTime = std::chrono::steady_clock::now() - startTime;
+    fmt::print("{} variants: {} compiled, {} up to date, {} failed in {:.2f} s\n",
+        variants.size(),
+        compiledCount,
+        variants.size() - compiledCount - failedCount,
+        failedCount,
+        totalTime.count());
+
+    _cacheArchive.Close();
+    if (!_dependencyDatabase.Save().get()) {
+        Logger::Error("Can't save the shader dependency database");
+        return false;
+    }
+    return failedCount == 0;
+}
+
+auto ShaderPrecompiler::ExpandManifest(const ShaderPermutationManifest &manifest) -> std::vector<Variant> {
+    std::vector<Variant> variants;
+    for (const ShaderPermutationDesc &shaderDesc : manifest.shaders) {
+        stdfs::path sourcePath = gAssetProjectSetting->GetAssetAbsolutePath() / shaderDesc.sourcePath;
+        sourcePath = sourcePath.lexically_normal();
+        Exception::CondThrow(stdfs::exists(sourcePath), "Shader {} does not exist", sourcePath.string());
+
+        // the define lists of all combinations, the first axis changes fastest
+        std::vector<vkgfx::DefineList> defineLists(1);
+        for (const ShaderDefineAxis &axis : shaderDesc.defineAxes) {
+            Exception::CondThrow(!axis.values.empty(), "Define axis {} has no values", axis.name);
+            std::vector<vkgfx::DefineList> combinations;
+            combinations.reserve(defineLists.size() * axis.values.size());
+            for (int value : axis.values) {
+                for (const vkgfx::DefineList &defineList : defineLists) {
+                    vkgfx::DefineList &combination = combinations.emplace_back(defineList);
+                    combination.Set(axis.name, value);
+                }
+            }
+            defineLists = std::move(combinations);
+        }
+
+        for (const ShaderEntryPointDesc &entryPointDesc : shaderDesc.entryPoints) {
+            std::string typeName = "k" + entryPointDesc.shaderType;
+            std::optional<vkgfx::ShaderType> pShaderType = magic_enum::enum_cast<vkgfx::ShaderType>(typeName);
+            Exception::CondThrow(pShaderType.has_value(),
+                "Invalid shader type {} of {}",
+                entryPointDesc.shaderType,
+                entryPointDesc.name);
+
+            for (const vkgfx::DefineList &defineList : defineLists) {
+                Variant &variant = variants.emplace_back();
+                variant.sourcePath = sourcePath;
+                variant.entryPoint = entryPointDesc.name;
+                variant.shaderType = *pShaderType;
+                variant.defineList = defineList;
+                variant.name = fmt::format("{} {} {}",
+                    shaderDesc.sourcePath,
+                    entryPointDesc.name,
+                    defineList.ToString());
+            }
+        }
+    }
+    return variants;
+}
+
+auto ShaderPrecompiler::CompileVariant(const Variant &variant) -> CompileResult {
+    CompileResult result;
+    auto startTime = std::chrono::steady_clock::now();
+    vkgfx::ShaderCompiler shaderCompiler;
+    bool succeeded = shaderCompiler.Compile(variant.sourcePath,
+        variant.entryPoint,
+        variant.shaderType,
+        variant.defineList);
+    std::chrono::duration<double, std::milli> compileTime = std::chrono::steady_clock::now() - startTime;
+    result.compileTimeMs = compileTime.count();
+    result.includeFiles = shaderCompiler.GetIncludeFiles();
+    if (!succeeded) {
+        result.errorMessage = shaderCompiler.GetErrorMessage();
+        return result;
+    }
+
+    result.byteCode.resize(shaderCompiler.GetByteCodeSize(), 0);
+    std::memcpy(result.byteCode.data(), shaderCompiler.GetByteCodePtr(), shaderCompiler.GetByteCodeSize());
+    result.succeeded = true;
+    return result;
+}
+
+auto ShaderPrecompiler::MakeCacheKey(const Variant &variant) -> std::optional<UUID128> {
+    uint64_t variantHash = MakeShaderVariantHash(variant.entryPoint, variant.shaderType, variant.defineList);
+    std::optional<uint64_t> pClosureHash = _dependencyDatabase.GetClosureHash(variant.sourcePath, variantHash);
+    if (!pClosureHash.has_value()) {
+        return std::nullopt;
+    }
+    return MakeShaderCacheKey(variant.sourcePath,
+        *pClosureHash,
+        variant.entryPoint,
+        variant.shaderType,
+        variant.defineList);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+#include "Foundation/NamespeceAlias.h"
+#include "Foundation/NonCopyable.h"
+#include "Foundation/UUID128.h"
+#include "Shader/ShaderCacheArchive.h"
+#include "Shader/ShaderDependencyDatabase.h"
+#include "ShaderPermutationManifest.h"
+#include "VulkanRenderer/DefineList.h"
+#include "VulkanRenderer/EnumDefinition.h"
+
+// Compiles every variant of a permutation manifest on gThreadPool into the shader cache archive of
+// the current build mode, the same entries ShaderManager would write on a cache miss, and prints the
+// compile time and SPIR-V size of each variant. Variants already in the archive are skipped unless
+// 'forceCompile' is set.
+class ShaderPrecompiler : public NonCopyable {
+public:
+    // false when the manifest can't be read or any variant failed to compile
+    bool Run(const stdfs::path &manifestPath, bool forceCompile);
+private:
+    struct Variant {
+        stdfs::path sourcePath;    // absolute
+        std::string entryPoint;
+        vkgfx::ShaderType shaderType = {};
+        vkgfx::DefineList defineList;
+        std::string name;
+    };
+    struct CompileResult {
+        bool succeeded = false;
+        std::vector<char> byteCode;
+        std::vector<stdfs::path> includeFiles;
+        std::string errorMessage;
+        double compileTimeMs = 0.0;
+    };
+    static auto ExpandManifest(const ShaderPermutationManifest &manifest) -> std::vector<Variant>;
+    static auto CompileVariant(const Variant &variant) -> CompileResult;
+    auto MakeCacheKey(const Variant &variant) -> std::optional<UUID128>;
+private:
+    ShaderCacheArchive _cacheArchive;
+    ShaderDependencyDatabase _dependencyDatabase;
+};
@@ -31,10 +31,11 @@ add_requires("glfw 3.3.8")
 add_requires("vulkan-hpp v1.3.250", {verify = false})        
 add_requires("vulkan-memory-allocator v3.0.1")
 add_requires("stduuid", {debug = isDebug})
-add_requires("jsoncpp 1.9.5", {debug = isDebug, configs = {shared = false}})
 add_requires("magic_enum v0.9.0")
 add_requires("vulkansdk", {system = true})
 add_requires("glm")
+add_requires("spirv-reflect")
+add_requires("lz4")
 
 target("VulkanApp")
     set_languages("c++latest")
@@ -59,8 +60,9 @@ target("VulkanApp")
     add_packages("vulkan-hpp")
     add_packages("vulkansdk")
     add_packages("magic_enum")
-    add_packages("jsoncpp")
     add_packages("glm")
+    add_packages("spirv-reflect")
+    add_packages("lz4")
 
     add_defines("VMA_STATIC_VULKAN_FUNCTIONS=0", "VMA_DYNAMIC_VULKAN_FUNCTIONS=1")
     add_packages("vulkan-memory-allocator")
@@ -88,3 +90,59 @@ target("VulkanApp")
         target:values("on_install_renderdoc")(target, target:values("renderdocLibDir"))
     end)
 target_end()
+
+-- Offline shader permutation precompiler, warms the shader cache of the same build mode:
+-- xmake run ShaderPrecompiler Assets/Shaders/ShaderPermutations.json
+target("ShaderPrecompiler")
+    set_languages("c++latest")
+    set_warnings("all")
+    set_kind("binary")
+    add_files("Tools/ShaderPrecompiler/**.cpp")
+    add_files("Runtime/Foundation/**.cpp")
+    add_files("Runtime/Serialize/**.cpp")
+    add_files("Runtime/Utils/**.cpp")
+    add_files("Runtime/Shader/ShaderCacheArchive.cpp")
+    add_files("Runtime/Shader/ShaderCacheKey.cpp")
+    add_files("Runtime/Shader/ShaderDependencyDatabase.cpp")
+    add_files("Runtime/VulkanRenderer/DefineList.cpp")
+    add_files("Runtime/VulkanRenderer/DxcModule.cpp")
+    add_files("Runtime/VulkanRenderer/ShaderCompiler.cpp")
+    add_files("Runtime/VulkanRenderer/ShaderIncludeCache.cpp")
+    add_includedirs(RUNTIME_DIR)
+    add_defines("PLATFORM_WIN")
+    add_defines("_SILENCE_CXX17_CODECVT_HEADER_DEPRECATION_WARNING=1", "_SILENCE_ALL_CXX17_DEPRECATION_WARNINGS=1")
+
+    add_packages("fmt")
+    add_packages("spdlog")
+    add_packages("magic_enum")
+    add_packages("stduuid")
+    add_packages("glm")
+    add_packages("lz4")
+
+    set_targetdir(BINARY_DIR)
+    set_rundir(BINARY_DIR)
+
+    add_syslinks("Advapi32")
+
+    local dxcDir = path.join(THIRD_PARTY_DIR, "dxc")
+    set_values("dxcDir", dxcDir)
+    link_dxc_compiler(dxcDir)
+
+    set_values("on_install_dxc", on_install_dxc)
+    on_install(function (target)
+        target:values("on_install_dxc")(target, target:values("dxcDir"))
+    end)
+target_end()
+
+-- Standalone stress test of the lock-free RingWithTabs, no device needed:
+-- xmake build RingStressTest && xmake run RingStressTest [threads] [frames]
+target("RingStressTest")
+    set_languages("c++latest")
+    set_warnings("all")
+    set_kind("binary")
+    set_default(false)
+    add_files("Tests/RingStressTest/**.cpp")
+    add_includedirs(RUNTIME_DIR)
+    add_packages("fmt")
+    set_targetdir(BINARY_DIR)
+target_end()